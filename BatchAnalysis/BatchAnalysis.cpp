@@ -0,0 +1,420 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Batch flight trace analysis.
+//
+// Runs the plugin landing detection and classification over whole archives
+// of recorded flight traces on all cores, and writes one report of all the
+// landings found. Each trace is memory mapped and replayed on its own, and
+// each thread keeps its own totals that are added up at the end.
+//
+// Usage: BatchAnalysis [-j threads] [-f csv|json] [-o report] (trace.lxr|dir)...
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FlightData.h"
+#include "FlightMath.h"
+#include "FlightRecorder.h"
+#include "FlightTracker.h"
+#include "LandingClassifier.h"
+#include "QuantileSketch.h"
+
+using namespace xplmpp;
+
+namespace {
+
+static const char kTraceExtension[] = ".lxr";
+static const float kReportQuantiles[] = { 0.5f, 0.9f, 0.99f };
+
+enum class Format {
+  csv,
+  json,
+};
+
+// Landing found in a trace.
+struct Landing {
+  LandingInfo info;
+  int quality;  // LandingQualityIndex(), -1 when not after a real flight
+};
+
+// Everything found in a trace.
+struct TraceResult {
+  bool ok = false;
+  size_t sample_count = 0;
+  std::vector<Landing> landings;
+};
+
+// Totals of a thread, added up across the threads at the end.
+struct Totals {
+  void Add(const TraceResult& result);
+  void Merge(const Totals& other);
+
+  size_t trace_count = 0;
+  size_t failed_count = 0;
+  size_t sample_count = 0;
+  size_t landing_count = 0;
+  std::vector<size_t> quality_counts = std::vector<size_t>(LandingQualityCount());
+  QuantileSketch vertical_speed;  // of the classified landings
+};
+
+void Totals::Add(const TraceResult& result) {
+  ++trace_count;
+  if (!result.ok) {
+    ++failed_count;
+    return;
+  }
+
+  sample_count += result.sample_count;
+  landing_count += result.landings.size();
+  for (const Landing& landing : result.landings) {
+    if (landing.quality < 0)
+      continue;
+    ++quality_counts[landing.quality];
+    vertical_speed.Add(fabsf(landing.info.vertical_speed));
+  }
+}
+
+void Totals::Merge(const Totals& other) {
+  trace_count += other.trace_count;
+  failed_count += other.failed_count;
+  sample_count += other.sample_count;
+  landing_count += other.landing_count;
+  for (size_t n = 0; n < quality_counts.size(); ++n)
+    quality_counts[n] += other.quality_counts[n];
+  vertical_speed.Merge(other.vertical_speed);
+}
+
+// Collects the landings detected while replaying a trace.
+class BatchClient : public FlightLoopClient {
+public:
+  explicit BatchClient(std::vector<Landing>* landings)
+  : landings_(landings) {}
+
+  // FlightLoopClient interface
+  void OnFlightLoopTick() override {}
+
+  void OnAirplaneFlying(const FlyingInfo& info) override {
+    classifier_.OnAirplaneFlying(info);
+  }
+
+  void OnAirplaneLanded(const LandingInfo& info) override {
+    bool was_really_flying = classifier_.OnAirplaneLanded();
+    Landing landing;
+    landing.info = info;
+    landing.quality = was_really_flying ? LandingQualityIndex(fabs(info.vertical_speed)) : -1;
+    landings_->push_back(landing);
+  }
+
+  void OnLandingAnalyzed(const LandingAnalysis&) override {}
+
+  void OnTrafficLanded(int, const std::string&, const LandingInfo&) override {}
+
+private:
+  std::vector<Landing>* landings_;
+  LandingClassifier classifier_;
+};
+
+// Replays one trace, driven by the recorded sim time.
+void Analyze(const std::string& filename, TraceResult& result) {
+  FlightRecordMap records;
+  if (!records.Open(filename))
+    return;
+
+  BatchClient client(&result.landings);
+  FlightData flight_data;
+  FlightTracker tracker(&client, &flight_data);
+
+  FlightSnapshot snapshot;
+  float prev_time = 0;
+  for (size_t n = 0; n < records.size(); ++n) {
+    records[n].ToSnapshot(snapshot);
+    float elapsed = n ? snapshot.time - prev_time : 0.0f;
+    prev_time = snapshot.time;
+    tracker.Update(snapshot, elapsed);
+  }
+
+  result.sample_count = records.size();
+  result.ok = true;
+}
+
+// Adds |path| or the traces anywhere under it to |filenames|.
+bool FindTraces(const std::string& path, std::vector<std::string>& filenames) {
+  std::error_code ec;
+  if (!std::filesystem::is_directory(path, ec)) {
+    if (!std::filesystem::exists(path, ec)) {
+      fprintf(stderr, "Could not find '%s'.\n", path.c_str());
+      return false;
+    }
+    filenames.push_back(path);
+    return true;
+  }
+
+  // Sorted, so that the report does not depend on the directory order
+  std::vector<std::string> found;
+  std::filesystem::recursive_directory_iterator it(path, ec), end;
+  for (; !ec && it != end; it.increment(ec)) {
+    if (it->is_regular_file(ec) && it->path().extension() == kTraceExtension)
+      found.push_back(it->path().string());
+  }
+  if (ec) {
+    fprintf(stderr, "Could not read '%s': %s.\n", path.c_str(), ec.message().c_str());
+    return false;
+  }
+
+  std::sort(found.begin(), found.end());
+  filenames.insert(filenames.end(), found.begin(), found.end());
+  return true;
+}
+
+void WriteJsonString(FILE* file, const std::string& text) {
+  fputc('"', file);
+  for (unsigned char c : text) {
+    if (c == '"' || c == '\\') {
+      fprintf(file, "\\%c", c);
+    } else
+    if (c < 0x20) {
+      fprintf(file, "\\u%04x", c);
+    } else {
+      fputc(c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+void WriteCsv(FILE* file, const std::vector<std::string>& filenames,
+              const std::vector<TraceResult>& results) {
+  fprintf(file, "file,contact_time,vertical_speed_fpm,ground_speed_kts,gforce,"
+                "peak_vertical_speed_fpm,lat,lon,heading,quality\n");
+
+  for (size_t n = 0; n < filenames.size(); ++n) {
+    for (const Landing& landing : results[n].landings) {
+      const LandingInfo& info = landing.info;
+      // Quote the file name, doubling any quotes in it
+      std::string filename = filenames[n];
+      for (size_t pos = 0; (pos = filename.find('"', pos)) != std::string::npos; pos += 2)
+        filename.insert(pos, 1, '"');
+      fprintf(file, "\"%s\",%.2f,%.1f,%.1f,%.2f,%.1f,%.7f,%.7f,%.1f,%s\n",
+              filename.c_str(), info.contact_time,
+              MetersPerSecondToFeetPerMinute(info.vertical_speed),
+              MetersPerSecondToKnots(info.ground_speed),
+              info.gforce,
+              MetersPerSecondToFeetPerMinute(info.peak_vertical_speed),
+              info.lat, info.lon, info.heading,
+              landing.quality < 0 ? "" : LandingQualityName(landing.quality));
+    }
+  }
+}
+
+void WriteJson(FILE* file, const std::vector<std::string>& filenames,
+               const std::vector<TraceResult>& results, const Totals& totals) {
+  fprintf(file, "{\n  \"traces\": [");
+  for (size_t n = 0; n < filenames.size(); ++n) {
+    const TraceResult& result = results[n];
+    fprintf(file, "%s\n    {\"file\": ", n ? "," : "");
+    WriteJsonString(file, filenames[n]);
+    if (!result.ok) {
+      fprintf(file, ", \"error\": \"could not read\"}");
+      continue;
+    }
+
+    fprintf(file, ", \"samples\": %zu, \"landings\": [", result.sample_count);
+    for (size_t l = 0; l < result.landings.size(); ++l) {
+      const Landing& landing = result.landings[l];
+      const LandingInfo& info = landing.info;
+      fprintf(file, "%s\n      {\"contact_time\": %.2f, \"vertical_speed_fpm\": %.1f,"
+                    " \"ground_speed_kts\": %.1f, \"gforce\": %.2f,"
+                    " \"peak_vertical_speed_fpm\": %.1f, \"lat\": %.7f, \"lon\": %.7f,"
+                    " \"heading\": %.1f, \"quality\": ",
+              l ? "," : "", info.contact_time,
+              MetersPerSecondToFeetPerMinute(info.vertical_speed),
+              MetersPerSecondToKnots(info.ground_speed),
+              info.gforce,
+              MetersPerSecondToFeetPerMinute(info.peak_vertical_speed),
+              info.lat, info.lon, info.heading);
+      if (landing.quality < 0) {
+        fprintf(file, "null}");
+      } else {
+        WriteJsonString(file, LandingQualityName(landing.quality));
+        fputc('}', file);
+      }
+    }
+    fprintf(file, "%s]}", result.landings.empty() ? "" : "\n    ");
+  }
+
+  fprintf(file, "\n  ],\n  \"totals\": {\"traces\": %zu, \"failed\": %zu, \"samples\": %zu,"
+                " \"landings\": %zu,\n    \"quality\": {",
+          totals.trace_count, totals.failed_count, totals.sample_count,
+          totals.landing_count);
+  for (int n = 0; n < LandingQualityCount(); ++n) {
+    fprintf(file, "%s", n ? ", " : "");
+    WriteJsonString(file, LandingQualityName(n));
+    fprintf(file, ": %zu", totals.quality_counts[n]);
+  }
+
+  float values[numbof(kReportQuantiles)];
+  totals.vertical_speed.GetQuantiles(kReportQuantiles, numbof(kReportQuantiles), values);
+  fprintf(file, "},\n    \"vertical_speed_fpm\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f}}\n}\n",
+          MetersPerSecondToFeetPerMinute(values[0]),
+          MetersPerSecondToFeetPerMinute(values[1]),
+          MetersPerSecondToFeetPerMinute(values[2]));
+}
+
+void PrintTotals(const Totals& totals, double seconds, unsigned thread_count) {
+  fprintf(stderr, "%zu traces (%zu failed), %zu samples, %zu landings"
+                  " in %.3f sec on %u threads, %.0f samples/sec\n",
+          totals.trace_count, totals.failed_count, totals.sample_count,
+          totals.landing_count, seconds, thread_count,
+          seconds > 0 ? totals.sample_count / seconds : 0.0);
+
+  for (int n = 0; n < LandingQualityCount(); ++n) {
+    if (totals.quality_counts[n])
+      fprintf(stderr, "  %-20s %zu\n", LandingQualityName(n), totals.quality_counts[n]);
+  }
+
+  if (!totals.vertical_speed.empty()) {
+    float values[numbof(kReportQuantiles)];
+    totals.vertical_speed.GetQuantiles(kReportQuantiles, numbof(kReportQuantiles), values);
+    fprintf(stderr, "  Vy p50=%.1f fpm  p90=%.1f fpm  p99=%.1f fpm\n",
+            MetersPerSecondToFeetPerMinute(values[0]),
+            MetersPerSecondToFeetPerMinute(values[1]),
+            MetersPerSecondToFeetPerMinute(values[2]));
+  }
+}
+
+void Usage() {
+  fprintf(stderr, "Usage: BatchAnalysis [-j threads] [-f csv|json] [-o report]"
+                  " (trace.lxr|dir)...\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  unsigned thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  Format format = Format::csv;
+  std::string report_filename;
+  std::vector<std::string> paths;
+
+  for (int n = 1; n < argc; ++n) {
+    if (!strcmp(argv[n], "-j") && n + 1 < argc) {
+      thread_count = static_cast<unsigned>(std::max(atoi(argv[++n]), 0));
+    } else
+    if (!strcmp(argv[n], "-f") && n + 1 < argc) {
+      std::string name = argv[++n];
+      if (name == "csv") {
+        format = Format::csv;
+      } else
+      if (name == "json") {
+        format = Format::json;
+      } else {
+        Usage();
+        return 2;
+      }
+    } else
+    if (!strcmp(argv[n], "-o") && n + 1 < argc) {
+      report_filename = argv[++n];
+    } else
+    if (argv[n][0] == '-') {
+      Usage();
+      return 2;
+    } else {
+      paths.push_back(argv[n]);
+    }
+  }
+
+  if (paths.empty() || thread_count < 1) {
+    Usage();
+    return 2;
+  }
+
+  std::vector<std::string> filenames;
+  for (const std::string& path : paths) {
+    if (!FindTraces(path, filenames))
+      return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  // Threads take the next trace until there are none left, each filling in
+  // its own result slot, so nothing is shared but the counter
+  std::vector<TraceResult> results(filenames.size());
+  thread_count = static_cast<unsigned>(
+      std::min<size_t>(thread_count, std::max<size_t>(filenames.size(), 1)));
+  std::vector<Totals> totals(thread_count);
+  std::atomic<size_t> next_trace{0};
+
+  auto worker = [&](unsigned index) {
+    for (;;) {
+      size_t trace = next_trace++;
+      if (trace >= filenames.size())
+        break;
+      Analyze(filenames[trace], results[trace]);
+      totals[index].Add(results[trace]);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned n = 1; n < thread_count; ++n)
+    threads.emplace_back(worker, n);
+  worker(0);
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (unsigned n = 1; n < thread_count; ++n)
+    totals[0].Merge(totals[n]);
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  FILE* file = stdout;
+  if (!report_filename.empty()) {
+    file = fopen(report_filename.c_str(), "w");
+    if (!file) {
+      fprintf(stderr, "Could not create '%s'.\n", report_filename.c_str());
+      return 1;
+    }
+  }
+
+  switch (format) {
+    case Format::csv:
+      WriteCsv(file, filenames, results);
+      break;
+    case Format::json:
+      WriteJson(file, filenames, results, totals[0]);
+      break;
+  }
+
+  bool write_failed = ferror(file) != 0;
+  if (file != stdout)
+    write_failed = fclose(file) != 0 || write_failed;
+  if (write_failed) {
+    fprintf(stderr, "Could not write the report.\n");
+    return 1;
+  }
+
+  PrintTotals(totals[0], elapsed.count(), thread_count);
+
+  return totals[0].failed_count ? 1 : 0;
+}
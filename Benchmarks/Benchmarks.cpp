@@ -0,0 +1,461 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Hot path microbenchmarks.
+//
+// Usage: Benchmarks [--benchmark_filter=<regex>]
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "Canvas.h"
+#include "FlightData.h"
+#include "FlightMath.h"
+#include "FlightPathCache.h"
+#include "GlideSlope.h"
+#include "LandingLog.h"
+#include "Settings.h"
+#include "TrafficTracker.h"
+
+using namespace xplmpp;
+
+namespace {
+
+static const double kLandingLat = 47.4647;
+static const double kLandingLon = 8.5492;
+static const float kLandingHeading = 140.0f;
+static const float kApproachSpeed = 70.0f;  // meters/sec
+static const float kRolloutDeceleration = 2.0f;  // meters/sec^2
+static const float kTan3 = 0.05240778f;
+
+// Every n-th sample repeats the previous one, like the sim does when the
+// flight loop runs faster than the flight model.
+static const size_t kRepeatPeriod = 8;
+
+static const RectF kGlideSlopeRect(0.0f, 300.0f, 465.0f, 150.0f);
+
+// Discards everything drawn to it
+class NullCanvas : public Canvas {
+public:
+  void SetLineWidth(float) override {}
+  void SetColor(const float*) override {}
+  void Begin(Primitive) override {}
+  void Vertex(float x, float y) override { benchmark::DoNotOptimize(x + y); }
+  void End() override {}
+  void GetFontDimensions(int* char_width, int* char_height) override {
+    *char_width = 8;
+    *char_height = 12;
+  }
+  void DrawString(const float*, int, int, const char*) override {}
+
+  using Canvas::Vertex;
+};
+
+// Counts the traffic landings
+class NullClient : public FlightLoopClient {
+public:
+  void OnFlightLoopTick() override {}
+  void OnAirplaneFlying(const FlyingInfo&) override {}
+  void OnAirplaneLanded(const LandingInfo&) override {}
+  void OnLandingAnalyzed(const LandingAnalysis&) override {}
+  void OnTrafficLanded(int, const std::string&, const LandingInfo&) override {
+    ++landing_count;
+  }
+
+  size_t landing_count = 0;
+};
+
+// Moves |distance| meters from the landing point along the landing heading
+void Offset(float distance, double* lat, double* lon) {
+  double heading = DegreeToRadian(kLandingHeading);
+  double north = distance * cos(heading);
+  double east = distance * sin(heading);
+  *lat = kLandingLat + north / 111120.0;
+  *lon = kLandingLon + east / (111120.0 * cos(DegreeToRadian(kLandingLat)));
+}
+
+// Makes |count| samples of a 3 degree approach followed by the landing roll
+// when |landing| is set, spread over one nautical mile of approach so that
+// the whole dataset stays within the glide slope view.
+std::vector<Data> MakeFlight(size_t count, bool landing) {
+  std::vector<Data> flight;
+  flight.reserve(count);
+
+  size_t approach_count = landing ? count * 3 / 4 : count;
+  float approach_distance = kNmToMeters;
+  float step = approach_distance / approach_count;
+  float dt = step / kApproachSpeed;
+
+  float time = 0.0f;
+  float ground_speed = kApproachSpeed;
+  float distance = -approach_distance;
+  for (size_t n = 0; n < count; ++n) {
+    if (n && n % kRepeatPeriod == 0) {
+      flight.push_back(flight.back());
+      flight.back().time = time;
+      time += dt;
+      distance += step;
+      continue;
+    }
+
+    bool flying = n < approach_count;
+    if (!flying) {
+      ground_speed = std::max(ground_speed - kRolloutDeceleration * dt, 1.0f);
+      step = ground_speed * dt;
+    }
+
+    double lat, lon;
+    Offset(distance, &lat, &lon);
+    float agl = flying ? -distance * kTan3 : 0.0f;
+    float vertical_speed = flying ? -kApproachSpeed * kTan3 : 0.0f;
+    flight.emplace_back(time, ground_speed, vertical_speed, agl,
+                        MetersToFeet(agl) + 1400.0f, lat, lon,
+                        kLandingHeading, flying);
+
+    time += dt;
+    distance += step;
+  }
+
+  return flight;
+}
+
+// Fills |flight_data| with |flight| and no history limits
+void Fill(FlightData& flight_data, const std::vector<Data>& flight) {
+  flight_data = FlightData(flight.size());
+  flight_data.set_history_limits(0.0f, 0.0f);
+  for (const Data& data : flight)
+    flight_data.Add(data);
+}
+
+// Fills the global flight data with a landing followed by |count| samples of
+// another approach to the same runway.
+void FillApproach(size_t count) {
+  std::vector<Data> approach = MakeFlight(count, false);
+
+  g_flight_data = FlightData(count + 2);
+  g_flight_data.set_history_limits(0.0f, 0.0f);
+
+  double lat, lon;
+  Offset(0.0f, &lat, &lon);
+  g_flight_data.Add(Data(0.0f, kApproachSpeed, -1.0f, 0.1f, 1400.0f,
+                         lat, lon, kLandingHeading, true));
+  g_flight_data.Add(Data(0.1f, kApproachSpeed, 0.0f, 0.0f, 1400.0f,
+                         lat, lon, kLandingHeading, false));
+  g_flight_data.Reset();
+
+  for (const Data& data : approach)
+    g_flight_data.Add(data);
+}
+
+void BM_FlightDataAdd(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  std::vector<Data> flight = MakeFlight(count, true);
+
+  FlightData flight_data(count);
+  flight_data.set_history_limits(0.0f, 0.0f);
+  for (auto _ : state) {
+    flight_data.Reset();
+    for (const Data& data : flight)
+      flight_data.Add(data);
+    benchmark::DoNotOptimize(flight_data.size());
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_FlightDataAdd)->Range(1 << 10, 1 << 20);
+
+// Same as above, but with the default 3nm history limit and capacity, so
+// that samples keep sliding out of the window.
+void BM_FlightDataAddLimited(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  std::vector<Data> flight = MakeFlight(count, true);
+
+  FlightData flight_data;
+  for (auto _ : state) {
+    flight_data.Reset();
+    for (const Data& data : flight)
+      flight_data.Add(data);
+    benchmark::DoNotOptimize(flight_data.size());
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_FlightDataAddLimited)->Range(1 << 10, 1 << 20);
+
+// Adds samples that are all within the difference threshold of the last
+// one, which only exercises the data difference check.
+void BM_DataDifference(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  std::vector<Data> flight = MakeFlight(1, false);
+  Data data = flight.front();
+
+  FlightData flight_data;
+  flight_data.Add(data);
+  for (auto _ : state) {
+    for (size_t n = 0; n < count; ++n) {
+      data.time += 0.05f;
+      flight_data.Add(data);
+    }
+    benchmark::DoNotOptimize(flight_data.back().time);
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_DataDifference)->Range(1 << 10, 1 << 20);
+
+void BM_CalcEarthDistance(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  std::vector<Data> flight = MakeFlight(count, false);
+
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (const Data& data : flight)
+      sum += CalcEarthDistance(kLandingLat, kLandingLon, data.lat, data.lon);
+    benchmark::DoNotOptimize(sum);
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_CalcEarthDistance)->Range(1 << 10, 1 << 20);
+
+void BM_CalcEarthDistances(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  std::vector<Data> flight = MakeFlight(count, false);
+  std::vector<double> lat(count), lon(count), distance(count);
+  for (size_t n = 0; n < count; ++n) {
+    lat[n] = flight[n].lat;
+    lon[n] = flight[n].lon;
+  }
+
+  for (auto _ : state) {
+    CalcEarthDistances(kLandingLat, kLandingLon, &lat[0], &lon[0], count, &distance[0]);
+    benchmark::DoNotOptimize(distance[count - 1]);
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_CalcEarthDistances)->Range(1 << 10, 1 << 20);
+
+void BM_CalcEarthDistancesFast(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  std::vector<Data> flight = MakeFlight(count, false);
+  std::vector<double> lat(count), lon(count);
+  std::vector<float> distance(count);
+  for (size_t n = 0; n < count; ++n) {
+    lat[n] = flight[n].lat;
+    lon[n] = flight[n].lon;
+  }
+
+  for (auto _ : state) {
+    CalcEarthDistancesFast(kLandingLat, kLandingLon, &lat[0], &lon[0], count, &distance[0]);
+    benchmark::DoNotOptimize(distance[count - 1]);
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_CalcEarthDistancesFast)->Range(1 << 10, 1 << 20);
+
+// Builds the flight path from scratch on every frame
+void BM_DrawFlightPath(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  Fill(g_flight_data, MakeFlight(count, true));
+
+  NullCanvas canvas;
+  for (auto _ : state) {
+    GlideSlope glide_slope;
+    glide_slope.SetRect(kGlideSlopeRect);
+    glide_slope.Draw(canvas);
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+  g_flight_data = FlightData();
+}
+BENCHMARK(BM_DrawFlightPath)->Range(1 << 10, 1 << 20);
+
+// Redraws the flight path with the view, its layout and caches kept between frames
+void BM_DrawFlightPathCached(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  Fill(g_flight_data, MakeFlight(count, true));
+
+  NullCanvas canvas;
+  GlideSlope glide_slope;
+  for (auto _ : state) {
+    glide_slope.SetRect(kGlideSlopeRect);
+    glide_slope.Draw(canvas);
+  }
+
+  g_flight_data = FlightData();
+}
+BENCHMARK(BM_DrawFlightPathCached)->Range(1 << 10, 1 << 20);
+
+// Redraws the flight path zoomed in on the flare, and zoomed out and panned
+// along the approach, with the path summaries kept between frames
+void BM_DrawFlightPathZoomed(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  Fill(g_flight_data, MakeFlight(count, true));
+
+  GlideSlopeView flare_view;
+  flare_view.zoom = 16.0f;
+  GlideSlopeView approach_view;
+  approach_view.zoom = 0.25f;
+  approach_view.pan = kNmToMeters;
+
+  NullCanvas canvas;
+  GlideSlope flare;
+  flare.SetView(flare_view);
+  GlideSlope approach;
+  approach.SetView(approach_view);
+  for (auto _ : state) {
+    flare.SetRect(kGlideSlopeRect);
+    flare.Draw(canvas);
+    approach.SetRect(kGlideSlopeRect);
+    approach.Draw(canvas);
+  }
+
+  g_flight_data = FlightData();
+}
+BENCHMARK(BM_DrawFlightPathZoomed)->Range(1 << 10, 1 << 20);
+
+// Builds the approach path to the last landing runway from scratch
+void BM_DrawApproachPath(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  FillApproach(count);
+
+  NullCanvas canvas;
+  for (auto _ : state) {
+    GlideSlope glide_slope;
+    glide_slope.SetRect(kGlideSlopeRect);
+    // The first frame only picks up the approach distance trend
+    glide_slope.Draw(canvas);
+    glide_slope.Draw(canvas);
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+  g_flight_data = FlightData();
+}
+BENCHMARK(BM_DrawApproachPath)->Range(1 << 10, 1 << 20);
+
+// Formats a screen of log rows out of a log of the given length
+void BM_FormatLogRows(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  LandingLog log(count);
+
+  LandingInfo landing(30.0f, -1.2f, 12.0f);
+  LandingAnalysis analysis;
+  analysis.has_flare = true;
+  analysis.approach_samples = 100;
+  for (size_t n = 0; n < count; n += 6) {
+    log.AddFlying(FlyingInfo(40.0f, 5.0f, 100.0f, 1500.0f));
+    log.AddLanded(landing, true);
+    log.AddAnalysis(analysis);
+  }
+
+  static const size_t kRows = 15;
+  TextLine row;
+  for (auto _ : state) {
+    for (size_t index = log.size() - kRows; index < log.size(); ++index) {
+      log.Format(index, row);
+      benchmark::DoNotOptimize(row.c_str());
+    }
+  }
+}
+BENCHMARK(BM_FormatLogRows)->Range(1 << 10, 1 << 20);
+
+// Tracks |count| aircraft, each flying its own approach and landing roll
+// over and over, one snapshot per tick
+void BM_TrafficUpdate(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+
+  static const size_t kTicks = 256;
+  std::vector<Data> flight = MakeFlight(kTicks, true);
+
+  std::vector<TrafficSnapshot> snapshots(kTicks);
+  for (size_t tick = 0; tick < kTicks; ++tick) {
+    TrafficSnapshot& snapshot = snapshots[tick];
+    snapshot.time = flight[tick].time;
+    snapshot.count = count + 1;
+    for (size_t slot = 1; slot <= count; ++slot) {
+      const Data& data = flight[(tick + slot * 7) % kTicks];
+      snapshot.id[slot] = static_cast<int>(0xA00000 + slot);
+      snprintf(snapshot.type[slot], TrafficSnapshot::kTypeLength, "B738");
+      snapshot.lat[slot] = data.lat + slot * 0.01;
+      snapshot.lon[slot] = data.lon;
+      snapshot.agl[slot] = data.agl;
+      snapshot.msl[slot] = data.msl;
+      snapshot.ground_speed[slot] = data.ground_speed;
+      snapshot.vertical_speed[slot] = data.vertical_speed;
+      snapshot.heading[slot] = data.heading;
+      snapshot.on_ground[slot] = !data.flying;
+    }
+  }
+
+  NullClient client;
+  TrafficTracker tracker(&client);
+  size_t tick = 0;
+  for (auto _ : state) {
+    tracker.Update(snapshots[tick]);
+    tick = (tick + 1) % kTicks;
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+  benchmark::DoNotOptimize(client.landing_count);
+}
+BENCHMARK(BM_TrafficUpdate)->Arg(8)->Arg(32)->Arg(63);
+
+// Loads a settings file |count| lines long
+void BM_SettingsLoad(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+
+  static const char* kLines[] = {
+    "# approach view",
+    "runway_distance = 0.5 nm",
+    "approach_distance = 3 nm",
+    "vertical_grid = 0.25 mi",
+    "horizontal_grid = 50 ft",
+    "history_distance = 5 km",
+    "history_time = 10 min",
+    "flare_height = 50 ft",
+  };
+
+  std::string filename = "BenchmarkSettings.prf";
+  FILE* file = fopen(filename.c_str(), "wt");
+  if (!file) {
+    state.SkipWithError("Could not create the settings file");
+    return;
+  }
+  for (size_t n = 0; n < count; ++n)
+    fprintf(file, "%s\n", kLines[n % numbof(kLines)]);
+  fclose(file);
+
+  for (auto _ : state) {
+    Settings settings;
+    benchmark::DoNotOptimize(settings.Load(filename));
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+  remove(filename.c_str());
+}
+BENCHMARK(BM_SettingsLoad)->Range(1 << 10, 1 << 20);
+
+}  // namespace
+
+BENCHMARK_MAIN();
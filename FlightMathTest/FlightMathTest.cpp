@@ -0,0 +1,149 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Flight math tests.
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "xplmpp/Log.h"
+
+#include "FlightMath.h"
+
+using namespace xplmpp;
+
+namespace {
+
+// Single precision loses accuracy close to the antipodes
+static const double kNearAntipodeDistance = 18000e3;  // meters
+static const double kNearAntipodeRelError = 1e-4;
+
+struct ErrorBounds {
+  double abs_error;  // meters
+  double rel_error;
+};
+
+// Checks the batch distances against CalcEarthDistance() for the points
+// spread up to |spread| degrees around each of the reference points.
+bool CheckDistances(const char* name, double spread, size_t count,
+                    const ErrorBounds& bounds, const ErrorBounds& fast_bounds) {
+  std::mt19937 rng(20191);
+  std::uniform_real_distribution<double> random_lat(-89.9, 89.9);
+  std::uniform_real_distribution<double> random_lon(-180.0, 180.0);
+  std::uniform_real_distribution<double> random_offset(-spread, spread);
+
+  double max_error = 0, max_rel_error = 0;
+  double max_fast_error = 0, max_fast_rel_error = 0;
+
+  for (int trial = 0; trial < 100; ++trial) {
+    double lat0 = random_lat(rng);
+    double lon0 = random_lon(rng);
+
+    std::vector<double> lat(count), lon(count);
+    for (size_t n = 0; n < count; ++n) {
+      lat[n] = std::min(std::max(lat0 + random_offset(rng), -90.0), 90.0);
+      lon[n] = lon0 + random_offset(rng);
+      if (lon[n] > 180.0) lon[n] -= 360.0; else
+      if (lon[n] < -180.0) lon[n] += 360.0;
+    }
+
+    // Odd counts exercise the tail handling too
+    size_t batch_count = count - trial % 4;
+
+    std::vector<double> distance(count, -1.0);
+    std::vector<float> fast_distance(count, -1.0f);
+    CalcEarthDistances(lat0, lon0, &lat[0], &lon[0], batch_count, &distance[0]);
+    CalcEarthDistancesFast(lat0, lon0, &lat[0], &lon[0], batch_count, &fast_distance[0]);
+
+    for (size_t n = batch_count; n < count; ++n) {
+      if (distance[n] != -1.0 || fast_distance[n] != -1.0f) {
+        LOG(ERROR) << name << ": wrote past the end of the batch";
+        return false;
+      }
+    }
+
+    for (size_t n = 0; n < batch_count; ++n) {
+      double expected = CalcEarthDistance(lat0, lon0, lat[n], lon[n]);
+
+      double error = fabs(distance[n] - expected);
+      double rel_error = expected > 0 ? error / expected : 0.0;
+      if (error > bounds.abs_error && rel_error > bounds.rel_error) {
+        LOG(ERROR) << name << ": " << lat0 << "," << lon0 << " to "
+                   << lat[n] << "," << lon[n] << " is " << distance[n]
+                   << " m, expected " << expected << " m";
+        return false;
+      }
+      max_error = std::max(max_error, error);
+      max_rel_error = std::max(max_rel_error, rel_error);
+
+      double fast_error = fabs(fast_distance[n] - expected);
+      double fast_rel_error = expected > 0 ? fast_error / expected : 0.0;
+      double fast_rel_bound = expected < kNearAntipodeDistance ?
+          fast_bounds.rel_error : kNearAntipodeRelError;
+      if (fast_error > fast_bounds.abs_error && fast_rel_error > fast_rel_bound) {
+        LOG(ERROR) << name << " (fast): " << lat0 << "," << lon0 << " to "
+                   << lat[n] << "," << lon[n] << " is " << fast_distance[n]
+                   << " m, expected " << expected << " m";
+        return false;
+      }
+      if (expected < kNearAntipodeDistance) {
+        max_fast_error = std::max(max_fast_error, fast_error);
+        max_fast_rel_error = std::max(max_fast_rel_error, fast_rel_error);
+      }
+    }
+  }
+
+  LOG(INFO) << name << ": max error " << max_error << " m (" << max_rel_error
+            << "), fast " << max_fast_error << " m (" << max_fast_rel_error << ")";
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  // Approach and runway distances: a few micrometers, a few centimeters fast
+  if (!CheckDistances("approach", 0.1, 1000, { 5e-6, 1e-12 }, { 0.05, 1e-6 }))
+    return 1;
+
+  // Anywhere on Earth, including the antipodes and across the date line
+  if (!CheckDistances("global", 180.0, 1000, { 5e-6, 1e-12 }, { 0.05, 2e-6 }))
+    return 1;
+
+  // Same point
+  double lat = 47.4647, lon = 8.5492, distance = -1.0;
+  float fast_distance = -1.0f;
+  CalcEarthDistances(lat, lon, &lat, &lon, 1, &distance);
+  CalcEarthDistancesFast(lat, lon, &lat, &lon, 1, &fast_distance);
+  if (distance != 0.0 || fast_distance != 0.0f) {
+    LOG(ERROR) << "Same point distance is " << distance << ", " << fast_distance;
+    return 1;
+  }
+
+  // Heading differences wrap at north
+  if (HeadingDelta(359.0f, 1.0f) != 2.0f || HeadingDelta(1.0f, 359.0f) != 2.0f ||
+      HeadingDelta(90.0f, 270.0f) != 180.0f || HeadingDelta(10.0f, 25.0f) != 15.0f) {
+    LOG(ERROR) << "Heading delta from 359 to 1 is " << HeadingDelta(359.0f, 1.0f);
+    return 1;
+  }
+
+  LOG(INFO) << "DONE!";
+
+  return 0;
+}
@@ -0,0 +1,170 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Landing history tests.
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "xplmpp/Log.h"
+
+#include "LandingHistory.h"
+
+using namespace xplmpp;
+
+namespace {
+
+// LandingIndexHeader::record_count
+static const std::streamoff kIndexRecordCountOffset = 16;
+
+struct Landing {
+  const char* aircraft;
+  double lat;
+  double lon;
+  float vertical_speed;
+};
+
+// Two in the same cell, one next to it and one far away
+static const Landing kLandings[] = {
+  { "C172", 47.45, -122.30, -1.0f },
+  { "B738", 47.46, -122.31, -2.5f },
+  { "C172", 47.90, -121.50, -0.5f },
+  { "C172", 37.62, -122.37, -3.0f },
+  { "B738", 47.44, -122.29, -1.5f },
+};
+
+static const size_t kLandingCount = sizeof(kLandings) / sizeof(kLandings[0]);
+
+LandingRecord MakeRecord(size_t n) {
+  LandingInfo info(60.0f, kLandings[n].vertical_speed, 10.0f);
+  info.lat = kLandings[n].lat;
+  info.lon = kLandings[n].lon;
+  return LandingRecord(info, kLandings[n].aircraft, 1000 + n);
+}
+
+bool Append(const std::string& filename, const std::string& index_filename,
+            size_t begin, size_t end) {
+  LandingHistory history;
+  if (!history.Open(filename, index_filename))
+    return false;
+  for (size_t n = begin; n < end; ++n) {
+    if (!history.Append(MakeRecord(n)))
+      return false;
+  }
+  return true;
+}
+
+// Pretends the index has not counted the last |count| records in, as after a
+// crash between linking a record and updating the index header
+bool UncountRecords(const std::string& index_filename, uint32_t count) {
+  std::fstream file(index_filename, std::ios::in | std::ios::out | std::ios::binary);
+  uint32_t record_count = 0;
+  file.seekg(kIndexRecordCountOffset);
+  file.read(reinterpret_cast<char*>(&record_count), sizeof(record_count));
+  record_count -= count;
+  file.seekp(kIndexRecordCountOffset);
+  file.write(reinterpret_cast<const char*>(&record_count), sizeof(record_count));
+  return !!file;
+}
+
+bool Check(const std::string& name, const std::string& filename,
+           const std::string& index_filename) {
+  LandingHistory history;
+  if (!history.Open(filename, index_filename) || history.size() != kLandingCount) {
+    LOG(ERROR) << name << ": could not open the history";
+    return false;
+  }
+
+  LandingRecord best, worst;
+  if (history.GetCount("C172") != 3 || history.GetCount("B738") != 2 ||
+      !history.GetBest("C172", best) || best.timestamp != 1002 ||
+      !history.GetWorst("B738", worst) || worst.timestamp != 1001) {
+    LOG(ERROR) << name << ": bad aircraft stats, " << history.GetCount("C172")
+               << " C172 and " << history.GetCount("B738") << " B738";
+    return false;
+  }
+
+  // The most recent first
+  std::vector<LandingRecord> records;
+  history.FindInBox(47.0, -123.0, 48.0, -121.0, records);
+  std::vector<int64_t> timestamps;
+  for (const LandingRecord& record : records)
+    timestamps.push_back(record.timestamp);
+  if (timestamps != std::vector<int64_t>{ 1004, 1002, 1001, 1000 }) {
+    LOG(ERROR) << name << ": bad box query, " << records.size() << " landings";
+    return false;
+  }
+
+  history.FindInBox(47.4, -122.35, 47.5, -122.25, records);
+  if (records.size() != 3) {
+    LOG(ERROR) << name << ": bad small box query, " << records.size() << " landings";
+    return false;
+  }
+
+  history.GetLast(2, records);
+  if (records.size() != 2 || records[0].timestamp != 1004 || records[1].timestamp != 1003) {
+    LOG(ERROR) << name << ": bad last landings";
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  std::filesystem::path dir = std::filesystem::temp_directory_path();
+  std::string filename = (dir / "LandEx-LandingHistoryTest.lxh").string();
+  std::string index_filename = (dir / "LandEx-LandingHistoryTest.lxi").string();
+  std::string stale_index_filename = index_filename + ".stale";
+  std::filesystem::remove(filename);
+  std::filesystem::remove(index_filename);
+
+  // Keep the index as of three landings, then add the rest
+  if (!Append(filename, index_filename, 0, 3))
+    return 1;
+  std::filesystem::copy_file(index_filename, stale_index_filename,
+                             std::filesystem::copy_options::overwrite_existing);
+  if (!Append(filename, index_filename, 3, kLandingCount))
+    return 1;
+
+  bool ok = Check("up to date", filename, index_filename);
+
+  // Records indexed but not counted in get indexed once only
+  ok = ok && UncountRecords(index_filename, 2) &&
+       Check("uncounted", filename, index_filename) &&
+       Check("uncounted reopened", filename, index_filename);
+
+  // An index behind the history catches up
+  std::filesystem::copy_file(stale_index_filename, index_filename,
+                             std::filesystem::copy_options::overwrite_existing);
+  ok = ok && Check("stale", filename, index_filename) &&
+       Check("stale reopened", filename, index_filename);
+
+  std::filesystem::remove(filename);
+  std::filesystem::remove(index_filename);
+  std::filesystem::remove(stale_index_filename);
+
+  if (!ok)
+    return 1;
+
+  LOG(INFO) << "DONE!";
+
+  return 0;
+}
@@ -0,0 +1,208 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Quantile sketch and landing stats tests.
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "xplmpp/Log.h"
+
+#include "LandingStats.h"
+#include "LandingStatsWriter.h"
+#include "QuantileSketch.h"
+
+using namespace xplmpp;
+
+namespace {
+
+static const float kMaxRelError = 0.01f;  // as stated by QuantileSketch
+static const float kQuantiles[] = { 0.05f, 0.5f, 0.9f, 0.95f, 0.99f };
+static const size_t kQuantileCount = sizeof(kQuantiles) / sizeof(kQuantiles[0]);
+static const size_t kValueCount = 100000;
+
+// Returns the value at |quantile| of the sorted |values|, ranked the same
+// way the sketch does
+float GetReference(const std::vector<float>& values, float quantile) {
+  return values[static_cast<size_t>(quantile * (values.size() - 1))];
+}
+
+bool CheckQuantiles(const std::string& name, const QuantileSketch& sketch,
+                    std::vector<float> values) {
+  std::sort(values.begin(), values.end());
+  if (sketch.count() != values.size()) {
+    LOG(ERROR) << name << ": count " << sketch.count() << ", expected " << values.size();
+    return false;
+  }
+
+  float estimates[kQuantileCount];
+  sketch.GetQuantiles(kQuantiles, kQuantileCount, estimates);
+  for (size_t n = 0; n < kQuantileCount; ++n) {
+    float reference = GetReference(values, kQuantiles[n]);
+    float rel_error = fabs(estimates[n] - reference) / reference;
+    if (rel_error > kMaxRelError || estimates[n] != sketch.GetQuantile(kQuantiles[n])) {
+      LOG(ERROR) << name << ": p" << kQuantiles[n] * 100 << " is " << estimates[n]
+                 << ", expected " << reference;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SameBuckets(const QuantileSketch& sketch, const QuantileSketch& sketch2) {
+  if (sketch.count() != sketch2.count())
+    return false;
+  for (int n = 0; n < QuantileSketch::kBucketCount; ++n) {
+    if (sketch.bucket(n) != sketch2.bucket(n))
+      return false;
+  }
+  return true;
+}
+
+bool TestSketch() {
+  // Descent rates, skewed toward the soft landings
+  std::mt19937 rng(20191);
+  std::lognormal_distribution<float> distribution(0.0f, 0.6f);
+  std::vector<float> values(kValueCount);
+  for (float& value : values)
+    value = distribution(rng);
+
+  QuantileSketch sketch;
+  for (float value : values)
+    sketch.Add(value);
+  if (!CheckQuantiles("sketch", sketch, values))
+    return false;
+
+  // Merging the halves is the same as adding it all to one sketch
+  QuantileSketch first, second;
+  for (size_t n = 0; n < values.size(); ++n)
+    (n < values.size() / 2 ? first : second).Add(values[n]);
+  first.Merge(second);
+  if (!SameBuckets(first, sketch)) {
+    LOG(ERROR) << "merge: buckets differ";
+    return false;
+  }
+
+  // Empty, and out of range values end up in the end buckets
+  QuantileSketch edges;
+  if (edges.GetQuantile(0.5f) != 0) {
+    LOG(ERROR) << "empty: p50 is " << edges.GetQuantile(0.5f);
+    return false;
+  }
+  edges.Add(0.0f);
+  edges.Add(1e9f);
+  if (edges.GetQuantile(0.0f) != 0 || edges.GetQuantile(1.0f) < 10000.0f) {
+    LOG(ERROR) << "edges: " << edges.GetQuantile(0.0f) << ".." << edges.GetQuantile(1.0f);
+    return false;
+  }
+
+  return true;
+}
+
+bool SameSummary(const LandingSummary& summary, const LandingSummary& summary2) {
+  for (size_t n = 0; n < LandingSummary::kQuantileCount; ++n) {
+    if (summary.vertical_speed[n] != summary2.vertical_speed[n] ||
+        summary.gforce[n] != summary2.gforce[n] ||
+        summary.ground_speed[n] != summary2.ground_speed[n])
+      return false;
+  }
+  return summary.count == summary2.count;
+}
+
+bool TestStats() {
+  std::mt19937 rng(2019);
+  std::lognormal_distribution<float> vertical_speed(0.0f, 0.6f);
+  std::normal_distribution<float> gforce(12.0f, 1.5f);
+  std::normal_distribution<float> ground_speed(60.0f, 5.0f);
+
+  LandingStats stats;
+  std::vector<float> b738_vertical_speeds;
+  for (int n = 0; n < 1000; ++n) {
+    bool b738 = n % 4 != 0;
+    LandingInfo info(ground_speed(rng), -vertical_speed(rng), gforce(rng));
+    stats.Add(LandingRecord(info, b738 ? "B738" : "C172", 1000 + n));
+    if (b738)
+      b738_vertical_speeds.push_back(-info.vertical_speed);
+  }
+
+  LandingSummary b738, c172;
+  if (!stats.GetSummary("B738", b738) || !stats.GetSummary("C172", c172) ||
+      b738.count != 750 || c172.count != 250) {
+    LOG(ERROR) << "stats: bad counts";
+    return false;
+  }
+
+  std::sort(b738_vertical_speeds.begin(), b738_vertical_speeds.end());
+  for (size_t n = 0; n < LandingSummary::kQuantileCount; ++n) {
+    float reference = GetReference(b738_vertical_speeds, LandingSummary::kQuantiles[n]);
+    if (fabs(b738.vertical_speed[n] - reference) / reference > kMaxRelError) {
+      LOG(ERROR) << "stats: p" << LandingSummary::kQuantiles[n] * 100 << " is "
+                 << b738.vertical_speed[n] << ", expected " << reference;
+      return false;
+    }
+  }
+
+  // Saved and loaded back the same, loading again adds up
+  std::string filename =
+      (std::filesystem::temp_directory_path() / "LandEx-QuantileSketchTest.lxs").string();
+  LandingStats loaded;
+  LandingSummary loaded_b738, loaded_c172, twice_b738;
+  bool ok = stats.Save(filename) && loaded.Load(filename) &&
+            loaded.GetSummary("B738", loaded_b738) && SameSummary(loaded_b738, b738) &&
+            loaded.GetSummary("C172", loaded_c172) && SameSummary(loaded_c172, c172) &&
+            loaded.Load(filename) && loaded.GetSummary("B738", twice_b738) &&
+            twice_b738.count == 2 * b738.count &&
+            twice_b738.vertical_speed[1] == b738.vertical_speed[1];
+  std::filesystem::remove(filename);
+  if (!ok) {
+    LOG(ERROR) << "stats: bad save/load round trip";
+    return false;
+  }
+
+  // The writer saves the latest copy by the time it stops
+  LandingStatsWriter writer;
+  writer.Start(filename);
+  writer.Save(LandingStats());
+  writer.Save(stats);
+  writer.Stop();
+  LandingStats written;
+  LandingSummary written_b738;
+  ok = written.Load(filename) && written.GetSummary("B738", written_b738) &&
+       SameSummary(written_b738, b738) && !writer.TakeFailures();
+  std::filesystem::remove(filename);
+  if (!ok) {
+    LOG(ERROR) << "stats: writer did not save the latest stats";
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  if (!TestSketch() || !TestStats())
+    return 1;
+
+  LOG(INFO) << "DONE!";
+
+  return 0;
+}
@@ -0,0 +1,219 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Runway database tests.
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xplmpp/Log.h"
+
+#include "FlightData.h"
+#include "RunwayDatabase.h"
+
+using namespace xplmpp;
+
+namespace {
+
+static const double kMetersPerDegree = 111195.0;  // of latitude, roughly
+static const float kDistanceTolerance = 2.0f;     // meters
+
+// A north-south runway with a displaced threshold on 34R, a seaplane base
+// whose runway row must not be taken, a runway row short of fields, and a
+// runway right on north.
+static const char kAptDat[] =
+    "I\n"
+    "1100 Generated by WorldEditor\n"
+    "\n"
+    "1   433 0 0 KSEA Seattle Tacoma Intl\n"
+    "100 45.72 1 0 0.25 1 2 1 16L 47.46373076 -122.30800000 0.00 0.00 3 0 0 1"
+    " 34R 47.43186487 -122.30800000 304.80 0.00 3 0 0 1\r\n"
+    "110 1 0.25 0.00 Taxiway\n"
+    "111 47.46 -122.30\n"
+    "100 45.72 1 0 0.25 1 2 1 16C 47.46 -122.31\n"
+    "16  0 0 0 W55 Seaplane base\n"
+    "100 30 1 0 0.25 0 0 0 18 47.60 -122.30 0 0 1 0 0 0 36 47.58 -122.30 0 0 1 0 0 0\n"
+    "1   100 0 0 NRTH Right on north\n"
+    "100 30 1 0 0.25 0 0 0 36 60.00 10.00 0 0 1 0 0 0 18 60.02 10.00 0 0 1 0 0 0\n"
+    "99\n";
+
+bool Near(float value, float expected, float tolerance) {
+  return fabs(value - expected) <= tolerance;
+}
+
+const RunwayEnd* FindEnd(const std::vector<RunwayEnd>& runways, const char* airport,
+                         const char* runway) {
+  for (const RunwayEnd& end : runways) {
+    if (end.airport_code() == airport && end.runway_number() == runway)
+      return &end;
+  }
+  return nullptr;
+}
+
+bool TestParse() {
+  for (unsigned thread_count = 1; thread_count <= 4; ++thread_count) {
+    std::vector<RunwayEnd> runways;
+    RunwayDatabase::Parse(kAptDat, sizeof(kAptDat) - 1, thread_count, runways);
+    if (runways.size() != 4) {
+      LOG(ERROR) << "Parse: " << runways.size() << " runway ends on "
+                 << thread_count << " threads";
+      return false;
+    }
+
+    const RunwayEnd* r16l = FindEnd(runways, "KSEA", "16L");
+    const RunwayEnd* r34r = FindEnd(runways, "KSEA", "34R");
+    const RunwayEnd* r36 = FindEnd(runways, "NRTH", "36");
+    if (!r16l || !r34r || !r36 || !FindEnd(runways, "NRTH", "18")) {
+      LOG(ERROR) << "Parse: runway ends missing";
+      return false;
+    }
+
+    float length = static_cast<float>((47.46373076 - 47.43186487) * kMetersPerDegree);
+    double displaced_lat = 47.43186487 + 304.8 / kMetersPerDegree;
+    if (!Near(r16l->heading, 180.0f, 0.01f) || r16l->displaced != 0 ||
+        !Near(r16l->length, length, 10.0f) || r16l->width != 45.72f ||
+        r16l->lat != 47.46373076 || r16l->lon != -122.308 ||
+        !Near(fmod(r34r->heading, 360.0f), 0.0f, 0.01f) || r34r->displaced != 304.8f ||
+        !Near(r34r->length, length - 304.8f, 10.0f) ||
+        fabs(r34r->lat - displaced_lat) * kMetersPerDegree > 1.0 ||
+        !Near(fmod(r36->heading, 360.0f), 0.0f, 0.01f)) {
+      LOG(ERROR) << "Parse: bad runway ends, 16L heading " << r16l->heading
+                 << " length " << r16l->length << ", 34R heading " << r34r->heading
+                 << " length " << r34r->length;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool ExpectRunway(const RunwayDatabase& database, const char* name, double lat, double lon,
+                  float heading, const char* runway, float distance, float offset) {
+  RunwayMatch match;
+  bool found = database.FindRunway(lat, lon, heading, match);
+  if (!runway) {
+    if (found) {
+      LOG(ERROR) << name << ": unexpected runway " << match.runway->runway_number();
+      return false;
+    }
+    return true;
+  }
+
+  if (!found || match.runway->runway_number() != runway ||
+      !Near(match.distance, distance, kDistanceTolerance) ||
+      !Near(match.offset, offset, kDistanceTolerance)) {
+    LOG(ERROR) << name << ": " << (found ? match.runway->runway_number() : "no runway")
+               << " at " << match.distance << " m, " << match.offset << " m off";
+    return false;
+  }
+  return true;
+}
+
+bool TestFindRunway() {
+  std::filesystem::path dir = std::filesystem::temp_directory_path();
+  std::string apt_dat_filename = (dir / "LandEx-RunwayDatabaseTest.dat").string();
+  std::string cache_filename = (dir / "LandEx-RunwayDatabaseTest.lxc").string();
+  std::filesystem::remove(cache_filename);
+  std::ofstream(apt_dat_filename, std::ios::binary) << kAptDat;
+
+  RunwayDatabase database;
+  bool ok = database.Open(apt_dat_filename, cache_filename);
+  for (int n = 0; ok && n < 500 && !database.is_ready(); ++n) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    database.Update();
+  }
+
+  double threshold_34r = 47.43186487 + 304.8 / kMetersPerDegree;
+  double meters_east = 1.0 / (kMetersPerDegree * cos(47.45 * M_PI / 180.0));
+  ok = ok && database.is_ready() && database.size() == 4 &&
+       ExpectRunway(database, "16L", 47.46373076 - 500.0 / kMetersPerDegree, -122.308,
+                    181.0f, "16L", 500.0f, 0.0f) &&
+       ExpectRunway(database, "16L right of centerline",
+                    47.46373076 - 500.0 / kMetersPerDegree, -122.308 - 10.0 * meters_east,
+                    178.0f, "16L", 500.0f, 10.0f) &&
+       ExpectRunway(database, "34R past north", threshold_34r + 200.0 / kMetersPerDegree,
+                    -122.308, 359.5f, "34R", 200.0f, 0.0f) &&
+       ExpectRunway(database, "34R short", threshold_34r - 100.0 / kMetersPerDegree,
+                    -122.308, 2.0f, "34R", -100.0f, 0.0f) &&
+       ExpectRunway(database, "off the runway", 47.45, -122.308 + 100.0 * meters_east,
+                    180.0f, nullptr, 0, 0) &&
+       ExpectRunway(database, "crosswise", 47.45, -122.308, 90.0f, nullptr, 0, 0) &&
+       ExpectRunway(database, "seaplane base", 47.59, -122.30, 0.0f, nullptr, 0, 0);
+
+  // Reopening loads the cache without parsing
+  database.Close();
+  ok = ok && database.Open(apt_dat_filename, cache_filename) && database.is_ready() &&
+       ExpectRunway(database, "reopened", 60.0 + 300.0 / kMetersPerDegree, 10.0,
+                    0.5f, "36", 300.0f, 0.0f);
+
+  database.Close();
+  std::filesystem::remove(apt_dat_filename);
+  std::filesystem::remove(cache_filename);
+  return ok;
+}
+
+// The heading runs around a landing on a runway right on north, where the
+// headings go either side of 360
+bool TestLandingHeadingRun() {
+  FlightData data;
+  for (int n = 0; n < 40; ++n) {
+    float heading = n % 2 ? 0.4f : 359.6f;
+    data.Add(Data(n * 0.5f, 60.0f, -3.0f, 40.0f - n, 200.0f - n,
+                  59.99 + n * 0.00025, 10.0, heading, true));
+  }
+  for (int n = 40; n < 60; ++n) {
+    float heading = n % 2 ? 0.3f : 359.7f;
+    data.Add(Data(n * 0.5f, 40.0f, 0.0f, 0.0f, 160.0f, 59.99 + n * 0.00025, 10.0,
+                  heading, false));
+  }
+
+  size_t landing_index = 0;
+  if (!data.GetLanding(landing_index) || !data.has_last_landing()) {
+    LOG(ERROR) << "Heading run: no landing";
+    return false;
+  }
+
+  for (float runway_heading : { 0.0f, 359.9f }) {
+    data.SetLastLandingRunway(60.0, 10.0, runway_heading);
+    size_t begin = data.FindLastLandingHeadingBegin(landing_index);
+    size_t end = data.FindLastLandingHeadingEnd(landing_index);
+    if (!data.IsLastLandingHeading() || !data.IsLastLandingHeading(359.0f) ||
+        data.IsLastLandingHeading(20.0f) || begin != 0 || end != data.size()) {
+      LOG(ERROR) << "Heading run: runway heading " << runway_heading
+                 << ", run " << begin << ".." << end << " of " << data.size();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  if (!TestParse() || !TestFindRunway() || !TestLandingHeadingRun())
+    return 1;
+
+  LOG(INFO) << "DONE!";
+
+  return 0;
+}
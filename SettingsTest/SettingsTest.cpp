@@ -1,10 +1,15 @@
 #include "pch.h"
 
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <thread>
 
 #include "xplmpp/Log.h"
 
 #include "Settings.h"
+#include "SettingsWatcher.h"
 
 // Force abseil libraries
 #pragma comment(lib, "absl_base")
@@ -18,8 +23,42 @@ int main() {
   if (!settings.Load("settings.prf"))
     return 1;
 
-  assert(settings.runway_distance() == 0.5 * Settings::kNmToMeters);
-  assert(settings.approach_distance() == 3 * Settings::kNmToMeters);
+  assert(settings.runway_distance() == 0.5 * kNmToMeters);
+  assert(settings.approach_distance() == 3 * kNmToMeters);
+  assert(settings.warnings().empty());
+  assert(settings.Compare(Settings()) == Settings::kLayoutChanged);
+
+  // Changing the file brings in new settings
+  std::string filename =
+      (std::filesystem::temp_directory_path() / "LandEx-SettingsTest.prf").string();
+  std::ofstream(filename) << "flare_height = 30 ft\n";
+
+  SettingsWatcher watcher;
+  watcher.Start(filename);
+  std::ofstream(filename) << "flare_height = 20 ft\nserver_port = 8080\nbogus\n";
+
+  std::unique_ptr<const Settings> reloaded;
+  for (int n = 0; n < 100 && !reloaded; ++n) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    reloaded = watcher.TryGetSettings();
+  }
+  watcher.Stop();
+  std::filesystem::remove(filename);
+
+  assert(reloaded);
+  assert(reloaded->flare_height() == 20 * kFtToMeters);
+  assert(reloaded->warnings().size() == 1);
+  assert(reloaded->server_port() == 8080);
+  assert(reloaded->Compare(Settings()) ==
+         (Settings::kFlareChanged | Settings::kServerChanged));
+
+  // Ports out of range or with fractions are ignored
+  std::ofstream(filename) << "server_port = 70000\nserver_port = 80.5\nserver_port = -1\n";
+  Settings ports;
+  ports.Load(filename);
+  std::filesystem::remove(filename);
+  assert(ports.warnings().size() == 3);
+  assert(ports.server_port() == 0);
 
   LOG(VERBOSE) << "DONE!";
 
@@ -0,0 +1,294 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Telemetry server tests, talking to the server over loopback.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xplmpp/Log.h"
+
+#include "FlightData.h"
+#include "TelemetryServer.h"
+
+using namespace xplmpp;
+
+namespace {
+
+// Key and accept value from the example in RFC 6455
+static const char kKey[] = "dGhlIHNhbXBsZSBub25jZQ==";
+static const char kAccept[] = "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=";
+
+static const int kReceiveTimeoutSeconds = 5;
+static const double kMaxSendMs = 20;
+
+int Connect(int port, int receive_buffer = 0) {
+  int socket = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (receive_buffer)
+    ::setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+
+  timeval timeout = { kReceiveTimeoutSeconds, 0 };
+  ::setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(static_cast<uint16_t>(port));
+  if (::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+    ::close(socket);
+    return -1;
+  }
+
+  return socket;
+}
+
+bool SendAll(int socket, const std::string& data) {
+  return ::send(socket, data.data(), data.size(), MSG_NOSIGNAL) ==
+         static_cast<ssize_t>(data.size());
+}
+
+bool ReceiveAll(int socket, void* data, size_t size) {
+  uint8_t* bytes = static_cast<uint8_t*>(data);
+  while (size) {
+    ssize_t received = ::recv(socket, bytes, size, 0);
+    if (received <= 0)
+      return false;
+    bytes += received;
+    size -= received;
+  }
+  return true;
+}
+
+// Reads the HTTP response headers
+std::string ReceiveResponse(int socket) {
+  std::string response;
+  char c;
+  while (response.find("\r\n\r\n") == std::string::npos && ReceiveAll(socket, &c, 1))
+    response += c;
+  return response;
+}
+
+// Reads one server frame
+bool ReceiveFrame(int socket, uint8_t& opcode, std::vector<uint8_t>& payload) {
+  uint8_t header[2];
+  if (!ReceiveAll(socket, header, sizeof(header)) || (header[1] & 0x80))
+    return false;
+
+  uint64_t length = header[1] & 0x7F;
+  if (length >= 126) {
+    uint8_t extended[8];
+    size_t size = length == 126 ? 2 : 8;
+    if (!ReceiveAll(socket, extended, size))
+      return false;
+    length = 0;
+    for (size_t n = 0; n < size; ++n)
+      length = (length << 8) | extended[n];
+  }
+
+  opcode = header[0];
+  payload.resize(static_cast<size_t>(length));
+  return ReceiveAll(socket, payload.data(), payload.size());
+}
+
+// Client frames are masked
+std::string MakeClientFrame(uint8_t opcode, const std::string& payload) {
+  static const uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+  std::string frame;
+  frame += static_cast<char>(0x80 | opcode);
+  frame += static_cast<char>(0x80 | payload.size());
+  frame.append(reinterpret_cast<const char*>(mask), sizeof(mask));
+  for (size_t n = 0; n < payload.size(); ++n)
+    frame += static_cast<char>(payload[n] ^ mask[n & 3]);
+  return frame;
+}
+
+int OpenWebSocket(int port, int receive_buffer = 0) {
+  int socket = Connect(port, receive_buffer);
+  if (socket < 0)
+    return -1;
+
+  std::string request = std::string("GET /telemetry HTTP/1.1\r\n"
+                                    "Host: localhost\r\n"
+                                    "Upgrade: websocket\r\n"
+                                    "Connection: Upgrade\r\n"
+                                    "Sec-WebSocket-Version: 13\r\n"
+                                    "Sec-WebSocket-Key: ") + kKey + "\r\n\r\n";
+  std::string response;
+  if (!SendAll(socket, request) || (response = ReceiveResponse(socket)).empty() ||
+      response.find("HTTP/1.1 101") != 0 ||
+      response.find(std::string("Sec-WebSocket-Accept: ") + kAccept + "\r\n") ==
+          std::string::npos) {
+    LOG(ERROR) << "Bad handshake response: " << response;
+    ::close(socket);
+    return -1;
+  }
+
+  return socket;
+}
+
+bool WaitForClients(const TelemetryServer& server, size_t count) {
+  for (int n = 0; n < 500 && server.client_count() != count; ++n)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  return server.client_count() == count;
+}
+
+bool TestHttp(int port) {
+  int socket = Connect(port);
+  std::string response;
+  if (socket >= 0 && SendAll(socket, "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n"))
+    response = ReceiveResponse(socket);
+  ::close(socket);
+
+  if (response.find("HTTP/1.1 200") != 0) {
+    LOG(ERROR) << "Bad HTTP response: " << response;
+    return false;
+  }
+  return true;
+}
+
+bool TestStream(TelemetryServer& server, FlightData& data) {
+  int socket = OpenWebSocket(server.port());
+  if (socket < 0 || !WaitForClients(server, 1))
+    return false;
+
+  // Streaming starts from the first Send(), with what is added after it
+  data.Add(Data(0.0f, 50.0f, -3.0f, 100.0f, 200.0f, 37.5, -122.3, 280.0f, true));
+  server.Send(data);
+  for (int n = 1; n <= 10; ++n)
+    data.Add(Data(n * 0.1f, 50.0f, -3.0f, 100.0f - n, 200.0f - n, 37.5, -122.3, 280.0f, true));
+
+  LandingInfo info(45.0f, -1.5f, 11.0f);
+  info.contact_time = 1.0f;
+  info.lat = 37.5;
+  info.lon = -122.3;
+  server.AddLanding(info, true);
+  server.Send(data);
+
+  uint8_t opcode = 0;
+  std::vector<uint8_t> payload;
+  bool ok = ReceiveFrame(socket, opcode, payload);
+  if (!ok || opcode != 0x82 ||
+      payload.size() != sizeof(TelemetryHeader) + 10 * sizeof(TelemetrySample) +
+                        sizeof(TelemetryLanding)) {
+    LOG(ERROR) << "Bad data frame, opcode " << int(opcode) << ", size " << payload.size();
+    ::close(socket);
+    return false;
+  }
+
+  TelemetryHeader header;
+  TelemetrySample sample;
+  TelemetryLanding landing;
+  memcpy(&header, payload.data(), sizeof(header));
+  memcpy(&sample, payload.data() + sizeof(header) + 3 * sizeof(sample), sizeof(sample));
+  memcpy(&landing, payload.data() + sizeof(header) + 10 * sizeof(sample), sizeof(landing));
+  if (memcmp(header.magic, kTelemetryMagic, sizeof(header.magic)) ||
+      header.version != kTelemetryVersion || header.flags != 0 ||
+      header.sample_count != 10 || header.landing_count != 1 ||
+      header.first_sequence != 1 ||
+      sample.agl != 96.0f || sample.lat != 37.5 || !sample.flying ||
+      landing.vertical_speed != -1.5f || landing.gforce != 11.0f ||
+      landing.quality == TelemetryLanding::kNotClassified) {
+    LOG(ERROR) << "Bad data message";
+    ::close(socket);
+    return false;
+  }
+
+  // Pings are answered, closes echoed
+  ok = SendAll(socket, MakeClientFrame(0x9, "ping")) &&
+       ReceiveFrame(socket, opcode, payload) && opcode == 0x8A &&
+       std::string(payload.begin(), payload.end()) == "ping" &&
+       SendAll(socket, MakeClientFrame(0x8, "\x03\xE8")) &&
+       ReceiveFrame(socket, opcode, payload) && opcode == 0x88 &&
+       !ReceiveFrame(socket, opcode, payload);
+  ::close(socket);
+  if (!ok) {
+    LOG(ERROR) << "Bad control frame reply, opcode " << int(opcode);
+    return false;
+  }
+
+  return WaitForClients(server, 0);
+}
+
+bool TestSlowClient(TelemetryServer& server, FlightData& data) {
+  // Never reads, so its backlog only grows
+  int socket = OpenWebSocket(server.port(), 4096);
+  if (socket < 0 || !WaitForClients(server, 1))
+    return false;
+
+  double max_send_ms = 0;
+  size_t dropped_count = server.dropped_count();
+  for (int n = 0; n < 200; ++n) {
+    // Alternating heights so that every sample is kept
+    for (int k = 0; k < 1000; ++k) {
+      float agl = 100.0f + (k & 1);
+      data.Add(Data(n + k * 0.001f, 50.0f, -3.0f, agl, agl + 100.0f, 37.5, -122.3, 280.0f, true));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    server.Send(data);
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    max_send_ms = std::max(max_send_ms, elapsed.count());
+  }
+
+  for (int n = 0; n < 500 && server.dropped_count() == dropped_count; ++n)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  LOG(INFO) << "Slow client: " << server.dropped_count() - dropped_count
+            << " messages dropped, max Send() " << max_send_ms << " ms";
+  ::close(socket);
+
+  if (server.dropped_count() == dropped_count || max_send_ms > kMaxSendMs) {
+    LOG(ERROR) << "Slow client held the sender up";
+    return false;
+  }
+
+  return WaitForClients(server, 0);
+}
+
+}  // namespace
+
+int main() {
+  TelemetryServer server;
+  if (!server.Start(0) || !server.port()) {
+    LOG(ERROR) << "Could not start the server";
+    return 1;
+  }
+
+  FlightData data;
+  if (!TestHttp(server.port()) ||
+      !TestStream(server, data) ||
+      !TestSlowClient(server, data))
+    return 1;
+
+  server.Stop();
+  if (server.is_running())
+    return 1;
+
+  LOG(INFO) << "DONE!";
+
+  return 0;
+}
@@ -0,0 +1,211 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Headless flight trace replay.
+//
+// Runs recorded flight traces through the plugin landing detection as fast as
+// possible, driven by the recorded sim time instead of the sim.
+//
+// Usage: TraceReplay [-q] [-r repeat] trace.lxr...
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FlightData.h"
+#include "FlightMath.h"
+#include "FlightRecorder.h"
+#include "FlightTracker.h"
+#include "LandingAnalyzer.h"
+#include "LandingClassifier.h"
+#include "Settings.h"
+#include "TraceFlightDataSource.h"
+
+using namespace xplmpp;
+
+namespace {
+
+// Collects the landings detected while replaying a trace.
+class ReplayClient : public FlightLoopClient {
+public:
+  ReplayClient(const std::string& filename, bool quiet)
+  : filename_(filename)
+  , quiet_(quiet) {}
+
+  int landing_count() const { return landing_count_; }
+
+  // FlightLoopClient interface
+  void OnFlightLoopTick() override {}
+
+  void OnTrafficLanded(int, const std::string&, const LandingInfo&) override {}
+
+  void OnAirplaneFlying(const FlyingInfo& info) override {
+    classifier_.OnAirplaneFlying(info);
+  }
+
+  void OnAirplaneLanded(const LandingInfo& info) override {
+    bool was_really_flying = classifier_.OnAirplaneLanded();
+    ++landing_count_;
+
+    if (quiet_)
+      return;
+
+    printf("%s: t=%.2f  Vy=%.1f fpm  Vg=%.1f kts  G=%.2f m/sec^2"
+           "  peak Vy=%.1f fpm  G=%.2f..%.2f    %s\n",
+           filename_.c_str(), info.contact_time,
+           RoundOff(MetersPerSecondToFeetPerMinute(info.vertical_speed)),
+           RoundOff(MetersPerSecondToKnots(info.ground_speed)),
+           info.gforce,
+           RoundOff(MetersPerSecondToFeetPerMinute(info.peak_vertical_speed)),
+           info.min_gforce, info.peak_gforce,
+           was_really_flying ? LandingQuality(fabs(info.vertical_speed)) : "-");
+  }
+
+  void OnLandingAnalyzed(const LandingAnalysis& analysis) override {
+    if (quiet_)
+      return;
+
+    printf("%s: t=%.2f  flare %.1f sec from Vy=%.1f fpm  float %.1f sec %.0f ft"
+           "  rollout %.0f ft %.1f sec%s  approach %s Vy dev=%.1f fpm Hdg dev=%.1f\n",
+           filename_.c_str(), analysis.contact_time,
+           analysis.flare_time,
+           RoundOff(MetersPerSecondToFeetPerMinute(analysis.flare_vertical_speed)),
+           analysis.float_time, MetersToFeet(analysis.float_distance),
+           MetersToFeet(analysis.ground_roll_distance), analysis.ground_roll_time,
+           analysis.ground_roll_complete ? "" : " (not stopped)",
+           analysis.stabilized ? "stable" : "unstable",
+           RoundOff(MetersPerSecondToFeetPerMinute(analysis.vertical_speed_deviation)),
+           analysis.heading_deviation);
+  }
+
+private:
+  std::string filename_;
+  bool quiet_;
+
+  LandingClassifier classifier_;
+  int landing_count_ = 0;
+};
+
+// Replays one trace, returns the number of records or -1 on error.
+long Replay(const std::string& filename, bool quiet, int* landing_count) {
+  TraceFlightDataSource source;
+  if (!source.Open(filename))
+    return -1;
+
+  ReplayClient client(filename, quiet);
+  FlightData flight_data;
+  FlightTracker tracker(&client, &flight_data);
+  LandingAnalyzer analyzer(g_settings.flare_height());
+  analyzer.Start();
+
+  long count = 0;
+  bool has_prev_time = false;
+  float prev_time = 0;
+
+  FlightSnapshot snapshot;
+  LandingAnalysis analysis;
+  while (source.Next()) {
+    if (source.IsPaused())
+      continue;
+
+    // The virtual clock is the recorded sim time
+    source.ReadSnapshot(source.time(), snapshot);
+    float elapsed = has_prev_time ? snapshot.time - prev_time : 0.0f;
+    has_prev_time = true;
+    prev_time = snapshot.time;
+
+    tracker.Update(snapshot, elapsed);
+    // Replay runs way faster than the sim, so wait for the analyzer instead
+    // of dropping records.
+    FlightRecord analyzer_record(snapshot, static_cast<int>(tracker.state()));
+    while (!analyzer.TryPost(analyzer_record))
+      std::this_thread::yield();
+    ++count;
+
+    // Pick up the results as the plugin does every tick, the result queue
+    // is short
+    while (analyzer.TryGetResult(analysis))
+      client.OnLandingAnalyzed(analysis);
+  }
+
+  // Wait for the analysis of everything posted
+  analyzer.Stop();
+  while (analyzer.TryGetResult(analysis))
+    client.OnLandingAnalyzed(analysis);
+
+  *landing_count += client.landing_count();
+  return count;
+}
+
+void Usage() {
+  fprintf(stderr, "Usage: TraceReplay [-q] [-r repeat] trace.lxr...\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  bool quiet = false;
+  int repeat = 1;
+  std::vector<std::string> filenames;
+
+  for (int n = 1; n < argc; ++n) {
+    if (!strcmp(argv[n], "-q")) {
+      quiet = true;
+    } else
+    if (!strcmp(argv[n], "-r") && n + 1 < argc) {
+      repeat = atoi(argv[++n]);
+    } else
+    if (argv[n][0] == '-') {
+      Usage();
+      return 2;
+    } else {
+      filenames.push_back(argv[n]);
+    }
+  }
+
+  if (filenames.empty() || repeat < 1) {
+    Usage();
+    return 2;
+  }
+
+  long sample_count = 0;
+  int landing_count = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (int pass = 0; pass < repeat; ++pass) {
+    for (const std::string& filename : filenames) {
+      long count = Replay(filename, quiet || pass > 0, &landing_count);
+      if (count < 0)
+        return 1;
+      sample_count += count;
+    }
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  printf("%ld samples, %d landings in %.3f sec, %.0f samples/sec\n",
+         sample_count, landing_count, elapsed.count(),
+         elapsed.count() > 0 ? sample_count / elapsed.count() : 0.0);
+
+  return 0;
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Drawing surface interface.
+
+#ifndef LANDEX_CANVAS_H
+#define LANDEX_CANVAS_H
+
+#include <string>
+
+#include "Common.h"
+
+#include "xplmpp/Rect.h"
+
+namespace xplmpp {
+
+// Represents a 2D drawing surface. Keeps the drawing code free of any
+// graphics API so that it can be used outside of the plugin.
+class Canvas {
+public:
+  enum class Primitive {
+    lines,
+    lineStrip,
+    lineLoop,
+    polygon,
+  };
+
+  virtual ~Canvas() = default;
+
+  virtual void SetLineWidth(float width) = 0;
+  virtual void SetColor(const float* rgba) = 0;
+
+  // Vertices are only accepted between Begin() and End()
+  virtual void Begin(Primitive primitive) = 0;
+  virtual void Vertex(float x, float y) = 0;
+  virtual void End() = 0;
+
+  virtual void GetFontDimensions(int* char_width, int* char_height) = 0;
+  virtual void DrawString(const float* rgb, int x, int y,
+                          const char* text) = 0;
+
+  void Vertex(const PointF& pt) { Vertex(pt.x, pt.y); }
+
+  void Vertex(const RectF& rc) {
+    Vertex(rc.left, rc.top);
+    Vertex(rc.right, rc.top);
+    Vertex(rc.right, rc.bottom);
+    Vertex(rc.left, rc.bottom);
+  }
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_CANVAS_H
@@ -23,6 +23,13 @@
 #include "xplmpp/Common.h"
 #include "xplmpp/Log.h"
 
+// SSE2 is part of the x64 baseline, so it is always there for 64-bit builds.
+#if defined(_M_X64) || defined(__SSE2__)
+#define LANDEX_SSE2 1
+#else
+#define LANDEX_SSE2 0
+#endif
+
 namespace xplmpp {
 
  // Distance units conversion
@@ -31,6 +38,12 @@ static constexpr float kNmToMeters = 1852.0f;
 static constexpr float kMiToMeters = 1609.34f;
 static constexpr float kKmToMeters = 1000.0f;
 
+// Below this the airplane is taxiing, or done with the ground roll
+static constexpr float kTaxiSpeed = 15.0f * 0.514444f;  // 15 kts in meters/sec
+
+// Turning further off the landing heading than this starts a new approach
+static constexpr float kLandingHeadingThreshold = 15.0f;  // degrees
+
 }  // namespace xplmpp
 
 #endif  // #ifndef LANDEX_COMMON_H
@@ -18,7 +18,12 @@
 // Plugin flight data implementation.
 
 #include "FlightData.h"
-#include "FlightMath.h"
+
+#include <algorithm>
+
+#if LANDEX_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace xplmpp {
 
@@ -29,69 +34,147 @@ namespace {
 static const float kDataDifferenceThreshold = 0.000001f;
 static const float kAglChangeResetThreshold = 5.0f;
 
-static const float kLandingHeadingThreshold = 15.0;  // degrees
 static const float kLandingDistanceThreshold = 50.0;  // meters
 
-bool DataDifference(const Data& data, const Data& data2) {
-  return fabs(data2.ground_speed - data.ground_speed) > kDataDifferenceThreshold ||
-         fabs(data2.vertical_speed - data.vertical_speed) > kDataDifferenceThreshold ||
-         fabs(data2.agl - data.agl) > kDataDifferenceThreshold ||
-         fabs(data2.msl - data.msl) > kDataDifferenceThreshold ||
-         fabs(data2.lat - data.lat) > kDataDifferenceThreshold ||
-         fabs(data2.lon - data.lon) > kDataDifferenceThreshold ||
-         fabs(data2.heading - data.heading) > kDataDifferenceThreshold ||
-         data2.flying != data.flying;
+// The vector overload below would hide the scalar one
+using xplmpp::HeadingDelta;
+
+#if LANDEX_SSE2
+// Four at a time version of HeadingDelta()
+inline __m128 HeadingDelta(__m128 heading, __m128 heading2) {
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  const __m128 full_circle = _mm_set1_ps(360.0f);
+  __m128 delta = _mm_andnot_ps(sign, _mm_sub_ps(heading, heading2));
+  return _mm_min_ps(delta, _mm_sub_ps(full_circle, delta));
+}
+#endif
+
+// Returns the index of the first heading in [0, count) that is outside of
+// the window around |ref|, or |count| if all of them are within.
+size_t FindHeadingOutside(const float* heading, size_t count,
+                          float ref, float threshold) {
+  size_t n = 0;
+#if LANDEX_SSE2
+  const __m128 vref = _mm_set1_ps(ref);
+  const __m128 vthreshold = _mm_set1_ps(threshold);
+  for (; n + 4 <= count; n += 4) {
+    __m128 delta = HeadingDelta(_mm_loadu_ps(heading + n), vref);
+    int mask = _mm_movemask_ps(_mm_cmpnlt_ps(delta, vthreshold));
+    if (mask) {
+      while (!(mask & 1)) {
+        mask >>= 1;
+        ++n;
+      }
+      return n;
+    }
+  }
+#endif
+  for (; n < count; ++n) {
+    if (!(HeadingDelta(heading[n], ref) < threshold))
+      return n;
+  }
+  return count;
+}
+
+// Returns one past the index of the last heading in [0, count) that is
+// outside of the window around |ref|, or 0 if all of them are within.
+size_t FindHeadingOutsideReverse(const float* heading, size_t count,
+                                 float ref, float threshold) {
+  size_t n = count;
+#if LANDEX_SSE2
+  for (; n % 4; --n) {
+    if (!(HeadingDelta(heading[n - 1], ref) < threshold))
+      return n;
+  }
+  const __m128 vref = _mm_set1_ps(ref);
+  const __m128 vthreshold = _mm_set1_ps(threshold);
+  for (; n >= 4; n -= 4) {
+    __m128 delta = HeadingDelta(_mm_loadu_ps(heading + n - 4), vref);
+    int mask = _mm_movemask_ps(_mm_cmpnlt_ps(delta, vthreshold));
+    if (mask) {
+      while (!(mask & 8)) {
+        mask <<= 1;
+        --n;
+      }
+      return n;
+    }
+  }
+#endif
+  for (; n > 0; --n) {
+    if (!(HeadingDelta(heading[n - 1], ref) < threshold))
+      return n;
+  }
+  return 0;
 }
 
 } // namespace
 
+FlightData::FlightData(size_t capacity)
+: capacity_(capacity) {
+  assert(capacity_ > 0);
+}
+
 void FlightData::Add(const Data& data) {
   if (!data.flying) {
     // Avoid adding entries before flying
     if (empty())
       return;
-    // Cache first landing entry
-    if (!landing_index_) {
-      landing_index_ = size();
+    // Cache first landing entry unless it has already slid out of the window
+    if (!has_landing_ && !landing_dropped_) {
+      has_landing_ = true;
+      landing_index_ = size_;
     }
+  } else {
+    landing_dropped_ = false;
   }
 
   // Advance time on the last entry if not enough difference
-  if (!empty() && !DataDifference(data, back())) {
-    back().time = data.time;
+  if (!empty() && !IsDifferent(data)) {
+    time_[Slot(size_ - 1)] = data.time;
     return;
   }
 
   // Check for abrupt AGL changes and reset dataset since
   // chances are that flight situation was reloaded.
-  if (!empty() && fabs(data.agl - back().agl) > kAglChangeResetThreshold)
+  if (!empty() && fabs(data.agl - agl(size_ - 1)) > kAglChangeResetThreshold)
     Reset();
 
   // Check if landed and update last landing info
-  if (!empty() && back().flying && !data.flying) {
+  if (!empty() && flying(size_ - 1) && !data.flying) {
     last_landing_ = data;
+    last_landing_frame_ = RunwayFrame(data.lat, data.lon, data.heading);
     has_last_landing_ = true;
+    ++last_landing_generation_;
   }
 
-  // TODO(kvitekp): bound size by keeping track of the distance
-  // travelled and limiting it to 3nm
-  emplace_back(data);
+  PushBack(data);
+
+  // Drop the entries that are too far from the new one
+  while (size_ > 1 && IsExpired(0))
+    PopFront();
 }
 
-bool FlightData::GetLanding(const_iterator& it) const {
-  if (!landing_index_)
+Data FlightData::operator[](size_t index) const {
+  assert(index < size_);
+  size_t slot = Slot(index);
+  return Data(time_[slot], ground_speed_[slot], vertical_speed_[slot],
+              agl_[slot], msl_[slot], lat_[slot], lon_[slot],
+              heading_[slot], !!flying_[slot]);
+}
+
+bool FlightData::GetLanding(size_t& index) const {
+  if (!has_landing_)
     return false;
 
-  it = cbegin();
-  advance(it, landing_index_);
+  index = landing_index_;
   return true;
 }
 
 bool FlightData::GetLanding(Data& data) const {
-  const_iterator it;
-  if (!GetLanding(it))
+  size_t index;
+  if (!GetLanding(index))
     return false;
-  data = *it;
+  data = (*this)[index];
   return true;
 }
 
@@ -111,31 +194,175 @@ bool FlightData::GetLastLanding(Data& data) const {
   return true;
 }
 
+void FlightData::SetLastLandingRunway(double lat, double lon, float heading) {
+  if (!has_last_landing_)
+    return;
+
+  last_landing_.lat = lat;
+  last_landing_.lon = lon;
+  last_landing_.heading = heading;
+  last_landing_frame_ = RunwayFrame(lat, lon, heading);
+  ++last_landing_generation_;
+}
+
 bool FlightData::IsLastLandingHeading() const {
   if (empty() || !has_last_landing_)
     return false;
 
-  return IsLastLandingHeading(back().heading);
+  return IsLastLandingHeading(heading(size_ - 1));
 }
 
 bool FlightData::IsLastLandingHeading(float heading) const {
   if (!has_last_landing_)
     return false;
 
-  float heading_delta = fabs(heading - last_landing_.heading);
-  return heading_delta < kLandingHeadingThreshold;
+  return HeadingDelta(heading, last_landing_.heading) < kLandingHeadingThreshold;
 }
 
-float FlightData::GetLastLandingDistance(double lat, double lon) const {
-  assert(has_last_landing_);
-  double distance = CalcEarthDistance(lat, lon, last_landing_.lat, last_landing_.lon);
-  return static_cast<float>(distance);
+size_t FlightData::FindLastLandingHeadingBegin(size_t end) const {
+  assert(end <= size_);
+  if (!has_last_landing_ || !end)
+    return end;
+
+  // Scan the part past the wrap point first, if any
+  float ref = last_landing_.heading;
+  size_t wrap = capacity_ - first_;
+  if (end > wrap) {
+    size_t n = FindHeadingOutsideReverse(&heading_[0], end - wrap,
+                                         ref, kLandingHeadingThreshold);
+    if (n)
+      return wrap + n;
+    end = wrap;
+  }
+
+  return FindHeadingOutsideReverse(&heading_[first_], end,
+                                   ref, kLandingHeadingThreshold);
+}
+
+size_t FlightData::FindLastLandingHeadingEnd(size_t begin) const {
+  assert(begin <= size_);
+  if (!has_last_landing_ || begin == size_)
+    return begin;
+
+  // Scan the part before the wrap point first, if any
+  float ref = last_landing_.heading;
+  size_t wrap = capacity_ - first_;
+  if (begin < wrap) {
+    size_t count = std::min(size_, wrap) - begin;
+    size_t n = FindHeadingOutside(&heading_[first_ + begin], count,
+                                  ref, kLandingHeadingThreshold);
+    if (n < count || size_ <= wrap)
+      return begin + n;
+    begin = wrap;
+  }
+
+  size_t count = size_ - begin;
+  return begin + FindHeadingOutside(&heading_[begin - wrap], count,
+                                    ref, kLandingHeadingThreshold);
 }
 
 void FlightData::Reset() {
-  clear();
-  shrink_to_fit();
+  first_ = 0;
+  size_ = 0;
+  first_sequence_ = 0;
+  ++generation_;
+  has_landing_ = false;
+  landing_dropped_ = false;
   landing_index_ = 0;
 }
 
+bool FlightData::IsExpired(size_t index) const {
+  size_t last = size_ - 1;
+
+  if (max_time_ > 0 && time(last) - time(index) > max_time_)
+    return true;
+
+  if (max_distance_ > 0 &&
+      CalcEarthDistance(lat(index), lon(index), lat(last), lon(last)) > max_distance_)
+    return true;
+
+  return false;
+}
+
+bool FlightData::IsDifferent(const Data& data) const {
+  size_t slot = Slot(size_ - 1);
+  if (data.flying != !!flying_[slot])
+    return true;
+
+#if LANDEX_SSE2
+  // Compare all the float and double channels at once
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  const __m128 threshold = _mm_set1_ps(kDataDifferenceThreshold);
+  __m128 delta = _mm_sub_ps(
+      _mm_setr_ps(data.ground_speed, data.vertical_speed, data.agl, data.msl),
+      _mm_setr_ps(ground_speed_[slot], vertical_speed_[slot], agl_[slot], msl_[slot]));
+  __m128 delta_heading = _mm_sub_ss(_mm_set_ss(data.heading), _mm_set_ss(heading_[slot]));
+  int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_andnot_ps(sign, delta), threshold)) |
+             _mm_movemask_ps(_mm_cmpgt_ss(_mm_andnot_ps(sign, delta_heading), threshold));
+
+  const __m128d sign_pd = _mm_set1_pd(-0.0);
+  const __m128d threshold_pd = _mm_set1_pd(kDataDifferenceThreshold);
+  __m128d delta_pos = _mm_sub_pd(_mm_setr_pd(data.lat, data.lon),
+                                 _mm_setr_pd(lat_[slot], lon_[slot]));
+  mask |= _mm_movemask_pd(_mm_cmpgt_pd(_mm_andnot_pd(sign_pd, delta_pos), threshold_pd));
+
+  return (mask & 0x0f) != 0;
+#else
+  return fabs(data.ground_speed - ground_speed_[slot]) > kDataDifferenceThreshold ||
+         fabs(data.vertical_speed - vertical_speed_[slot]) > kDataDifferenceThreshold ||
+         fabs(data.agl - agl_[slot]) > kDataDifferenceThreshold ||
+         fabs(data.msl - msl_[slot]) > kDataDifferenceThreshold ||
+         fabs(data.lat - lat_[slot]) > kDataDifferenceThreshold ||
+         fabs(data.lon - lon_[slot]) > kDataDifferenceThreshold ||
+         fabs(data.heading - heading_[slot]) > kDataDifferenceThreshold;
+#endif
+}
+
+void FlightData::PushBack(const Data& data) {
+  // Storage is allocated once on demand and never shrinks
+  if (time_.empty()) {
+    time_.resize(capacity_);
+    ground_speed_.resize(capacity_);
+    vertical_speed_.resize(capacity_);
+    agl_.resize(capacity_);
+    msl_.resize(capacity_);
+    lat_.resize(capacity_);
+    lon_.resize(capacity_);
+    heading_.resize(capacity_);
+    flying_.resize(capacity_);
+  }
+
+  if (size_ == capacity_)
+    PopFront();
+
+  size_t slot = Slot(size_++);
+  time_[slot] = data.time;
+  ground_speed_[slot] = data.ground_speed;
+  vertical_speed_[slot] = data.vertical_speed;
+  agl_[slot] = data.agl;
+  msl_[slot] = data.msl;
+  lat_[slot] = data.lat;
+  lon_[slot] = data.lon;
+  heading_[slot] = data.heading;
+  flying_[slot] = data.flying;
+}
+
+void FlightData::PopFront() {
+  assert(size_ > 0);
+
+  if (has_landing_) {
+    if (landing_index_ == 0) {
+      // Landing entry is gone, do not pick a ground roll one instead
+      has_landing_ = false;
+      landing_dropped_ = true;
+    } else {
+      --landing_index_;
+    }
+  }
+
+  first_ = Slot(1);
+  --size_;
+  ++first_sequence_;
+}
+
 }  // namespace xplmpp
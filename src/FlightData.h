@@ -20,9 +20,11 @@
 #ifndef LANDEX_FLIGHTDATA_H
 #define LANDEX_FLIGHTDATA_H
 
+#include <stdint.h>
 #include <vector>
 
 #include "Common.h"
+#include "FlightMath.h"
 #include "xplmpp/Rect.h"
 
 namespace xplmpp {
@@ -53,18 +55,64 @@ struct Data {
   bool flying;
 };
 
-class FlightData : public std::vector<Data> {
+// Represents the flight data collected so far. Samples are kept in a fixed
+// capacity circular buffer, the oldest ones being dropped when they get too
+// far (or too long ago) from the newest one. Each channel is stored in its
+// own contiguous column so that scans only touch the channels they need.
+class FlightData {
 public:
-  FlightData() = default;
+  static constexpr size_t kDefaultCapacity = 16384;
+
+  FlightData(size_t capacity = kDefaultCapacity);
   ~FlightData() = default;
 
   void Add(const Data& data);
 
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+
+  // Returns the sample at |index|, index 0 being the oldest one retained
+  Data operator[](size_t index) const;
+
+  Data front() const { return (*this)[0]; }
+  Data back() const { return (*this)[size_ - 1]; }
+
+  // Returns the sequence number of the sample at |index|. Sequence numbers
+  // do not change as older samples are dropped, until the next Reset().
+  size_t sequence(size_t index) const { return first_sequence_ + index; }
+  size_t first_sequence() const { return first_sequence_; }
+  size_t end_sequence() const { return first_sequence_ + size_; }
+
+  // Changes on every Reset()
+  unsigned generation() const { return generation_; }
+
+  // Changes whenever the last landing is updated
+  unsigned last_landing_generation() const { return last_landing_generation_; }
+
+  // Column accessors
+  float time(size_t index) const { return time_[Slot(index)]; }
+  float ground_speed(size_t index) const { return ground_speed_[Slot(index)]; }
+  float vertical_speed(size_t index) const { return vertical_speed_[Slot(index)]; }
+  float agl(size_t index) const { return agl_[Slot(index)]; }
+  float msl(size_t index) const { return msl_[Slot(index)]; }
+  double lat(size_t index) const { return lat_[Slot(index)]; }
+  double lon(size_t index) const { return lon_[Slot(index)]; }
+  float heading(size_t index) const { return heading_[Slot(index)]; }
+  bool flying(size_t index) const { return !!flying_[Slot(index)]; }
+
+  // Sets distance (meters) and time (seconds) the oldest sample can be away
+  // from the newest one, zero meaning no limit.
+  void set_history_limits(float max_distance, float max_time) {
+    max_distance_ = max_distance;
+    max_time_ = max_time;
+  }
+
   bool HasLanding() const {
-    return landing_index_ > 0;
+    return has_landing_;
   }
 
-  bool GetLanding(const_iterator& it) const;
+  bool GetLanding(size_t& index) const;
   bool GetLanding(Data& data) const;
 
   bool GetLast(Data& data) const;
@@ -72,18 +120,78 @@ public:
 
   bool has_last_landing() const { return has_last_landing_;  }
 
+  // Anchors the last landing at the landing threshold of the runway it was
+  // made on, so that the distances are measured from the threshold along
+  // the runway heading instead of from the touchdown point.
+  void SetLastLandingRunway(double lat, double lon, float heading);
+
   bool IsLastLandingHeading() const;
   bool IsLastLandingHeading(float heading) const;
 
-  float GetLastLandingDistance(double lat, double lon) const;
+  // Returns the first index of the run of samples ending at |end| (exclusive)
+  // that are all within the last landing heading window.
+  size_t FindLastLandingHeadingBegin(size_t end) const;
+
+  // Returns the end (exclusive) of the run of samples starting at |begin|
+  // that are all within the last landing heading window.
+  size_t FindLastLandingHeadingEnd(size_t begin) const;
+
+  // Returns the distance to the last landing point measured along the
+  // landing heading, negative past the landing point.
+  float GetLastLandingDistance(double lat, double lon) const {
+    assert(has_last_landing_);
+    return -last_landing_frame_.AlongTrack(lat, lon);
+  }
+
+  // Returns the distance off the last landing centerline, positive to the
+  // right of it.
+  float GetLastLandingCrossTrack(double lat, double lon) const {
+    assert(has_last_landing_);
+    return last_landing_frame_.CrossTrack(lat, lon);
+  }
 
   void Reset();
 
 private:
+  size_t Slot(size_t index) const {
+    size_t slot = first_ + index;
+    return slot < capacity_ ? slot : slot - capacity_;
+  }
+
+  bool IsExpired(size_t index) const;
+  bool IsDifferent(const Data& data) const;
+
+  void PushBack(const Data& data);
+  void PopFront();
+
+  size_t capacity_;
+  size_t first_ = 0;
+  size_t size_ = 0;
+
+  size_t first_sequence_ = 0;
+  unsigned generation_ = 0;
+
+  std::vector<float> time_;
+  std::vector<float> ground_speed_;
+  std::vector<float> vertical_speed_;
+  std::vector<float> agl_;
+  std::vector<float> msl_;
+  std::vector<double> lat_;
+  std::vector<double> lon_;
+  std::vector<float> heading_;
+  std::vector<uint8_t> flying_;
+
+  float max_distance_ = 3.0f * kNmToMeters;
+  float max_time_ = 0.0f;
+
+  bool has_landing_ = false;
+  bool landing_dropped_ = false;
   size_t landing_index_ = 0;
 
   bool has_last_landing_ = false;
+  unsigned last_landing_generation_ = 0;
   Data last_landing_;
+  RunwayFrame last_landing_frame_;
 };
 
 extern FlightData g_flight_data;
@@ -0,0 +1,44 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Flight data source interface.
+
+#ifndef LANDEX_FLIGHTDATASOURCE_H
+#define LANDEX_FLIGHTDATASOURCE_H
+
+#include "Common.h"
+
+#include "FlightSnapshot.h"
+
+namespace xplmpp {
+
+// Represents where the flight loop gets the aircraft state from, e.g. the
+// sim datarefs or a recorded trace.
+class FlightDataSource {
+public:
+  virtual ~FlightDataSource() = default;
+
+  // Returns true if nothing is changing at the moment
+  virtual bool IsPaused() = 0;
+
+  // Reads the aircraft state at |time| into |snapshot|
+  virtual void ReadSnapshot(float time, FlightSnapshot& snapshot) = 0;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_FLIGHTDATASOURCE_H
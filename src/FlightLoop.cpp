@@ -22,27 +22,35 @@
 #include "XPLMProcessing.h"
 
 #include "FlightData.h"
+#include "Settings.h"
+#include "XPLMFlightDataSource.h"
+#include "XPLMTrafficDataSource.h"
 
 namespace xplmpp {
 
 static const float kFlightLoopIntervalSeconds = 0.05f;
+static const float kSlowIntervalSeconds = 0.25f;
+static const float kPausedIntervalSeconds = 0.5f;
+static const float kEveryFrameInterval = -1.0f;  // negative means frames
+static const float kCruiseAgl = 3000.0f * kFtToMeters;
+static const float kFlareLookaheadSeconds = 10.0f;
 static const float kInitialSettleDownTimeout = 3.0f;
-static const float kFlyingCallbackPeriod = 1.0f;
-static const float kLandingHeadingThreshold = 15.0;  // degrees
 
 std::unique_ptr<FlightLoop> FlightLoop::Create(FlightLoopClient* client) {
-  return std::make_unique<FlightLoop>(client);
+  return std::make_unique<FlightLoop>(client, std::make_unique<XPLMFlightDataSource>(),
+                                      std::make_unique<XPLMTrafficDataSource>());
 }
 
-FlightLoop::FlightLoop(FlightLoopClient* client)
-: client_(client) {
-#if WRITE_TRACE_FILE
-  file_.open("/tmp/0/landex_data.txt");
-  file_.precision(6);
-  file_ << std::fixed;
-#endif
-
-  FindDataSources();
+FlightLoop::FlightLoop(FlightLoopClient* client,
+                       std::unique_ptr<FlightDataSource> data_source,
+                       std::unique_ptr<TrafficDataSource> traffic_source)
+: client_(client)
+, tracker_(client, &g_flight_data)
+, data_source_(std::move(data_source))
+, analyzer_(g_settings.flare_height())
+, traffic_source_(std::move(traffic_source))
+, traffic_tracker_(client) {
+  analyzer_.Start();
 
   ::XPLMRegisterFlightLoopCallback(FlightLoopCallback,
                                   kFlightLoopIntervalSeconds,
@@ -52,57 +60,56 @@ FlightLoop::FlightLoop(FlightLoopClient* client)
 FlightLoop::~FlightLoop() {
   ::XPLMUnregisterFlightLoopCallback(FlightLoopCallback, this);
   g_flight_data.Reset();
-#if WRITE_TRACE_FILE
-  file_.close();
-#endif
-}
-
-void FlightLoop::FindDataSources() {
-  replay_mode_.Find("sim/operation/prefs/replay_mode");
-  faxil_gear_.Find("sim/flightmodel/forces/faxil_gear");
-  ground_speed_.Find("sim/flightmodel/position/groundspeed");
-  vertical_speed_.Find("sim/flightmodel/position/vh_ind");
-  gforce_.Find("sim/flightmodel2/misc/gforce_normal");
-  agl_.Find("sim/flightmodel/position/y_agl");
-  msl_.Find("sim/cockpit2/gauges/indicators/altitude_ft_pilot");
-  latitude_.Find("sim/flightmodel/position/latitude");
-  longitude_.Find("sim/flightmodel/position/longitude");
-  heading_.Find("sim/flightmodel/position/true_psi");
+  recorder_.Stop();
+  analyzer_.Stop();
 }
 
-bool FlightLoop::IsFlying() {
-  return (!ReplayMode() && FaxilGear() == 0.0) || Agl() > 0.25;
-}
+float FlightLoop::GetNextInterval(const FlightSnapshot& snapshot) const {
+  // Keep sampling every frame until the touchdown capture is complete
+  if (tracker_.is_capturing_touchdown())
+    return kEveryFrameInterval;
 
-bool FlightLoop::UpdateState() {
-  switch (state_) {
-  case State::unknown:
-    state_ = IsFlying() ? State::flying : State::landed;
+  switch (tracker_.state()) {
+  case FlightTracker::State::unknown:
     break;
-  case State::flying:
-    if (HasLanded()) {
-      state_ = State::landed;
-      LandingInfo info(GroundSpeed(), VerticalSpeed(), GForce());
-      client_->OnAirplaneLanded(info);
-      return true;
-    }
+  case FlightTracker::State::landed:
+    // Parked or taxiing, landing roll and takeoff run go at the normal rate
+    if (snapshot.ground_speed < kTaxiSpeed)
+      return kSlowIntervalSeconds;
     break;
-  case State::landed:
-    if (IsFlying()) {
-      state_ = State::flying;
-      FlyingInfo info(GroundSpeed(), VerticalSpeed(), Agl(), Msl());
-      client_->OnAirplaneFlying(info);
-      time_since_last_flying_report_ = 0.0;
-      return true;
+  case FlightTracker::State::flying:
+    // Sample every frame through the flare and touchdown
+    if (snapshot.agl < g_settings.flare_height())
+      return kEveryFrameInterval;
+    // Sample slowly high above the ground unless about to descend to the
+    // flare height soon
+    if (snapshot.agl > kCruiseAgl) {
+      float height = snapshot.agl - g_settings.flare_height();
+      if (snapshot.vertical_speed >= 0 ||
+          height > -snapshot.vertical_speed * kFlareLookaheadSeconds)
+        return kSlowIntervalSeconds;
     }
     break;
   }
 
-  return false;
+  return kFlightLoopIntervalSeconds;
 }
 
 float FlightLoop::OnFlightLoopCallback(float elapsed_since_last_call,
                                        float elapsed_time_since_last_flightLoop) {
+  client_->OnFlightLoopTick();
+
+  // Pick up the landing analysis results
+  LandingAnalysis analysis;
+  while (analyzer_.TryGetResult(analysis))
+    client_->OnLandingAnalyzed(analysis);
+
+  // Nothing changes while the sim is paused
+  if (data_source_->IsPaused())
+    return kPausedIntervalSeconds;
+
+  float interval = kFlightLoopIntervalSeconds;
+
   if (!first_elapsed_time_since_last_flightLoop_) {
     first_elapsed_time_since_last_flightLoop_ = elapsed_time_since_last_flightLoop;
   } else
@@ -110,49 +117,26 @@ float FlightLoop::OnFlightLoopCallback(float elapsed_since_last_call,
       < kInitialSettleDownTimeout) {
     // Do nothing letting things to settle down
   } else {
-    // Update state and provide periodic flying callback
-    if (!UpdateState() && state_ == State::flying) {
-      time_since_last_flying_report_ += elapsed_since_last_call;
-      if (time_since_last_flying_report_ >= kFlyingCallbackPeriod) {
-        FlyingInfo info(GroundSpeed(), VerticalSpeed(), Agl(), Msl());
-        client_->OnAirplaneFlying(info);
-        time_since_last_flying_report_ = 0.0;
-      }
+    FlightSnapshot snapshot;
+    data_source_->ReadSnapshot(elapsed_time_since_last_flightLoop, snapshot);
+    tracker_.Update(snapshot, elapsed_since_last_call);
+
+    // Hand the tick over to the landing analysis, and record it if asked to
+    FlightRecord record(snapshot, static_cast<int>(tracker_.state()));
+    analyzer_.Post(record);
+    if (recorder_.is_recording())
+      recorder_.Record(record);
+
+    // Same for the other aircraft around
+    if (traffic_source_->is_available()) {
+      traffic_source_->ReadSnapshot(elapsed_time_since_last_flightLoop, traffic_snapshot_);
+      traffic_tracker_.Update(traffic_snapshot_);
     }
 
-    // Check if turned crosswind or otherwise deviated from landing heading and
-    // reset collected flight data if so.
-    Data landing_data;
-    if (IsFlying() && g_flight_data.GetLanding(landing_data)) {
-      float heading_delta = fabs(Heading() - landing_data.heading);
-      if (heading_delta > kLandingHeadingThreshold)
-        g_flight_data.Reset();
-    }
-
-    // Append flight data
-    g_flight_data.Add(
-      Data(elapsed_time_since_last_flightLoop, GroundSpeed(), VerticalSpeed(),
-           Agl(), Msl(), Latitude(), Longitude(), Heading(), IsFlying()));
+    interval = GetNextInterval(snapshot);
   }
 
-#if WRITE_TRACE_FILE
-  file_ << "state=" << (int)state_
-        << " gs=" << GroundSpeed()
-        << " vs=" << VerticalSpeed()
-        << " gf=" << GForce()
-        << " AGL=" << Agl()
-        << " MSL=" << Msl()
-        << " pos=(" << Latitude() << ", " << Longitude() << ")"
-        << " hdi=" << Heading()
-#if 0
-        << " elapsed_since_last_call=" << elapsed_since_last_call
-        << " elapsed_time_since_last_flightLoop=" << elapsed_time_since_last_flightLoop
-        << " replay_mode=" << ReplayMode()
-#endif
-        << "\n";
-#endif
-
-  return kFlightLoopIntervalSeconds;
+  return interval;
 }
 
 float FlightLoop::FlightLoopCallback(float elapsed_since_last_call,
@@ -22,35 +22,39 @@
 
 #include "Common.h"
 
-#define WRITE_TRACE_FILE 0
-
-#if WRITE_TRACE_FILE
-#include <iostream>
-#include <fstream>
-#include <iomanip>
-#endif
-
-#include "xplmpp/XPLMData.h"
-
+#include "FlightDataSource.h"
 #include "FlightLoopClient.h"
+#include "FlightRecorder.h"
+#include "FlightSnapshot.h"
+#include "FlightTracker.h"
+#include "LandingAnalyzer.h"
+#include "TrafficDataSource.h"
+#include "TrafficSnapshot.h"
+#include "TrafficTracker.h"
 
 namespace xplmpp {
 
 // Represents the plugin flight loop
 class FlightLoop {
 public:
-  FlightLoop(FlightLoopClient* client);
+  FlightLoop(FlightLoopClient* client, std::unique_ptr<FlightDataSource> data_source,
+             std::unique_ptr<TrafficDataSource> traffic_source);
   ~FlightLoop();
 
   static std::unique_ptr<FlightLoop> Create(FlightLoopClient* client);
 
-private:
-  void FindDataSources();
+  bool StartRecording(const std::string& filename) {
+    return recorder_.Start(filename);
+  }
+  void StopRecording() { recorder_.Stop(); }
+  bool is_recording() const { return recorder_.is_recording(); }
 
-  bool IsFlying();
-  bool HasLanded() { return !IsFlying(); }
+  void set_flare_height(float flare_height) {
+    analyzer_.set_flare_height(flare_height);
+  }
 
-  bool UpdateState();
+private:
+  float GetNextInterval(const FlightSnapshot& snapshot) const;
 
   float OnFlightLoopCallback(float elapsed_since_last_call,
                              float elapsedTimeSinceLastFlightLoop);
@@ -60,45 +64,18 @@ private:
     int counter, void* refcon);
 
   FlightLoopClient* client_;
-
-  enum class State {
-    unknown,
-    landed,
-    flying,
-  } state_ = State::unknown;
+  FlightTracker tracker_;
 
   float first_elapsed_time_since_last_flightLoop_ = 0.0;
-  float time_since_last_flying_report_ = 0.0;
-
-  #define DATAREF_I(getter, member) \
-    XPLMData member; \
-    int getter() { return member.GetDatai(); }
-
-  #define DATAREF_F(getter, member) \
-    XPLMData member; \
-    float getter() { return member.GetDataf(); }
-
-  #define DATAREF_D(getter, member) \
-    XPLMData member; \
-    double getter() { return member.GetDatad(); }
-
-  DATAREF_I(ReplayMode, replay_mode_)  // Are we in replay mode?
-  DATAREF_F(FaxilGear, faxil_gear_)  // Gear/ground forces - backward - ACF Z, newtons
-  DATAREF_F(GroundSpeed, ground_speed_)  // Ground speed, meters/sec
-  DATAREF_F(VerticalSpeed, vertical_speed_)  // Vertical speed, meters/sec
-  DATAREF_F(GForce, gforce_)  // G force, meters/sec^2
-  DATAREF_F(Agl, agl_)  // Altitude above ground level, meters
-  DATAREF_F(Msl, msl_)  // Indicated altitude above mean sea level, feet
-  DATAREF_D(Latitude, latitude_)  // The latitude of the aircraft
-  DATAREF_D(Longitude, longitude_)  // The longitude of the aircraft
-  DATAREF_F(Heading, heading_)  // The heading of the aircraft
-
-#undef DATAREF_I
-#undef DATAREF_F
-
-#if WRITE_TRACE_FILE
-  std::ofstream file_;
-#endif
+
+  std::unique_ptr<FlightDataSource> data_source_;
+
+  FlightRecorder recorder_;
+  LandingAnalyzer analyzer_;
+
+  std::unique_ptr<TrafficDataSource> traffic_source_;
+  TrafficSnapshot traffic_snapshot_;
+  TrafficTracker traffic_tracker_;
 };
 
 }  // namespace xplmpp
@@ -20,6 +20,10 @@
 #ifndef LANDEX_FLIGHTLOOP_CLIENT_H
 #define LANDEX_FLIGHTLOOP_CLIENT_H
 
+#include <stddef.h>
+
+#include <string>
+
 namespace xplmpp {
 
 // Flying info data.
@@ -47,12 +51,58 @@ struct LandingInfo {
   float ground_speed;
   float vertical_speed;
   float gforce;
+
+  // Touchdown details, filled in from the frames around the touchdown
+  float contact_time = 0;         // Sim time of the first gear contact
+  float peak_vertical_speed = 0;  // Fastest descent rate around touchdown
+  float peak_gforce = 0;
+  float min_gforce = 0;
+
+  // Where the contact happened
+  double lat = 0;
+  double lon = 0;
+  float heading = 0;
+};
+
+// Landing analysis results, distances in meters and times in seconds.
+struct LandingAnalysis {
+  float contact_time = 0;
+
+  // Flare, from the flare height down to the contact
+  bool has_flare = false;
+  float flare_time = 0;
+  float flare_vertical_speed = 0;
+
+  // Float, right above the runway before the contact
+  float float_time = 0;
+  float float_distance = 0;
+
+  // Ground roll, from the contact down to taxi speed
+  bool ground_roll_complete = false;
+  float ground_roll_time = 0;
+  float ground_roll_distance = 0;
+
+  // Approach stability, from the 500 ft gate down to the flare height
+  size_t approach_samples = 0;
+  float vertical_speed_deviation = 0;
+  float heading_deviation = 0;  // degrees
+  bool stabilized = false;
 };
 
 // Flight loop client interface.
 struct FlightLoopClient {
+  // Called first thing on every flight loop callback, paused or not
+  virtual void OnFlightLoopTick() = 0;
+
   virtual void OnAirplaneFlying(const FlyingInfo& info) = 0;
   virtual void OnAirplaneLanded(const LandingInfo& info) = 0;
+  virtual void OnLandingAnalyzed(const LandingAnalysis& analysis) = 0;
+
+  // An AI or multiplayer aircraft landed. |id| is its mode S id, |aircraft|
+  // its ICAO type designator if known. Only the contact, peak descent and
+  // position are filled in |info|.
+  virtual void OnTrafficLanded(int id, const std::string& aircraft,
+                               const LandingInfo& info) = 0;
 };
 
 }  // namespace xplmpp
@@ -19,8 +19,237 @@
 
 #include "FlightMath.h"
 
+#include "Common.h"
+
+#if LANDEX_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace xplmpp {
 
+static const double kEarthRadius = 6372.8e3; // meters
+
+namespace {
+
+#if LANDEX_SSE2
+
+// Minimax polynomials for sin and cos over [-pi/4, pi/4] and for atan over
+// [-0.66, 0.66], and the extended precision pi/4 for the range reduction,
+// all from the Cephes Math Library. Coefficients go highest power first.
+static const double kSinCoef[] = {
+  1.58962301576546568060e-10, -2.50507477628578072866e-8,
+  2.75573136213857245213e-6, -1.98412698295895385996e-4,
+  8.33333333332211858878e-3, -1.66666666666666307295e-1,
+};
+static const double kCosCoef[] = {
+  -1.13585365213876817300e-11, 2.08757008419747316778e-9,
+  -2.75573141792967388112e-7, 2.48015872888517045348e-5,
+  -1.38888888888730564116e-3, 4.16666666666665929218e-2,
+};
+static const double kAtanP[] = {
+  -8.750608600031904122785e-1, -1.615753718733365076637e1,
+  -7.500855792314704667340e1, -1.228866684490136173410e2,
+  -6.485021904942025371773e1,
+};
+static const double kAtanQ[] = {  // leading 1 omitted
+  2.485846490142306297962e1, 1.650270098316988542046e2,
+  4.328810604912902668951e2, 4.853903996359136964868e2,
+  1.945506571482613964425e2,
+};
+static const double kPiO4Part1 = 7.85398125648498535156e-1;
+static const double kPiO4Part2 = 3.77489470793079817668e-8;
+static const double kPiO4Part3 = 2.69515142907905952645e-15;
+static const double kPiO2Tail = 6.123233995736765886130e-17;  // pi/2 - M_PI_2
+
+static const float kSinCoefF[] = {
+  -1.9515295891e-4f, 8.3321608736e-3f, -1.6666654611e-1f,
+};
+static const float kCosCoefF[] = {
+  2.443315711809948e-5f, -1.388731625493765e-3f, 4.166664568298827e-2f,
+};
+static const float kAtanCoefF[] = {
+  8.05374449538e-2f, -1.38776856032e-1f, 1.99777106478e-1f, -3.33329491539e-1f,
+};
+static const float kPiO4Part1F = 0.78515625f;
+static const float kPiO4Part2F = 2.4187564849853515625e-4f;
+static const float kPiO4Part3F = 3.77489497744594108e-8f;
+
+inline __m128d Select(__m128d mask, __m128d a, __m128d b) {
+  return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+inline __m128 Select(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+template<size_t N>
+inline __m128d Poly(__m128d x, const double (&coef)[N]) {
+  __m128d r = _mm_set1_pd(coef[0]);
+  for (size_t n = 1; n < N; ++n)
+    r = _mm_add_pd(_mm_mul_pd(r, x), _mm_set1_pd(coef[n]));
+  return r;
+}
+
+template<size_t N>
+inline __m128 Poly(__m128 x, const float (&coef)[N]) {
+  __m128 r = _mm_set1_ps(coef[0]);
+  for (size_t n = 1; n < N; ++n)
+    r = _mm_add_ps(_mm_mul_ps(r, x), _mm_set1_ps(coef[n]));
+  return r;
+}
+
+// Wraps longitude differences to [-180, 180]
+inline __m128d WrapLongitude(__m128d dlon) {
+  const __m128d v180 = _mm_set1_pd(180.0);
+  const __m128d v360 = _mm_set1_pd(360.0);
+  dlon = _mm_sub_pd(dlon, _mm_and_pd(_mm_cmpgt_pd(dlon, v180), v360));
+  return _mm_add_pd(dlon, _mm_and_pd(_mm_cmplt_pd(dlon, _mm_sub_pd(_mm_setzero_pd(), v180)), v360));
+}
+
+// Calculates sine and cosine of |x|, which must be well within +/-2^31.
+void SinCos(__m128d x, __m128d* sin, __m128d* cos) {
+  const __m128d sign_mask = _mm_set1_pd(-0.0);
+  __m128d sign = _mm_and_pd(x, sign_mask);
+  __m128d ax = _mm_andnot_pd(sign_mask, x);
+
+  // Octant rounded up to even, and the argument reduced to [-pi/4, pi/4]
+  __m128i j = _mm_cvttpd_epi32(_mm_mul_pd(ax, _mm_set1_pd(4.0 / M_PI)));
+  j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+  __m128d y = _mm_cvtepi32_pd(j);
+  __m128d z = _mm_sub_pd(ax, _mm_mul_pd(y, _mm_set1_pd(kPiO4Part1)));
+  z = _mm_sub_pd(z, _mm_mul_pd(y, _mm_set1_pd(kPiO4Part2)));
+  z = _mm_sub_pd(z, _mm_mul_pd(y, _mm_set1_pd(kPiO4Part3)));
+
+  __m128d zz = _mm_mul_pd(z, z);
+  __m128d ps = _mm_add_pd(z, _mm_mul_pd(_mm_mul_pd(z, zz), Poly(zz, kSinCoef)));
+  __m128d pc = _mm_add_pd(
+      _mm_sub_pd(_mm_set1_pd(1.0), _mm_mul_pd(zz, _mm_set1_pd(0.5))),
+      _mm_mul_pd(_mm_mul_pd(zz, zz), Poly(zz, kCosCoef)));
+
+  // Spread the octant to 64-bit lanes to make the lane masks
+  __m128i j64 = _mm_shuffle_epi32(j, _MM_SHUFFLE(1, 1, 0, 0));
+  __m128d swap = _mm_castsi128_pd(_mm_cmpeq_epi32(
+      _mm_and_si128(j64, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+  __m128d sin_sign = _mm_castsi128_pd(_mm_slli_epi64(
+      _mm_and_si128(j64, _mm_set1_epi32(4)), 61));
+  __m128d cos_sign = _mm_castsi128_pd(_mm_slli_epi64(
+      _mm_and_si128(_mm_add_epi32(j64, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 61));
+
+  *sin = _mm_xor_pd(_mm_xor_pd(Select(swap, pc, ps), sin_sign), sign);
+  *cos = _mm_xor_pd(Select(swap, ps, pc), cos_sign);
+}
+
+void SinCos(__m128 x, __m128* sin, __m128* cos) {
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+  __m128 sign = _mm_and_ps(x, sign_mask);
+  __m128 ax = _mm_andnot_ps(sign_mask, x);
+
+  __m128i j = _mm_cvttps_epi32(_mm_mul_ps(ax, _mm_set1_ps(static_cast<float>(4.0 / M_PI))));
+  j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+  __m128 y = _mm_cvtepi32_ps(j);
+  __m128 z = _mm_sub_ps(ax, _mm_mul_ps(y, _mm_set1_ps(kPiO4Part1F)));
+  z = _mm_sub_ps(z, _mm_mul_ps(y, _mm_set1_ps(kPiO4Part2F)));
+  z = _mm_sub_ps(z, _mm_mul_ps(y, _mm_set1_ps(kPiO4Part3F)));
+
+  __m128 zz = _mm_mul_ps(z, z);
+  __m128 ps = _mm_add_ps(z, _mm_mul_ps(_mm_mul_ps(z, zz), Poly(zz, kSinCoefF)));
+  __m128 pc = _mm_add_ps(
+      _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(zz, _mm_set1_ps(0.5f))),
+      _mm_mul_ps(_mm_mul_ps(zz, zz), Poly(zz, kCosCoefF)));
+
+  __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(
+      _mm_and_si128(j, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+  __m128 sin_sign = _mm_castsi128_ps(_mm_slli_epi32(
+      _mm_and_si128(j, _mm_set1_epi32(4)), 29));
+  __m128 cos_sign = _mm_castsi128_ps(_mm_slli_epi32(
+      _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+
+  *sin = _mm_xor_ps(_mm_xor_ps(Select(swap, pc, ps), sin_sign), sign);
+  *cos = _mm_xor_ps(Select(swap, ps, pc), cos_sign);
+}
+
+// Calculates atan2(|y|, |x|) for non-negative |y| and |x|, not both zero.
+__m128d Atan2Positive(__m128d y, __m128d x) {
+  // Reduce to atan(t) with t in [0, 1], then to [-0.66, 0.66]
+  __m128d swap = _mm_cmpgt_pd(y, x);
+  __m128d t = _mm_div_pd(_mm_min_pd(y, x), _mm_max_pd(y, x));
+
+  __m128d big = _mm_cmpgt_pd(t, _mm_set1_pd(0.66));
+  const __m128d one = _mm_set1_pd(1.0);
+  t = Select(big, _mm_div_pd(_mm_sub_pd(t, one), _mm_add_pd(t, one)), t);
+
+  __m128d z = _mm_mul_pd(t, t);
+  __m128d q = _mm_add_pd(z, _mm_set1_pd(kAtanQ[0]));
+  for (size_t n = 1; n < numbof(kAtanQ); ++n)
+    q = _mm_add_pd(_mm_mul_pd(q, z), _mm_set1_pd(kAtanQ[n]));
+  __m128d r = _mm_div_pd(_mm_mul_pd(z, Poly(z, kAtanP)), q);
+  r = _mm_add_pd(t, _mm_mul_pd(t, r));
+  r = _mm_add_pd(r, _mm_and_pd(big, _mm_set1_pd(M_PI_4 + 0.5 * kPiO2Tail)));
+
+  return Select(swap,
+                _mm_add_pd(_mm_sub_pd(_mm_set1_pd(M_PI_2), r), _mm_set1_pd(kPiO2Tail)),
+                r);
+}
+
+__m128 Atan2Positive(__m128 y, __m128 x) {
+  __m128 swap = _mm_cmpgt_ps(y, x);
+  __m128 t = _mm_div_ps(_mm_min_ps(y, x), _mm_max_ps(y, x));
+
+  __m128 big = _mm_cmpgt_ps(t, _mm_set1_ps(0.4142135623730950f));
+  const __m128 one = _mm_set1_ps(1.0f);
+  t = Select(big, _mm_div_ps(_mm_sub_ps(t, one), _mm_add_ps(t, one)), t);
+
+  __m128 z = _mm_mul_ps(t, t);
+  __m128 r = _mm_add_ps(t, _mm_mul_ps(_mm_mul_ps(z, t), Poly(z, kAtanCoefF)));
+  r = _mm_add_ps(r, _mm_and_ps(big, _mm_set1_ps(static_cast<float>(M_PI_4))));
+
+  return Select(swap, _mm_sub_ps(_mm_set1_ps(static_cast<float>(M_PI_2)), r), r);
+}
+
+// Haversine Formula with the reference point cosine precomputed, given the
+// half latitude and longitude differences in radians.
+__m128d Haversine(__m128d half_dlat, __m128d half_dlon, __m128d lat,
+                  double cos_lat0) {
+  __m128d sin_dlat, sin_dlon, cos_lat, unused;
+  SinCos(half_dlat, &sin_dlat, &unused);
+  SinCos(half_dlon, &sin_dlon, &unused);
+  SinCos(lat, &unused, &cos_lat);
+
+  __m128d a = _mm_add_pd(
+      _mm_mul_pd(sin_dlat, sin_dlat),
+      _mm_mul_pd(_mm_mul_pd(_mm_set1_pd(cos_lat0), cos_lat),
+                 _mm_mul_pd(sin_dlon, sin_dlon)));
+  a = _mm_min_pd(_mm_max_pd(a, _mm_setzero_pd()), _mm_set1_pd(1.0));
+
+  __m128d c = Atan2Positive(_mm_sqrt_pd(a),
+                            _mm_sqrt_pd(_mm_sub_pd(_mm_set1_pd(1.0), a)));
+  return _mm_mul_pd(c, _mm_set1_pd(2.0 * kEarthRadius));
+}
+
+// Same as above, but takes the colatitude instead of the latitude, which
+// keeps the precision of cos(lat) close to the poles.
+__m128 Haversine(__m128 half_dlat, __m128 half_dlon, __m128 colat,
+                 float cos_lat0) {
+  __m128 sin_dlat, sin_dlon, cos_lat, unused;
+  SinCos(half_dlat, &sin_dlat, &unused);
+  SinCos(half_dlon, &sin_dlon, &unused);
+  SinCos(colat, &cos_lat, &unused);
+
+  __m128 a = _mm_add_ps(
+      _mm_mul_ps(sin_dlat, sin_dlat),
+      _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(cos_lat0), cos_lat),
+                 _mm_mul_ps(sin_dlon, sin_dlon)));
+  a = _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+  __m128 c = Atan2Positive(_mm_sqrt_ps(a),
+                           _mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), a)));
+  return _mm_mul_ps(c, _mm_set1_ps(static_cast<float>(2.0 * kEarthRadius)));
+}
+
+#endif  // #if LANDEX_SSE2
+
+}  // namespace
+
 // Calculate distance between two points on Earth using Haversine Formula
 double CalcEarthDistance(double lat1, double lon1, double lat2, double lon2) {
   lat1 = DegreeToRadian(lat1);
@@ -34,8 +263,118 @@ double CalcEarthDistance(double lat1, double lon1, double lat2, double lon2) {
   double a = pow(sin(dlat / 2.0), 2.0) +
     cos(lat1) * cos(lat2) * pow(sin(dlon / 2.0), 2.0);
   double c = 2.0 * atan2(sqrt(a), sqrt(1.0 - a));
-  static const double kEarthRadius = 6372.8e3; // meters
   return c * kEarthRadius;
 }
 
+void CalcEarthDistances(double lat0, double lon0,
+                        const double* lat, const double* lon, size_t count,
+                        double* distance) {
+  size_t n = 0;
+#if LANDEX_SSE2
+  const double cos_lat0 = cos(DegreeToRadian(lat0));
+  const __m128d half_radians = _mm_set1_pd(M_PI / 360.0);
+  const __m128d radians = _mm_set1_pd(M_PI / 180.0);
+  const __m128d vlat0 = _mm_set1_pd(lat0);
+  const __m128d vlon0 = _mm_set1_pd(lon0);
+
+  // The tail, if any, is padded with the reference point
+  double lat_tail[2] = { lat0, lat0 };
+  double lon_tail[2] = { lon0, lon0 };
+  for (; n < count; n += 2) {
+    const double* plat = lat + n;
+    const double* plon = lon + n;
+    if (n + 2 > count) {
+      lat_tail[0] = lat[n];
+      lon_tail[0] = lon[n];
+      plat = lat_tail;
+      plon = lon_tail;
+    }
+
+    __m128d vlat = _mm_loadu_pd(plat);
+    __m128d vlon = _mm_loadu_pd(plon);
+    __m128d d = Haversine(_mm_mul_pd(_mm_sub_pd(vlat, vlat0), half_radians),
+                          _mm_mul_pd(WrapLongitude(_mm_sub_pd(vlon, vlon0)), half_radians),
+                          _mm_mul_pd(vlat, radians), cos_lat0);
+
+    if (n + 2 > count) {
+      _mm_store_sd(distance + n, d);
+    } else {
+      _mm_storeu_pd(distance + n, d);
+    }
+  }
+#endif
+  for (; n < count; ++n)
+    distance[n] = CalcEarthDistance(lat0, lon0, lat[n], lon[n]);
+}
+
+void CalcEarthDistancesFast(double lat0, double lon0,
+                            const double* lat, const double* lon, size_t count,
+                            float* distance) {
+  size_t n = 0;
+#if LANDEX_SSE2
+  // Coordinate differences are taken in double precision, the rest is done
+  // in single precision.
+  const float cos_lat0 = static_cast<float>(cos(DegreeToRadian(lat0)));
+  const __m128d half_radians = _mm_set1_pd(M_PI / 360.0);
+  const __m128d radians = _mm_set1_pd(M_PI / 180.0);
+  const __m128d vlat0 = _mm_set1_pd(lat0);
+  const __m128d vlon0 = _mm_set1_pd(lon0);
+  const __m128d v90 = _mm_set1_pd(90.0);
+
+  double lat_tail[4] = { lat0, lat0, lat0, lat0 };
+  double lon_tail[4] = { lon0, lon0, lon0, lon0 };
+  for (; n < count; n += 4) {
+    const double* plat = lat + n;
+    const double* plon = lon + n;
+    size_t tail = count - n;
+    if (tail < 4) {
+      for (size_t k = 0; k < tail; ++k) {
+        lat_tail[k] = lat[n + k];
+        lon_tail[k] = lon[n + k];
+      }
+      plat = lat_tail;
+      plon = lon_tail;
+    }
+
+    __m128d lat_lo = _mm_loadu_pd(plat);
+    __m128d lat_hi = _mm_loadu_pd(plat + 2);
+    __m128d lon_lo = _mm_loadu_pd(plon);
+    __m128d lon_hi = _mm_loadu_pd(plon + 2);
+
+    __m128 half_dlat = _mm_movelh_ps(
+        _mm_cvtpd_ps(_mm_mul_pd(_mm_sub_pd(lat_lo, vlat0), half_radians)),
+        _mm_cvtpd_ps(_mm_mul_pd(_mm_sub_pd(lat_hi, vlat0), half_radians)));
+    __m128 half_dlon = _mm_movelh_ps(
+        _mm_cvtpd_ps(_mm_mul_pd(WrapLongitude(_mm_sub_pd(lon_lo, vlon0)), half_radians)),
+        _mm_cvtpd_ps(_mm_mul_pd(WrapLongitude(_mm_sub_pd(lon_hi, vlon0)), half_radians)));
+    const __m128d sign_mask = _mm_set1_pd(-0.0);
+    __m128 colat = _mm_movelh_ps(
+        _mm_cvtpd_ps(_mm_mul_pd(_mm_sub_pd(v90, _mm_andnot_pd(sign_mask, lat_lo)), radians)),
+        _mm_cvtpd_ps(_mm_mul_pd(_mm_sub_pd(v90, _mm_andnot_pd(sign_mask, lat_hi)), radians)));
+
+    __m128 d = Haversine(half_dlat, half_dlon, colat, cos_lat0);
+
+    if (tail < 4) {
+      float d_tail[4];
+      _mm_storeu_ps(d_tail, d);
+      for (size_t k = 0; k < tail; ++k)
+        distance[n + k] = d_tail[k];
+    } else {
+      _mm_storeu_ps(distance + n, d);
+    }
+  }
+#endif
+  for (; n < count; ++n)
+    distance[n] = static_cast<float>(CalcEarthDistance(lat0, lon0, lat[n], lon[n]));
+}
+
+RunwayFrame::RunwayFrame(double lat, double lon, float heading)
+: lat_(lat)
+, lon_(lon)
+, north_scale_(DegreeToRadian(1.0) * kEarthRadius)
+, east_scale_(DegreeToRadian(1.0) * kEarthRadius * cos(DegreeToRadian(lat)))
+, sin_heading_(sin(DegreeToRadian(heading)))
+, cos_heading_(cos(DegreeToRadian(heading))) {
+}
+
 }  // namespace xplmpp
@@ -22,6 +22,7 @@
 
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <stddef.h>
 
 namespace xplmpp {
 
@@ -45,9 +46,74 @@ inline double DegreeToRadian(double angle) {
   return M_PI * angle / 180.0;
 }
 
+// Returns the difference between two headings, wrapped at north so that
+// e.g. 359 and 1 are 2 degrees apart.
+inline float HeadingDelta(float heading, float heading2) {
+  float delta = fabsf(heading - heading2);
+  return delta > 180.0f ? 360.0f - delta : delta;
+}
+
 // Calculates distance between two points on Earth using Haversine Formula
 double CalcEarthDistance(double lat1, double lon1, double lat2, double lon2);
 
+// Calculates distances from |lat0|, |lon0| to |count| points at once, same
+// as CalcEarthDistance() but vectorized. Agrees with it to within a few
+// micrometers.
+void CalcEarthDistances(double lat0, double lon0,
+                        const double* lat, const double* lon, size_t count,
+                        double* distance);
+
+// Single precision version of the above, several times faster. Agrees with
+// CalcEarthDistance() to within a few centimeters or a few parts per million,
+// except within a thousand miles or so of the antipode of |lat0|, |lon0|.
+void CalcEarthDistancesFast(double lat0, double lon0,
+                            const double* lat, const double* lon, size_t count,
+                            float* distance);
+
+// Represents a local tangent plane aligned with the runway and anchored at
+// the touchdown point. Projecting a point takes a few multiplies instead of
+// the trigonometry of the Haversine Formula, and is accurate to well under
+// a meter over the few miles of an approach.
+class RunwayFrame {
+public:
+  RunwayFrame() = default;
+  RunwayFrame(double lat, double lon, float heading);
+
+  // Projects |lat|, |lon| to the distance along the runway heading (positive
+  // past the anchor point) and across it (positive to the right).
+  void Project(double lat, double lon, float* along, float* cross) const {
+    double dlon = lon - lon_;
+    if (dlon > 180.0) dlon -= 360.0; else
+    if (dlon < -180.0) dlon += 360.0;
+
+    double east = dlon * east_scale_;
+    double north = (lat - lat_) * north_scale_;
+
+    *along = static_cast<float>(east * sin_heading_ + north * cos_heading_);
+    *cross = static_cast<float>(east * cos_heading_ - north * sin_heading_);
+  }
+
+  float AlongTrack(double lat, double lon) const {
+    float along, cross;
+    Project(lat, lon, &along, &cross);
+    return along;
+  }
+
+  float CrossTrack(double lat, double lon) const {
+    float along, cross;
+    Project(lat, lon, &along, &cross);
+    return cross;
+  }
+
+private:
+  double lat_ = 0.0;
+  double lon_ = 0.0;
+  double north_scale_ = 0.0;  // meters per degree of latitude
+  double east_scale_ = 0.0;   // meters per degree of longitude at anchor
+  double sin_heading_ = 0.0;
+  double cos_heading_ = 1.0;
+};
+
 }  // namespace xplmpp
 
 #endif // #ifndef LANDEX_FLIGHTMATH_H
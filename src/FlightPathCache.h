@@ -0,0 +1,77 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Projected flight path cache.
+
+#ifndef LANDEX_FLIGHTPATHCACHE_H
+#define LANDEX_FLIGHTPATHCACHE_H
+
+#include <deque>
+#include <vector>
+
+#include "Common.h"
+#include "FlightPathPyramid.h"
+#include "xplmpp/Rect.h"
+
+namespace xplmpp {
+
+// Holds the flight path projected to window coordinates between frames, so
+// that only the samples added since the previous frame need projecting. It is
+// filled and invalidated by GlideSlope.
+struct FlightPathCache {
+  struct Vertex {
+    Vertex(const PointF& pt, size_t sequence) : pt(pt), sequence(sequence) {}
+
+    PointF pt;
+    size_t sequence;  // FlightData sequence number of the sample
+  };
+
+  bool valid = false;
+
+  // The state the cache was built for
+  RectF rc;
+  RectF rc_slope;
+  PointF slope_right;
+  unsigned generation = 0;
+  unsigned last_landing_generation = 0;
+  bool has_landing = false;
+  size_t landing_sequence = 0;
+
+  // Landing point, where the paths before and after landing start
+  PointF landing_pt;
+
+  // Next sample to project
+  size_t next_sequence = 0;
+
+  // Path before landing walking back in time from the landing point
+  std::vector<Vertex> before_landing;
+
+  // Path after landing walking forward in time from the landing point
+  std::vector<Vertex> after_landing;
+  bool after_landing_done = false;
+
+  // Path approaching the last landing point with no landing yet, walking
+  // forward in time up to the latest sample
+  std::deque<Vertex> approach;
+
+  // Path summaries for the zoomed and panned views
+  FlightPathPyramid pyramid;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_FLIGHTPATHCACHE_H
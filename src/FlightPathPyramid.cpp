@@ -0,0 +1,206 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Multi-resolution flight path summaries implementation.
+
+#include "FlightPathPyramid.h"
+
+#include <algorithm>
+
+namespace xplmpp {
+
+// Summaries that fit in a pixel are drawn as a single vertex
+static const float kPixelSize = 1.0f;
+
+void FlightPathPyramid::Reset(const FlightData& data) {
+  valid_ = data.has_last_landing();
+  generation_ = data.generation();
+  last_landing_generation_ = data.last_landing_generation();
+  next_sequence_ = data.first_sequence();
+  latest_run_begin_ = next_sequence_;
+  has_landing_run_ = false;
+
+  // Enough levels for the top one to cover the whole capacity in a bucket or
+  // two, and enough room in each for the buckets the capacity spans
+  size_t level_count = 1;
+  while ((size_t(1) << level_count) < data.capacity())
+    ++level_count;
+
+  levels_.resize(level_count);
+  for (size_t n = 0; n < level_count; ++n) {
+    Level& level = levels_[n];
+    level.nodes.resize((data.capacity() >> (n + 1)) + 2);
+    level.first_bucket = level.end_bucket = next_sequence_ >> (n + 1);
+  }
+}
+
+void FlightPathPyramid::Update(const FlightData& data) {
+  if (levels_.empty() ||
+      generation_ != data.generation() ||
+      last_landing_generation_ != data.last_landing_generation() ||
+      next_sequence_ < data.first_sequence())
+    Reset(data);
+
+  if (!valid_)
+    return;
+
+  // Forget the buckets of the samples dropped from the flight data
+  size_t first_sequence = data.first_sequence();
+  for (size_t n = 0; n < levels_.size(); ++n) {
+    Level& level = levels_[n];
+    level.first_bucket = std::max(level.first_bucket, first_sequence >> (n + 1));
+  }
+
+  size_t end_sequence = data.end_sequence();
+  for (size_t sequence = next_sequence_; sequence < end_sequence; ++sequence) {
+    size_t index = sequence - first_sequence;
+    Add(sequence, data.GetLastLandingDistance(data.lat(index), data.lon(index)),
+        data.agl(index));
+    if (!data.IsLastLandingHeading(data.heading(index)))
+      latest_run_begin_ = sequence + 1;
+  }
+
+  next_sequence_ = end_sequence;
+}
+
+void FlightPathPyramid::Add(size_t sequence, float x, float y) {
+  for (size_t n = 0; n < levels_.size(); ++n) {
+    Level& level = levels_[n];
+    size_t bucket = sequence >> (n + 1);
+    if (bucket + 1 == level.end_bucket) {
+      Node& node = level.node(bucket);
+      node.min_x = std::min(node.min_x, x);
+      node.max_x = std::max(node.max_x, x);
+      node.min_y = std::min(node.min_y, y);
+      node.max_y = std::max(node.max_y, y);
+    } else {
+      level.node(bucket) = Node{ x, x, y, y };
+      level.end_bucket = bucket + 1;
+      if (level.end_bucket - level.first_bucket > level.nodes.size())
+        level.first_bucket = level.end_bucket - level.nodes.size();
+    }
+  }
+}
+
+void FlightPathPyramid::GetLandingRun(const FlightData& data, size_t landing_index,
+                                      size_t& begin, size_t& end) {
+  size_t first_sequence = data.first_sequence();
+  size_t landing_sequence = data.sequence(landing_index);
+
+  // Samples before landing do not change, so the beginning is found once
+  if (!has_landing_run_ || landing_sequence_ != landing_sequence) {
+    has_landing_run_ = true;
+    landing_run_done_ = false;
+    landing_sequence_ = landing_sequence;
+    landing_run_begin_ = data.sequence(data.FindLastLandingHeadingBegin(landing_index));
+    landing_run_end_ = landing_sequence;
+  }
+
+  // The end moves on with the new samples until one turns off the heading
+  if (!landing_run_done_) {
+    size_t index = data.FindLastLandingHeadingEnd(
+        std::max(landing_run_end_, first_sequence) - first_sequence);
+    landing_run_end_ = data.sequence(index);
+    landing_run_done_ = index < data.size();
+  }
+
+  begin = std::max(landing_run_begin_, first_sequence) - first_sequence;
+  end = std::max(landing_run_end_, first_sequence) - first_sequence;
+}
+
+size_t FlightPathPyramid::GetLatestRunBegin(const FlightData& data) const {
+  size_t first_sequence = data.first_sequence();
+  return std::min(std::max(latest_run_begin_, first_sequence), data.end_sequence()) -
+         first_sequence;
+}
+
+void FlightPathPyramid::Render(const FlightData& data, size_t begin, size_t end,
+                               const PathTransform& transform, const RectF& clip,
+                               PathSink& sink) const {
+  if (!valid_ || begin >= end)
+    return;
+
+  assert(end <= data.size());
+  assert(data.end_sequence() <= next_sequence_);
+
+  size_t begin_sequence = data.sequence(begin);
+  size_t end_sequence = data.sequence(end);
+
+  size_t top = levels_.size();
+  for (size_t bucket = begin_sequence >> top; bucket <= (end_sequence - 1) >> top; ++bucket) {
+    RenderBucket(data, top, bucket, begin_sequence, end_sequence, transform, clip, sink);
+  }
+
+  sink.OnBreak();
+}
+
+void FlightPathPyramid::RenderBucket(const FlightData& data, size_t level, size_t bucket,
+                                     size_t begin_sequence, size_t end_sequence,
+                                     const PathTransform& transform, const RectF& clip,
+                                     PathSink& sink) const {
+  size_t lo = bucket << level;
+  size_t hi = (bucket + 1) << level;
+  if (hi <= begin_sequence || lo >= end_sequence)
+    return;
+
+  if (level == 0) {
+    size_t index = bucket - data.first_sequence();
+    PointF pt = transform(data.GetLastLandingDistance(data.lat(index), data.lon(index)),
+                          data.agl(index));
+    if (clip.PtInRect(pt)) {
+      sink.OnVertex(pt);
+    } else {
+      sink.OnBreak();
+    }
+    return;
+  }
+
+  // Only the buckets entirely in the range have summaries of just the
+  // samples asked for, the others are split down to the samples.
+  if (lo >= begin_sequence && hi <= end_sequence) {
+    const Node& node = levels_[level - 1].node(bucket);
+    PointF pt = transform(node.min_x, node.min_y);
+    PointF pt2 = transform(node.max_x, node.max_y);
+    float left = std::min(pt.x, pt2.x);
+    float right = std::max(pt.x, pt2.x);
+    float bottom = std::min(pt.y, pt2.y);
+    float top = std::max(pt.y, pt2.y);
+
+    if (right < clip.left || left >= clip.right ||
+        top < clip.bottom || bottom >= clip.top) {
+      sink.OnBreak();
+      return;
+    }
+
+    if (right - left <= kPixelSize && top - bottom <= kPixelSize) {
+      PointF center((left + right) / 2, (bottom + top) / 2);
+      if (clip.PtInRect(center)) {
+        sink.OnVertex(center);
+      } else {
+        sink.OnBreak();
+      }
+      return;
+    }
+  }
+
+  RenderBucket(data, level - 1, bucket * 2, begin_sequence, end_sequence,
+               transform, clip, sink);
+  RenderBucket(data, level - 1, bucket * 2 + 1, begin_sequence, end_sequence,
+               transform, clip, sink);
+}
+
+}  // namespace xplmpp
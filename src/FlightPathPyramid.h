@@ -0,0 +1,132 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Multi-resolution flight path summaries.
+
+#ifndef LANDEX_FLIGHTPATHPYRAMID_H
+#define LANDEX_FLIGHTPATHPYRAMID_H
+
+#include <vector>
+
+#include "Common.h"
+#include "FlightData.h"
+#include "xplmpp/Rect.h"
+
+namespace xplmpp {
+
+// Maps the runway plane, distance to the last landing point along the
+// landing heading and AGL in meters, to window coordinates.
+struct PathTransform {
+  PointF operator()(float x, float y) const {
+    return PointF(x * scale_x + offset_x, y * scale_y + offset_y);
+  }
+
+  float scale_x = 1.0f;
+  float offset_x = 0.0f;
+  float scale_y = 1.0f;
+  float offset_y = 0.0f;
+};
+
+// Receives the path rendered from a FlightPathPyramid.
+struct PathSink {
+  virtual void OnVertex(const PointF& pt) = 0;
+
+  // The path leaves the clip rectangle, the next vertex starts a new piece.
+  virtual void OnBreak() = 0;
+};
+
+// Keeps min/max summaries of the flight path on the runway plane over runs
+// of 2, 4, 8... samples, so that the path can be drawn at any zoom and pan
+// visiting about as many summaries as there are pixels along it, however
+// many samples there are. The summaries are keyed by sample sequence
+// numbers, so they survive the oldest samples being dropped and are only
+// added to as new samples come in.
+class FlightPathPyramid {
+public:
+  FlightPathPyramid() = default;
+  ~FlightPathPyramid() = default;
+
+  // Catches up with the samples added to |data|, starting over when the
+  // data is reset or the last landing changes.
+  void Update(const FlightData& data);
+
+  bool valid() const { return valid_; }
+  size_t level_count() const { return levels_.size(); }
+
+  // Sends the path through the samples from |begin| to |end| (indexes into
+  // |data|) in time order, simplified to about a pixel, and broken up where
+  // it leaves |clip|. Update() must have been called for |data|.
+  void Render(const FlightData& data, size_t begin, size_t end,
+              const PathTransform& transform, const RectF& clip,
+              PathSink& sink) const;
+
+  // Finds the samples around the landing at |landing_index| that are on the
+  // last landing heading, the same as FlightData::FindLastLandingHeadingBegin()
+  // and FindLastLandingHeadingEnd() do, only remembering what was found so
+  // that each sample is looked at once.
+  void GetLandingRun(const FlightData& data, size_t landing_index,
+                     size_t& begin, size_t& end);
+
+  // Returns the index of the first sample in the latest run of samples on the
+  // last landing heading. Update() must have been called for |data|.
+  size_t GetLatestRunBegin(const FlightData& data) const;
+
+private:
+  struct Node {
+    float min_x, max_x;
+    float min_y, max_y;
+  };
+
+  // Level n summarizes runs of 2^(n+1) samples, bucket b covering the
+  // sequence numbers from b * 2^(n+1) on. The nodes are kept in a ring
+  // indexed by the bucket number.
+  struct Level {
+    std::vector<Node> nodes;
+    size_t first_bucket = 0;
+    size_t end_bucket = 0;
+
+    Node& node(size_t bucket) { return nodes[bucket % nodes.size()]; }
+    const Node& node(size_t bucket) const { return nodes[bucket % nodes.size()]; }
+  };
+
+  void Reset(const FlightData& data);
+  void Add(size_t sequence, float x, float y);
+
+  void RenderBucket(const FlightData& data, size_t level, size_t bucket,
+                    size_t begin_sequence, size_t end_sequence,
+                    const PathTransform& transform, const RectF& clip,
+                    PathSink& sink) const;
+
+  bool valid_ = false;
+  unsigned generation_ = 0;
+  unsigned last_landing_generation_ = 0;
+  size_t next_sequence_ = 0;
+
+  std::vector<Level> levels_;
+
+  // Landing heading runs, by sequence number
+  size_t latest_run_begin_ = 0;
+  bool has_landing_run_ = false;
+  bool landing_run_done_ = false;
+  size_t landing_sequence_ = 0;
+  size_t landing_run_begin_ = 0;
+  size_t landing_run_end_ = 0;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_FLIGHTPATHPYRAMID_H
@@ -0,0 +1,268 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Binary flight recorder implementation.
+
+#include "FlightRecorder.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace xplmpp {
+
+static const size_t kQueueCapacity = 4096;  // records
+static const size_t kBlockSize = 64 * 1024;  // bytes
+static const auto kWriterIdleSleep = std::chrono::milliseconds(20);
+static const auto kWriterFlushPeriod = std::chrono::seconds(2);
+
+/*
+ * Flight record implementation.
+ */
+FlightRecord::FlightRecord(const FlightSnapshot& snapshot, int state)
+: time(snapshot.time)
+, faxil_gear(snapshot.faxil_gear)
+, ground_speed(snapshot.ground_speed)
+, vertical_speed(snapshot.vertical_speed)
+, gforce(snapshot.gforce)
+, agl(snapshot.agl)
+, msl(snapshot.msl)
+, heading(snapshot.heading)
+, state(static_cast<uint8_t>(state))
+, flags(snapshot.replay_mode ? kReplayMode : 0)
+, reserved(0)
+, reserved2(0)
+, lat(snapshot.lat)
+, lon(snapshot.lon) {
+}
+
+void FlightRecord::ToSnapshot(FlightSnapshot& snapshot) const {
+  snapshot.time = time;
+  snapshot.replay_mode = !!(flags & kReplayMode);
+  snapshot.faxil_gear = faxil_gear;
+  snapshot.ground_speed = ground_speed;
+  snapshot.vertical_speed = vertical_speed;
+  snapshot.gforce = gforce;
+  snapshot.agl = agl;
+  snapshot.msl = msl;
+  snapshot.lat = lat;
+  snapshot.lon = lon;
+  snapshot.heading = heading;
+}
+
+/*
+ * Flight recorder implementation.
+ */
+FlightRecorder::FlightRecorder()
+: queue_(kQueueCapacity)
+, block_(kBlockSize) {
+}
+
+FlightRecorder::~FlightRecorder() {
+  Stop();
+}
+
+bool FlightRecorder::Start(const std::string& filename) {
+  if (is_recording())
+    return false;
+
+  file_ = fopen(filename.c_str(), "wb");
+  if (!file_) {
+    LOG(ERROR) << "Could not create flight record file '" << filename << "'.";
+    return false;
+  }
+
+  FlightRecordHeader header;
+  memcpy(header.magic, kFlightRecordMagic, sizeof(header.magic));
+  header.version = kFlightRecordVersion;
+  header.header_size = sizeof(FlightRecordHeader);
+  header.record_size = sizeof(FlightRecord);
+  if (fwrite(&header, sizeof(header), 1, file_) != 1) {
+    LOG(ERROR) << "Could not write flight record file '" << filename << "'.";
+    fclose(file_);
+    file_ = nullptr;
+    return false;
+  }
+
+  LOG(INFO) << "Recording flight to '" << filename << "'.";
+
+  dropped_count_ = 0;
+  block_size_ = 0;
+  stopping_ = false;
+  write_failed_ = false;
+  writer_thread_ = std::thread(&FlightRecorder::WriterThread, this);
+  return true;
+}
+
+void FlightRecorder::Stop() {
+  if (!is_recording())
+    return;
+
+  stopping_ = true;
+  writer_thread_.join();
+
+  fclose(file_);
+  file_ = nullptr;
+
+  if (write_failed_) {
+    LOG(ERROR) << "Could not write some flight records.";
+  }
+
+  if (dropped_count_) {
+    LOG(WARNING) << "Flight recorder dropped " << dropped_count_ << " records.";
+  }
+}
+
+void FlightRecorder::WriterThread() {
+  auto last_flush = std::chrono::steady_clock::now();
+
+  for (;;) {
+    // Check before draining so that nothing pushed before Stop() is lost
+    bool stopping = stopping_;
+
+    FlightRecord record;
+    bool popped = false;
+    while (queue_.TryPop(record)) {
+      popped = true;
+      if (block_size_ + sizeof(record) > block_.size())
+        Flush();
+      memcpy(&block_[block_size_], &record, sizeof(record));
+      block_size_ += sizeof(record);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (stopping || now - last_flush >= kWriterFlushPeriod) {
+      Flush();
+      fflush(file_);
+      last_flush = now;
+    }
+
+    if (stopping)
+      break;
+
+    if (!popped)
+      std::this_thread::sleep_for(kWriterIdleSleep);
+  }
+}
+
+bool FlightRecorder::Flush() {
+  if (!block_size_)
+    return true;
+
+  bool ok = fwrite(&block_[0], 1, block_size_, file_) == block_size_;
+  if (!ok)
+    write_failed_ = true;
+  block_size_ = 0;
+  return ok;
+}
+
+/*
+ * Flight record reader implementation.
+ */
+FlightRecordReader::FlightRecordReader()
+: block_(kBlockSize / sizeof(FlightRecord)) {
+}
+
+FlightRecordReader::~FlightRecordReader() {
+  Close();
+}
+
+bool FlightRecordReader::Open(const std::string& filename) {
+  Close();
+
+  file_ = fopen(filename.c_str(), "rb");
+  if (!file_) {
+    LOG(ERROR) << "Could not open flight record file '" << filename << "'.";
+    return false;
+  }
+
+  FlightRecordHeader header;
+  if (fread(&header, sizeof(header), 1, file_) != 1 ||
+      memcmp(header.magic, kFlightRecordMagic, sizeof(header.magic)) != 0 ||
+      header.version != kFlightRecordVersion ||
+      header.header_size < sizeof(header) ||
+      header.record_size != sizeof(FlightRecord) ||
+      fseek(file_, header.header_size, SEEK_SET) != 0) {
+    LOG(ERROR) << "Invalid flight record file '" << filename << "'.";
+    Close();
+    return false;
+  }
+
+  block_size_ = 0;
+  block_index_ = 0;
+  return true;
+}
+
+void FlightRecordReader::Close() {
+  if (file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+bool FlightRecordReader::Read(FlightRecord& record) {
+  if (block_index_ == block_size_ && !Fill())
+    return false;
+
+  record = block_[block_index_++];
+  return true;
+}
+
+bool FlightRecordReader::Fill() {
+  if (!file_)
+    return false;
+
+  block_size_ = fread(&block_[0], sizeof(FlightRecord), block_.size(), file_);
+  block_index_ = 0;
+  return block_size_ > 0;
+}
+
+/*
+ * Flight record map implementation.
+ */
+bool FlightRecordMap::Open(const std::string& filename) {
+  Close();
+
+  if (!file_.OpenReadOnly(filename))
+    return false;
+
+  // Records are read in place, so they must be aligned
+  const FlightRecordHeader* header =
+      reinterpret_cast<const FlightRecordHeader*>(file_.data());
+  if (file_.size() < sizeof(FlightRecordHeader) ||
+      memcmp(header->magic, kFlightRecordMagic, sizeof(header->magic)) != 0 ||
+      header->version != kFlightRecordVersion ||
+      header->header_size < sizeof(FlightRecordHeader) ||
+      header->header_size > file_.size() ||
+      header->header_size % alignof(FlightRecord) != 0 ||
+      header->record_size != sizeof(FlightRecord)) {
+    LOG(ERROR) << "Invalid flight record file '" << filename << "'.";
+    Close();
+    return false;
+  }
+
+  records_ = reinterpret_cast<const FlightRecord*>(file_.data() + header->header_size);
+  size_ = (file_.size() - header->header_size) / sizeof(FlightRecord);
+  return true;
+}
+
+void FlightRecordMap::Close() {
+  file_.Close();
+  records_ = nullptr;
+  size_ = 0;
+}
+
+}  // namespace xplmpp
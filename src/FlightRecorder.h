@@ -0,0 +1,166 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Binary flight recorder.
+
+#ifndef LANDEX_FLIGHTRECORDER_H
+#define LANDEX_FLIGHTRECORDER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "Common.h"
+#include "FlightSnapshot.h"
+#include "MappedFile.h"
+#include "SpscQueue.h"
+
+namespace xplmpp {
+
+// Flight record file header. The file is a header followed by fixed size
+// little-endian records, so it can be memory mapped and read as an array.
+struct FlightRecordHeader {
+  char magic[4];         // kFlightRecordMagic
+  uint32_t version;      // kFlightRecordVersion
+  uint32_t header_size;  // offset of the first record
+  uint32_t record_size;  // sizeof(FlightRecord)
+};
+
+static const char kFlightRecordMagic[4] = { 'L', 'X', 'F', 'R' };
+static const uint32_t kFlightRecordVersion = 1;
+
+// Flight record, one per flight loop tick.
+struct FlightRecord {
+  enum Flags : uint8_t {
+    kReplayMode = 0x01,
+  };
+
+  FlightRecord() = default;
+  FlightRecord(const FlightSnapshot& snapshot, int state);
+
+  void ToSnapshot(FlightSnapshot& snapshot) const;
+
+  float time;
+  float faxil_gear;
+  float ground_speed;
+  float vertical_speed;
+  float gforce;
+  float agl;
+  float msl;
+  float heading;
+  uint8_t state;     // flight loop state when recorded
+  uint8_t flags;
+  uint16_t reserved;
+  uint32_t reserved2;
+  double lat;
+  double lon;
+};
+
+static_assert(sizeof(FlightRecordHeader) == 16, "FlightRecordHeader layout");
+static_assert(sizeof(FlightRecord) == 56, "FlightRecord layout");
+
+// Writes flight records to a file. Records are handed over to a writer
+// thread through a lock-free queue and written in large blocks, so Record()
+// never blocks the calling thread. Records that do not fit in the queue are
+// dropped and counted.
+class FlightRecorder {
+public:
+  FlightRecorder();
+  ~FlightRecorder();
+
+  bool Start(const std::string& filename);
+  void Stop();
+
+  bool is_recording() const { return file_ != nullptr; }
+
+  void Record(const FlightRecord& record) {
+    if (!queue_.TryPush(record))
+      ++dropped_count_;
+  }
+
+  size_t dropped_count() const { return dropped_count_; }
+
+private:
+  void WriterThread();
+  bool Flush();
+
+  SpscQueue<FlightRecord> queue_;
+  size_t dropped_count_ = 0;
+
+  FILE* file_ = nullptr;
+  std::vector<uint8_t> block_;
+  size_t block_size_ = 0;
+
+  std::thread writer_thread_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<bool> write_failed_{false};
+};
+
+// Reads flight records back from a file written by FlightRecorder.
+class FlightRecordReader {
+public:
+  FlightRecordReader();
+  ~FlightRecordReader();
+
+  bool Open(const std::string& filename);
+  void Close();
+
+  // Returns false at the end of the file.
+  bool Read(FlightRecord& record);
+
+private:
+  bool Fill();
+
+  FILE* file_ = nullptr;
+  std::vector<FlightRecord> block_;
+  size_t block_size_ = 0;
+  size_t block_index_ = 0;
+};
+
+// Maps a file written by FlightRecorder into memory and gives its records as
+// an array, with no copying. A record cut short at the end of the file, e.g.
+// by a crash while recording, is left out.
+class FlightRecordMap {
+public:
+  FlightRecordMap() = default;
+  ~FlightRecordMap() = default;
+
+  bool Open(const std::string& filename);
+  void Close();
+
+  bool is_open() const { return file_.is_open(); }
+
+  size_t size() const { return size_; }
+  const FlightRecord* records() const { return records_; }
+
+  const FlightRecord& operator[](size_t index) const {
+    assert(index < size_);
+    return records_[index];
+  }
+
+private:
+  MappedFile file_;
+  const FlightRecord* records_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_FLIGHTRECORDER_H
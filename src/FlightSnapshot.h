@@ -0,0 +1,47 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Flight loop data snapshot.
+
+#ifndef LANDEX_FLIGHTSNAPSHOT_H
+#define LANDEX_FLIGHTSNAPSHOT_H
+
+namespace xplmpp {
+
+// Holds the sim data read once per flight loop tick, so that everything
+// evaluated during the tick sees the same instant.
+struct FlightSnapshot {
+  float time = 0;            // Elapsed sim time, seconds
+  bool replay_mode = false;  // Are we in replay mode?
+  float faxil_gear = 0;      // Gear/ground forces - backward - ACF Z, newtons
+  float ground_speed = 0;    // Ground speed, meters/sec
+  float vertical_speed = 0;  // Vertical speed, meters/sec
+  float gforce = 0;          // G force, meters/sec^2
+  float agl = 0;             // Altitude above ground level, meters
+  float msl = 0;             // Indicated altitude above mean sea level, feet
+  double lat = 0;            // The latitude of the aircraft
+  double lon = 0;            // The longitude of the aircraft
+  float heading = 0;         // The heading of the aircraft
+
+  bool IsFlying() const {
+    return (!replay_mode && faxil_gear == 0.0) || agl > 0.25;
+  }
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_FLIGHTSNAPSHOT_H
@@ -0,0 +1,109 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Flight state tracker implementation.
+
+#include "FlightTracker.h"
+
+namespace xplmpp {
+
+static const float kFlyingCallbackPeriod = 1.0f;
+
+FlightTracker::FlightTracker(FlightLoopClient* client, FlightData* flight_data)
+: client_(client)
+, flight_data_(flight_data) {
+  assert(client_);
+  assert(flight_data_);
+}
+
+void FlightTracker::Update(const FlightSnapshot& snapshot,
+                           float elapsed_since_last_call) {
+  bool flying = snapshot.IsFlying();
+
+  // Report the landing once the frames after the touchdown are in, or right
+  // away if the airplane is flying again already.
+  capture_.Add(snapshot);
+  if (capture_.triggered() && (flying || capture_.IsComplete()))
+    ReportLanding();
+
+  // Update state and provide periodic flying callback
+  if (!UpdateState(snapshot, flying) && state_ == State::flying) {
+    time_since_last_flying_report_ += elapsed_since_last_call;
+    if (time_since_last_flying_report_ >= kFlyingCallbackPeriod) {
+      FlyingInfo info(snapshot.ground_speed, snapshot.vertical_speed,
+                      snapshot.agl, snapshot.msl);
+      client_->OnAirplaneFlying(info);
+      time_since_last_flying_report_ = 0.0;
+    }
+  }
+
+  // Check if turned crosswind or otherwise deviated from landing heading and
+  // reset collected flight data if so.
+  Data landing_data;
+  if (flying && flight_data_->GetLanding(landing_data)) {
+    float heading_delta = HeadingDelta(snapshot.heading, landing_data.heading);
+    if (heading_delta > kLandingHeadingThreshold)
+      flight_data_->Reset();
+  }
+
+  // Append flight data
+  flight_data_->Add(
+    Data(snapshot.time, snapshot.ground_speed, snapshot.vertical_speed,
+         snapshot.agl, snapshot.msl, snapshot.lat, snapshot.lon,
+         snapshot.heading, flying));
+}
+
+bool FlightTracker::UpdateState(const FlightSnapshot& snapshot, bool flying) {
+  switch (state_) {
+  case State::unknown:
+    state_ = flying ? State::flying : State::landed;
+    break;
+  case State::flying:
+    if (!flying) {
+      state_ = State::landed;
+      landing_snapshot_ = snapshot;
+      capture_.Trigger();
+      return true;
+    }
+    break;
+  case State::landed:
+    if (flying) {
+      state_ = State::flying;
+      FlyingInfo info(snapshot.ground_speed, snapshot.vertical_speed,
+                      snapshot.agl, snapshot.msl);
+      client_->OnAirplaneFlying(info);
+      time_since_last_flying_report_ = 0.0;
+      return true;
+    }
+    break;
+  }
+
+  return false;
+}
+
+void FlightTracker::ReportLanding() {
+  LandingInfo info(landing_snapshot_.ground_speed,
+                   landing_snapshot_.vertical_speed,
+                   landing_snapshot_.gforce);
+  info.lat = landing_snapshot_.lat;
+  info.lon = landing_snapshot_.lon;
+  info.heading = landing_snapshot_.heading;
+  capture_.Analyze(info);
+  client_->OnAirplaneLanded(info);
+}
+
+}  // namespace xplmpp
@@ -0,0 +1,73 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Flight state tracker.
+
+#ifndef LANDEX_FLIGHTTRACKER_H
+#define LANDEX_FLIGHTTRACKER_H
+
+#include "Common.h"
+
+#include "FlightData.h"
+#include "FlightLoopClient.h"
+#include "FlightSnapshot.h"
+#include "TouchdownCapture.h"
+
+namespace xplmpp {
+
+// Tracks the flying/landed state of the airplane from a stream of flight
+// snapshots, notifies the client of state changes and collects the flight
+// data. Knows nothing about where the snapshots come from, so it runs the
+// same in the sim and over a recorded trace.
+class FlightTracker {
+public:
+  enum class State {
+    unknown,
+    landed,
+    flying,
+  };
+
+  FlightTracker(FlightLoopClient* client, FlightData* flight_data);
+  ~FlightTracker() = default;
+
+  // Processes the next snapshot taken |elapsed_since_last_call| seconds
+  // after the previous one.
+  void Update(const FlightSnapshot& snapshot, float elapsed_since_last_call);
+
+  State state() const { return state_; }
+
+  // Returns true while the frames after a touchdown are being captured
+  bool is_capturing_touchdown() const { return capture_.triggered(); }
+
+private:
+  bool UpdateState(const FlightSnapshot& snapshot, bool flying);
+  void ReportLanding();
+
+  FlightLoopClient* client_;
+  FlightData* flight_data_;
+
+  State state_ = State::unknown;
+
+  float time_since_last_flying_report_ = 0.0;
+
+  TouchdownCapture capture_;
+  FlightSnapshot landing_snapshot_;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_FLIGHTTRACKER_H
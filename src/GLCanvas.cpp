@@ -0,0 +1,73 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// OpenGL drawing surface implementation.
+
+#include "GLCanvas.h"
+
+#include "xplmpp/XPLMScreen.h"
+
+#include "XPLMGraphics.h"
+
+namespace xplmpp {
+
+void GLCanvas::SetLineWidth(float width) {
+  glLineWidth(width);
+}
+
+void GLCanvas::SetColor(const float* rgba) {
+  glColor4fv(rgba);
+}
+
+void GLCanvas::Begin(Primitive primitive) {
+  switch (primitive) {
+    case Primitive::lines:
+      glBegin(GL_LINES);
+      break;
+    case Primitive::lineStrip:
+      glBegin(GL_LINE_STRIP);
+      break;
+    case Primitive::lineLoop:
+      glBegin(GL_LINE_LOOP);
+      break;
+    case Primitive::polygon:
+      glBegin(GL_POLYGON);
+      break;
+  }
+}
+
+void GLCanvas::Vertex(float x, float y) {
+  glVertex2f(x, y);
+}
+
+void GLCanvas::End() {
+  glEnd();
+}
+
+void GLCanvas::GetFontDimensions(int* char_width, int* char_height) {
+  ::XPLMGetFontDimensions(xplmFont_Proportional,
+      char_width, char_height, nullptr);
+}
+
+void GLCanvas::DrawString(const float* rgb, int x, int y,
+                          const char* text) {
+  ::XPLMDrawString(const_cast<float*>(rgb), x, y,
+      const_cast <char*>(text), nullptr,
+      xplmFont_Proportional);
+}
+
+}  // namespace xplmpp
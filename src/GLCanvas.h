@@ -0,0 +1,50 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// OpenGL drawing surface.
+
+#ifndef LANDEX_GLCANVAS_H
+#define LANDEX_GLCANVAS_H
+
+#include "Canvas.h"
+
+namespace xplmpp {
+
+// Draws to the current X-Plane OpenGL context
+class GLCanvas : public Canvas {
+public:
+  GLCanvas() = default;
+  ~GLCanvas() override = default;
+
+  // Canvas interface
+  void SetLineWidth(float width) override;
+  void SetColor(const float* rgba) override;
+
+  void Begin(Primitive primitive) override;
+  void Vertex(float x, float y) override;
+  void End() override;
+
+  void GetFontDimensions(int* char_width, int* char_height) override;
+  void DrawString(const float* rgb, int x, int y,
+                  const char* text) override;
+
+  using Canvas::Vertex;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_GLCANVAS_H
@@ -19,16 +19,13 @@
 
 #include "GlideSlope.h"
 
-#include <sstream>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
-#include "absl/strings/str_split.h"
-
 #include "FlightMath.h"
 #include "Settings.h"
 
-#include "XPLMGraphics.h"
-
 namespace xplmpp {
 
 static const float kFrameClr[] = { 1.0f, 1.0f, 1.0f, 0.5f };
@@ -44,19 +41,12 @@ static const float kSlopeTopOffset = 0.05f;
 static const float kSlopeHeight = 0.25f;
 
 static const float kPtDifferenceThreshold = 0.5f;
+static const float kMinGridSpacing = 4.0f;  // pixels
 
 static const float kTan3 = 0.05240778f;
 
 namespace {
 
-template<typename T>
-T Scale(T v0, T v0min, T v0max, T v1min, T v1max) {
-  if (v0max == v0min)
-    return v1max;
-
-  return v1min + ((v0 - v0min) * (v1max - v1min)) / (v0max - v0min);
-}
-
 float DistanceToHeight(float distance) {
   return distance * kTan3;
 }
@@ -66,13 +56,145 @@ bool PtDifference(const PointF& pt, const PointF& pt2) {
           fabs(pt2.y - pt.y) > kPtDifferenceThreshold);
 }
 
+bool RectEqual(const RectF& rc, const RectF& rc2) {
+  return rc.left == rc2.left && rc.top == rc2.top &&
+         rc.right == rc2.right && rc.bottom == rc2.bottom;
+}
+
+// Clips a convex polygon against one side of a rectangle (Sutherland-Hodgman).
+template<typename Inside, typename Intersect>
+size_t ClipPolygonSide(const PointF* pts, size_t count, PointF* out,
+                       Inside inside, Intersect intersect) {
+  size_t n = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const PointF& prev = pts[(i + count - 1) % count];
+    const PointF& pt = pts[i];
+    if (inside(pt)) {
+      if (!inside(prev))
+        out[n++] = intersect(prev, pt);
+      out[n++] = pt;
+    } else
+    if (inside(prev)) {
+      out[n++] = intersect(prev, pt);
+    }
+  }
+  return n;
+}
+
+PointF IntersectX(const PointF& pt, const PointF& pt2, float x) {
+  return PointF(x, pt.y + (x - pt.x) * (pt2.y - pt.y) / (pt2.x - pt.x));
+}
+
+PointF IntersectY(const PointF& pt, const PointF& pt2, float y) {
+  return PointF(pt.x + (y - pt.y) * (pt2.x - pt.x) / (pt2.y - pt.y), y);
+}
+
+// Clips a convex polygon of up to 4 vertices to |rc|, |out| must have room
+// for 8 vertices. Returns the number of vertices left.
+size_t ClipPolygon(const PointF* pts, size_t count, const RectF& rc, PointF* out) {
+  PointF tmp[8];
+  count = ClipPolygonSide(pts, count, tmp,
+      [&](const PointF& pt) { return pt.x >= rc.left; },
+      [&](const PointF& pt, const PointF& pt2) { return IntersectX(pt, pt2, rc.left); });
+  count = ClipPolygonSide(tmp, count, out,
+      [&](const PointF& pt) { return pt.x <= rc.right; },
+      [&](const PointF& pt, const PointF& pt2) { return IntersectX(pt, pt2, rc.right); });
+  count = ClipPolygonSide(out, count, tmp,
+      [&](const PointF& pt) { return pt.y >= rc.bottom; },
+      [&](const PointF& pt, const PointF& pt2) { return IntersectY(pt, pt2, rc.bottom); });
+  return ClipPolygonSide(tmp, count, out,
+      [&](const PointF& pt) { return pt.y <= rc.top; },
+      [&](const PointF& pt, const PointF& pt2) { return IntersectY(pt, pt2, rc.top); });
+}
+
+// Clips a line segment to |rc| (Liang-Barsky), returns false if nothing is
+// left of it.
+bool ClipSegment(PointF& pt, PointF& pt2, const RectF& rc) {
+  float dx = pt2.x - pt.x;
+  float dy = pt2.y - pt.y;
+  float p[4] = { -dx, dx, -dy, dy };
+  float q[4] = { pt.x - rc.left, rc.right - pt.x, pt.y - rc.bottom, rc.top - pt.y };
+
+  float t0 = 0.0f, t1 = 1.0f;
+  for (int n = 0; n < 4; ++n) {
+    if (p[n] == 0.0f) {
+      if (q[n] < 0.0f)
+        return false;
+      continue;
+    }
+    float t = q[n] / p[n];
+    if (p[n] < 0.0f) {
+      t0 = std::max(t0, t);
+    } else {
+      t1 = std::min(t1, t);
+    }
+  }
+
+  if (t0 > t1)
+    return false;
+
+  PointF start(pt.x + t0 * dx, pt.y + t0 * dy);
+  pt2 = PointF(pt.x + t1 * dx, pt.y + t1 * dy);
+  pt = start;
+  return true;
+}
+
+// Draws the path rendered from the flight path pyramid as line strips.
+class CanvasPathSink : public PathSink {
+public:
+  CanvasPathSink(Canvas& canvas, const float* color)
+  : canvas_(canvas)
+  , color_(color) {}
+
+  ~CanvasPathSink() { OnBreak(); }
+
+  void OnVertex(const PointF& pt) override {
+    if (!drawing_) {
+      canvas_.SetColor(color_);
+      canvas_.Begin(Canvas::Primitive::lineStrip);
+      drawing_ = true;
+    } else
+    if (!PtDifference(pt, pt_)) {
+      return;
+    }
+
+    canvas_.Vertex(pt);
+    pt_ = pt;
+  }
+
+  void OnBreak() override {
+    if (drawing_) {
+      canvas_.End();
+      drawing_ = false;
+    }
+  }
+
+private:
+  Canvas& canvas_;
+  const float* color_;
+  bool drawing_ = false;
+  PointF pt_;
+};
+
 }  // namespace
 
-bool GlideSlope::has_prev_distance_ = false;
-float GlideSlope::prev_distance_ = 0.0;
+void GlideSlope::SetRect(const RectF& rc) {
+  if (!RectEqual(rc, rc_)) {
+    rc_ = rc;
+    layout_valid_ = false;
+  }
+}
+
+void GlideSlope::SetView(const GlideSlopeView& view) {
+  if (view != view_) {
+    view_ = view;
+    layout_valid_ = false;
+  }
+}
+
+void GlideSlope::Layout() {
+  layout_valid_ = true;
 
-GlideSlope::GlideSlope(const RectF& rc)
-: rc_(rc) {
   // Calculate view rectangle: frame rectangle sans view margin.
   rc_view_ = rc_;
   rc_view_.Deflate(rc_.Width() * kViewMargin, rc_.Height() * kViewMargin);
@@ -86,126 +208,228 @@ GlideSlope::GlideSlope(const RectF& rc)
 
   // Calculate slope rectangle with bottom left at landing point and
   // top right at the slope center on the right.
-  rc_slope_.left = rc_view_.left +
-      runway_distance * rc_view_.Width() / (runway_distance + approach_distance);
+  float total_distance = runway_distance + approach_distance;
+  rc_slope_.left = rc_view_.left + (total_distance ?
+      runway_distance * rc_view_.Width() / total_distance : 0.0f);
   rc_slope_.bottom = rc_view_.bottom;
   rc_slope_.right = rc_view_.right;
   rc_slope_.top =
       rc_view_.top - rc_view_.Height() * kSlopeTopOffset - slope_height_ / 2;
 
-  // Calculate slope right center point in world coordinates
-  slope_right_.x = approach_distance;
-  slope_right_.y = DistanceToHeight(approach_distance);
+  // Calculate slope right center point in world coordinates, zooming in
+  // shows a shorter stretch of the approach in the same slope rectangle
+  slope_right_.x = approach_distance / view_.zoom;
+  slope_right_.y = DistanceToHeight(slope_right_.x);
+
+  // Panning moves the landing point along with the slope rectangle, there is
+  // nothing to pan over with no approach distance
+  float pan = slope_right_.x ?
+      view_.pan * (rc_slope_.right - rc_slope_.left) / slope_right_.x : 0.0f;
+  rc_slope_.left -= pan;
+  rc_slope_.right -= pan;
+
+  // World to window transform, the slope rectangle spans the slope
+  transform_.scale_x = slope_right_.x ?
+      (rc_slope_.right - rc_slope_.left) / slope_right_.x : 0.0f;
+  transform_.offset_x = slope_right_.x ? rc_slope_.left : rc_slope_.right;
+  transform_.scale_y = slope_right_.y ?
+      (rc_slope_.top - rc_slope_.bottom) / slope_right_.y : 0.0f;
+  transform_.offset_y = slope_right_.y ? rc_slope_.bottom : rc_slope_.top;
+
+  // Grid spacing, spread out when zoomed out too far to tell the lines apart
+  v_grid_ = g_settings.vertical_grid() * transform_.scale_x;
+  if (v_grid_ > 0) {
+    while (v_grid_ < kMinGridSpacing)
+      v_grid_ *= 2;
+  }
 
-  //LOG(INFO) << "GlideSlope::ctor: slope_right=" << slope_right_;
-}
+  h_grid_ = g_settings.horizontal_grid() * transform_.scale_y;
+  if (h_grid_ > 0) {
+    while (h_grid_ < kMinGridSpacing)
+      h_grid_ *= 2;
+  }
+
+  LayoutSlope();
 
-GlideSlope::~GlideSlope() {
+  //LOG(INFO) << "GlideSlope::Layout: slope_right=" << slope_right_;
 }
 
-void GlideSlope::Draw() {
-  glLineWidth(1.0);
+void GlideSlope::LayoutSlope() {
+  slope_outer_count_ = 0;
+  slope_inner_count_ = 0;
+  has_slope_center_ = false;
 
-  DrawFrame();
-  DrawInfo();
-  DrawGrid();
-  DrawSlope();
-  DrawFlightPath();
-}
+  // Nothing to draw when the landing point is panned past the right side
+  if (rc_slope_.left >= rc_view_.right)
+    return;
 
-void GlideSlope::DrawFrame() {
-  glColor4fv(kFrameClr);
-  glBegin(GL_LINE_LOOP);
-  glVertex2(rc_);
-  glEnd();
+  // The slope areas are clipped to the view, since panning can move the
+  // landing point out of it
+  PointF pts[3];
+  pts[0] = rc_slope_.BottomLeft();
+  pts[1] = GetSlopeRayPoint(slope_height_ / 2);
+  pts[2] = GetSlopeRayPoint(-slope_height_ / 2);
+  slope_outer_count_ = ClipPolygon(pts, 3, rc_view_, slope_outer_);
+
+  pts[1] = GetSlopeRayPoint(slope_height_ / 6);
+  pts[2] = GetSlopeRayPoint(-slope_height_ / 6);
+  slope_inner_count_ = ClipPolygon(pts, 3, rc_view_, slope_inner_);
+
+  slope_center_[0] = rc_slope_.BottomLeft();
+  slope_center_[1] = GetSlopeRayPoint(0);
+  has_slope_center_ = ClipSegment(slope_center_[0], slope_center_[1], rc_view_);
 }
 
-void GlideSlope::DrawInfo() {
-  Data data;
-  if (!g_flight_data.GetLast(data))
-    return;
+void GlideSlope::Draw(Canvas& canvas) {
+  if (!layout_valid_)
+    Layout();
+
+  canvas.SetLineWidth(1.0f);
 
-  std::stringstream s;
-  s << "Vg: " << RoundOff(MetersPerSecondToKnots(data.ground_speed)) << " kts\n"
-    << "Vy: " << RoundOff(MetersPerSecondToFeetPerMinute(data.vertical_speed)) << " fpm\n"
-    << "AGL: " << RoundOff(MetersToFeet(data.agl)) << " ft\n"
-    << "MSL: " << RoundOff(data.msl) << " ft\n";
+  DrawFrame(canvas);
+  DrawInfo(canvas);
+  DrawGrid(canvas);
+  DrawSlope(canvas);
+  DrawFlightPath(canvas);
+}
 
-  std::vector<std::string> vstr = absl::StrSplit(s.str(), "\n");
+void GlideSlope::DrawFrame(Canvas& canvas) {
+  canvas.SetColor(kFrameClr);
+  canvas.Begin(Canvas::Primitive::lineLoop);
+  canvas.Vertex(rc_);
+  canvas.End();
+}
+
+void GlideSlope::DrawInfo(Canvas& canvas) {
+  UpdateInfoCache();
+  const GlideSlopeInfoCache& info_cache = info_cache_;
 
   int char_width, char_height;
-  ::XPLMGetFontDimensions(xplmFont_Proportional,
-      &char_width, &char_height, nullptr);
+  canvas.GetFontDimensions(&char_width, &char_height);
 
   int x = static_cast<int>(rc_view_.left) + char_width / 4;
   int y = static_cast<int>(rc_view_.top) - char_height - char_height / 4;
 
   int line_height = char_height + char_height / 4;
 
-  for (const std::string& line : vstr) {
-    static float clr_white[] = { 1.0, 1.0, 1.0 };
-    ::XPLMDrawString(clr_white, x, y,
-        const_cast <char*>(line.c_str()), nullptr,
-        xplmFont_Proportional);
+  for (size_t n = 0; n < info_cache.line_count; ++n) {
+    static const float clr_white[] = { 1.0, 1.0, 1.0 };
+    canvas.DrawString(clr_white, x, y, info_cache.lines[n].c_str());
     y -= line_height;
   }
 }
 
-void GlideSlope::DrawGrid() {
-  glColor4fv(kSlopeClrGrid);
-  glBegin(GL_LINES);
+void GlideSlope::UpdateInfoCache() {
+  GlideSlopeInfoCache& info_cache = info_cache_;
+  if (info_cache.valid &&
+      info_cache.generation == g_flight_data.generation() &&
+      info_cache.last_landing_generation == g_flight_data.last_landing_generation() &&
+      info_cache.end_sequence == g_flight_data.end_sequence())
+    return;
+
+  info_cache.valid = true;
+  info_cache.generation = g_flight_data.generation();
+  info_cache.last_landing_generation = g_flight_data.last_landing_generation();
+  info_cache.end_sequence = g_flight_data.end_sequence();
+  info_cache.line_count = 0;
+
+  Data data;
+  if (!g_flight_data.GetLast(data))
+    return;
 
-  // Draw vertical grid lines
-  float v_grid = WorldToWindowX(g_settings.vertical_grid()) - WorldToWindowX(0);
-  for (float x = rc_slope_.left; x <= rc_view_.right; x += v_grid) {
-    glVertex2f(x, rc_view_.bottom);
-    glVertex2f(x, rc_view_.top);
+  TextLine* lines = info_cache.lines;
+  lines[0].clear();
+  lines[0] << "Vg: " << Knots(data.ground_speed);
+  lines[1].clear();
+  lines[1] << "Vy: " << FeetPerMinute(data.vertical_speed);
+  lines[2].clear();
+  lines[2] << "AGL: " << Feet(data.agl);
+  lines[3].clear();
+  lines[3] << "MSL: " << Quantity(data.msl, "ft");
+  info_cache.line_count = 4;
+
+  if (g_flight_data.IsLastLandingHeading()) {
+    float cross_track = g_flight_data.GetLastLandingCrossTrack(data.lat, data.lon);
+    lines[4].clear();
+    lines[4] << "XTK: " << Feet(cross_track);
+    info_cache.line_count = 5;
   }
+}
 
-  for (float x = rc_slope_.left - v_grid; x >= rc_view_.left; x -= v_grid) {
-    glVertex2f(x, rc_view_.bottom);
-    glVertex2f(x, rc_view_.top);
+void GlideSlope::DrawGrid(Canvas& canvas) {
+  canvas.SetColor(kSlopeClrGrid);
+  canvas.Begin(Canvas::Primitive::lines);
+
+  // Draw vertical grid lines through the landing point
+  if (v_grid_ > 0) {
+    float x = rc_slope_.left + ceil((rc_view_.left - rc_slope_.left) / v_grid_) * v_grid_;
+    for (; x <= rc_view_.right; x += v_grid_) {
+      canvas.Vertex(x, rc_view_.bottom);
+      canvas.Vertex(x, rc_view_.top);
+    }
   }
 
   // Draw horizontal grid lines
-  float h_grid = WorldToWindowY(g_settings.horizontal_grid()) - WorldToWindowY(0);
-  for (float y = rc_slope_.bottom; y <= rc_view_.top; y += h_grid) {
-    glVertex2f(rc_view_.left, y);
-    glVertex2f(rc_view_.right, y);
+  if (h_grid_ > 0) {
+    for (float y = rc_slope_.bottom; y <= rc_view_.top; y += h_grid_) {
+      canvas.Vertex(rc_view_.left, y);
+      canvas.Vertex(rc_view_.right, y);
+    }
   }
 
-  glEnd();
+  canvas.End();
 }
 
-void GlideSlope::DrawSlope() {
+void GlideSlope::DrawSlope(Canvas& canvas) {
   // Draw outer slope area
-  glColor4fv(kSlopeClrOuter);
-  glBegin(GL_POLYGON);
-  glVertex2(rc_slope_.BottomLeft());
-  glVertex2f(rc_slope_.right, rc_slope_.top + slope_height_ / 2);
-  glVertex2f(rc_slope_.right, rc_slope_.top - slope_height_ / 2);
-  glEnd();
+  if (slope_outer_count_) {
+    canvas.SetColor(kSlopeClrOuter);
+    canvas.Begin(Canvas::Primitive::polygon);
+    for (size_t n = 0; n < slope_outer_count_; ++n)
+      canvas.Vertex(slope_outer_[n]);
+    canvas.End();
+  }
 
   // Draw inner slope area
-  glColor4fv(kSlopeClrInner);
-  glBegin(GL_POLYGON);
-  glVertex2(rc_slope_.BottomLeft());
-  glVertex2f(rc_slope_.right, rc_slope_.top + slope_height_ / 6);
-  glVertex2f(rc_slope_.right, rc_slope_.top - slope_height_ / 6);
-  glEnd();
+  if (slope_inner_count_) {
+    canvas.SetColor(kSlopeClrInner);
+    canvas.Begin(Canvas::Primitive::polygon);
+    for (size_t n = 0; n < slope_inner_count_; ++n)
+      canvas.Vertex(slope_inner_[n]);
+    canvas.End();
+  }
 
   // Draw slope center line
-  glColor4fv(kSlopeClrCenter);
-  glBegin(GL_LINE_STRIP);
-  glVertex2(rc_slope_.BottomLeft());
-  glVertex2(rc_slope_.TopRight());
-  glEnd();
+  if (has_slope_center_) {
+    canvas.SetColor(kSlopeClrCenter);
+    canvas.Begin(Canvas::Primitive::lineStrip);
+    canvas.Vertex(slope_center_[0]);
+    canvas.Vertex(slope_center_[1]);
+    canvas.End();
+  }
+}
+
+PointF GlideSlope::GetSlopeRayPoint(float offset) const {
+  // Follow the ray from the landing point through the slope rectangle right
+  // side at |offset| from its top up to the right side of the view
+  float x = rc_view_.right;
+  float y = rc_slope_.bottom + (x - rc_slope_.left) *
+      (rc_slope_.top + offset - rc_slope_.bottom) / (rc_slope_.right - rc_slope_.left);
+  return PointF(x, y);
 }
 
-void GlideSlope::DrawFlightPath() {
-  FlightData::const_iterator it_landing;
-  if (!g_flight_data.GetLanding(it_landing)) {
-    DrawApproachPath();
+void GlideSlope::DrawFlightPath(Canvas& canvas) {
+  // Zoomed and panned views go through the path summaries, the cached path
+  // is only good for the default one
+  if (!view_.is_default()) {
+    DrawFlightPathLod(canvas);
+    return;
+  }
+
+  UpdatePathCache();
+
+  if (!path_cache_.has_landing) {
+    DrawApproachPath(canvas);
     return;
   }
 
@@ -214,62 +438,32 @@ void GlideSlope::DrawFlightPath() {
 
   //LOG(INFO) << "GlideSlope::DrawFlightPath: flight_data.size=" << g_flight_data.size();
 
-  // The landing point corresponds to the bottom left point of the standard
-  // slope rectangle, so walk the flight data back in time to draw the flight
-  // path before landing.
-  { glColor4fv(kSlopeClrPath);
-    glBegin(GL_LINE_STRIP);
-
-    PointF pt(rc_slope_.BottomLeft());
-    glVertex2(pt);
+  // The landing point is at the bottom left point of the standard slope
+  // rectangle, or past it when the landing was made on a known runway, and
+  // the flight path before landing walks back in time from there.
+  { canvas.SetColor(kSlopeClrPath);
+    canvas.Begin(Canvas::Primitive::lineStrip);
 
-    for (FlightData::const_iterator it = --it_landing;
-        it != g_flight_data.cbegin(); --it) {
-      if (!g_flight_data.IsLastLandingHeading(it->heading))
-        break;
-
-      PointF new_pt = WorldToWindow(*it);
-      if (!rc_.PtInRect(new_pt))
-        break;
-
-      if (PtDifference(new_pt, pt)) {
-        pt = new_pt;
-        glVertex2(pt);
-      }
-    }
+    canvas.Vertex(path_cache_.landing_pt);
+    for (const FlightPathCache::Vertex& vertex : path_cache_.before_landing)
+      canvas.Vertex(vertex.pt);
 
-    glEnd();
+    canvas.End();
   }
 
-  // Now walk the flight data forward from the landing moment to draw
-  // the flight path after landing.
-  { glColor4fv(kSlopeClrPath2);
-    glBegin(GL_LINE_STRIP);
+  // The flight path after landing walks forward from the landing moment.
+  { canvas.SetColor(kSlopeClrPath2);
+    canvas.Begin(Canvas::Primitive::lineStrip);
 
-    PointF pt(rc_slope_.BottomLeft());
-    glVertex2(pt);
+    canvas.Vertex(path_cache_.landing_pt);
+    for (const FlightPathCache::Vertex& vertex : path_cache_.after_landing)
+      canvas.Vertex(vertex.pt);
 
-    for (FlightData::const_iterator it = it_landing;
-        it != g_flight_data.cend(); ++it) {
-      if (!g_flight_data.IsLastLandingHeading(it->heading))
-        break;
-
-      PointF new_pt = WorldToWindow(*it);
-      new_pt.x = rc_slope_.left - (new_pt.x - rc_slope_.left);
-      if (!rc_.PtInRect(new_pt))
-        break;
-
-      if (PtDifference(new_pt, pt)) {
-        pt = new_pt;
-        glVertex2(pt);
-      }
-    }
-
-    glEnd();
+    canvas.End();
   }
 }
 
-void GlideSlope::DrawApproachPath() {
+void GlideSlope::DrawApproachPath(Canvas& canvas) {
   if (!g_flight_data.has_last_landing())
     return;
 
@@ -280,54 +474,213 @@ void GlideSlope::DrawApproachPath() {
   if (!g_flight_data.GetLast(data))
     return;
 
+  if (!IsApproachingLastLanding(data))
+    return;
+
+  // Draw the path back in time from the latest sample.
+  { canvas.SetColor(kSlopeClrPath);
+    canvas.Begin(Canvas::Primitive::lineStrip);
+
+    canvas.Vertex(WorldToWindow(data));
+
+    const std::deque<FlightPathCache::Vertex>& approach = path_cache_.approach;
+    for (auto it = approach.crbegin(); it != approach.crend(); ++it)
+      canvas.Vertex(it->pt);
+
+    canvas.End();
+  }
+}
+
+bool GlideSlope::IsApproachingLastLanding(const Data& data) {
   float distance = g_flight_data.GetLastLandingDistance(data.lat, data.lon);
   if (!has_prev_distance_ || distance == prev_distance_) {
     has_prev_distance_ = true;
     prev_distance_ = distance;
-    return;
+    return false;
   }
 
   if (distance > prev_distance_) {
     has_prev_distance_ = false;
-    return;
+    return false;
   }
 
-  { glColor4fv(kSlopeClrPath);
-    glBegin(GL_LINE_STRIP);
+  return true;
+}
+
+void GlideSlope::DrawFlightPathLod(Canvas& canvas) {
+  FlightPathPyramid& pyramid = path_cache_.pyramid;
+  pyramid.Update(g_flight_data);
+  if (!pyramid.valid())
+    return;
 
-    { FlightData::const_reverse_iterator it = g_flight_data.crbegin();
-      PointF pt = WorldToWindow(*it);
-      glVertex2(pt);
+  size_t landing_index = 0;
+  if (g_flight_data.GetLanding(landing_index)) {
+    has_prev_distance_ = false;
+    prev_distance_ = 0.0;
 
-      for (++it; it != g_flight_data.crend(); ++it) {
-        if (!g_flight_data.IsLastLandingHeading(it->heading))
-          break;
+    // The flight path before landing, and after it in another color
+    size_t begin = 0, end = 0;
+    pyramid.GetLandingRun(g_flight_data, landing_index, begin, end);
+    { CanvasPathSink sink(canvas, kSlopeClrPath);
+      pyramid.Render(g_flight_data, begin, landing_index + 1, transform_, rc_view_, sink);
+    }
 
-        PointF new_pt = WorldToWindow(*it);
-        if (!rc_.PtInRect(new_pt))
-          break;
+    { CanvasPathSink sink(canvas, kSlopeClrPath2);
+      pyramid.Render(g_flight_data, landing_index, end, transform_, rc_view_, sink);
+    }
+    return;
+  }
 
-        if (PtDifference(new_pt, pt)) {
-          pt = new_pt;
-          glVertex2(pt);
-        }
-      }
+  // The latest run of samples approaching the last landing point
+  if (!g_flight_data.IsLastLandingHeading())
+    return;
+
+  Data data;
+  if (!g_flight_data.GetLast(data) || !IsApproachingLastLanding(data))
+    return;
+
+  CanvasPathSink sink(canvas, kSlopeClrPath);
+  pyramid.Render(g_flight_data, pyramid.GetLatestRunBegin(g_flight_data),
+                 g_flight_data.size(), transform_, rc_view_, sink);
+}
+
+void GlideSlope::UpdatePathCache() {
+  FlightPathCache& cache = path_cache_;
+
+  size_t landing_index = 0;
+  bool has_landing = g_flight_data.GetLanding(landing_index);
+  size_t landing_sequence = has_landing ? g_flight_data.sequence(landing_index) : 0;
+
+  // Start over if anything the projection depends on has changed
+  if (!cache.valid ||
+      !RectEqual(cache.rc, rc_) ||
+      !RectEqual(cache.rc_slope, rc_slope_) ||
+      cache.slope_right.x != slope_right_.x ||
+      cache.slope_right.y != slope_right_.y ||
+      cache.generation != g_flight_data.generation() ||
+      cache.last_landing_generation != g_flight_data.last_landing_generation() ||
+      cache.has_landing != has_landing ||
+      cache.landing_sequence != landing_sequence) {
+    cache.valid = true;
+    cache.rc = rc_;
+    cache.rc_slope = rc_slope_;
+    cache.slope_right = slope_right_;
+    cache.generation = g_flight_data.generation();
+    cache.last_landing_generation = g_flight_data.last_landing_generation();
+    cache.has_landing = has_landing;
+    cache.landing_sequence = landing_sequence;
+    cache.next_sequence = has_landing ? landing_sequence : g_flight_data.first_sequence();
+    cache.before_landing.clear();
+    cache.after_landing.clear();
+    cache.after_landing_done = false;
+    cache.approach.clear();
+
+    if (has_landing) {
+      cache.landing_pt = WorldToWindow(landing_index);
+      BuildBeforeLandingPath(landing_index);
     }
+  }
 
-    glEnd();
+  // Forget the vertices of the samples dropped from the flight data
+  size_t first_sequence = g_flight_data.first_sequence();
+  while (!cache.before_landing.empty() &&
+         cache.before_landing.back().sequence < first_sequence)
+    cache.before_landing.pop_back();
+  while (!cache.approach.empty() &&
+         cache.approach.front().sequence < first_sequence)
+    cache.approach.pop_front();
+
+  if (cache.next_sequence < first_sequence)
+    cache.next_sequence = first_sequence;
+
+  if (has_landing) {
+    UpdateAfterLandingPath();
+  } else {
+    UpdateApproachPath();
   }
 }
 
-float GlideSlope::WorldToWindowX(float x) const {
-  return Scale(x, 0.0f, slope_right_.x, rc_slope_.left, rc_slope_.right);
+void GlideSlope::BuildBeforeLandingPath(size_t landing_index) {
+  std::vector<FlightPathCache::Vertex>& path = path_cache_.before_landing;
+
+  // Samples before landing do not change, so the path is built once.
+  PointF pt(path_cache_.landing_pt);
+  size_t begin = g_flight_data.FindLastLandingHeadingBegin(landing_index);
+  for (size_t index = landing_index; index-- > begin;) {
+    PointF new_pt = WorldToWindow(index);
+    if (!rc_.PtInRect(new_pt))
+      break;
+
+    if (PtDifference(new_pt, pt)) {
+      pt = new_pt;
+      path.emplace_back(pt, g_flight_data.sequence(index));
+    }
+  }
 }
 
-float GlideSlope::WorldToWindowY(float y) const {
-  return Scale(y, 0.0f, slope_right_.y, rc_slope_.bottom, rc_slope_.top);
+void GlideSlope::UpdateAfterLandingPath() {
+  FlightPathCache& cache = path_cache_;
+  if (cache.after_landing_done)
+    return;
+
+  // Extend the path with the new samples until it leaves the view or
+  // the landing heading.
+  PointF pt = cache.after_landing.empty() ?
+      cache.landing_pt : cache.after_landing.back().pt;
+
+  size_t index = cache.next_sequence - g_flight_data.first_sequence();
+  size_t end = g_flight_data.FindLastLandingHeadingEnd(index);
+  for (; index < end; ++index) {
+    PointF new_pt = WorldToWindow(index);
+    if (!rc_.PtInRect(new_pt))
+      break;
+
+    if (PtDifference(new_pt, pt)) {
+      pt = new_pt;
+      cache.after_landing.emplace_back(pt, g_flight_data.sequence(index));
+    }
+  }
+
+  if (index < g_flight_data.size())
+    cache.after_landing_done = true;
+
+  cache.next_sequence = g_flight_data.sequence(index);
+}
+
+void GlideSlope::UpdateApproachPath() {
+  FlightPathCache& cache = path_cache_;
+  if (!g_flight_data.has_last_landing()) {
+    cache.next_sequence = g_flight_data.end_sequence();
+    return;
+  }
+
+  // Keep the latest run of samples that are all on the landing heading and
+  // within the view, restarting it whenever a sample is not.
+  size_t index = cache.next_sequence - g_flight_data.first_sequence();
+  while (index < g_flight_data.size()) {
+    size_t end = g_flight_data.FindLastLandingHeadingEnd(index);
+    for (; index < end; ++index) {
+      PointF new_pt = WorldToWindow(index);
+      if (!rc_.PtInRect(new_pt)) {
+        cache.approach.clear();
+        continue;
+      }
+
+      if (cache.approach.empty() || PtDifference(new_pt, cache.approach.back().pt))
+        cache.approach.emplace_back(new_pt, g_flight_data.sequence(index));
+    }
+
+    if (index < g_flight_data.size()) {
+      cache.approach.clear();
+      ++index;
+    }
+  }
+
+  cache.next_sequence = g_flight_data.end_sequence();
 }
 
 PointF GlideSlope::WorldToWindow(const PointF& pt) const {
-  return PointF(WorldToWindowX(pt.x), WorldToWindowY(pt.y));
+  return transform_(pt.x, pt.y);
 }
 
 PointF GlideSlope::WorldToWindow(double lat, double lon, float agl) const {
@@ -338,4 +691,9 @@ PointF GlideSlope::WorldToWindow(const Data& data) const {
   return WorldToWindow(data.lat, data.lon, data.agl);
 }
 
+PointF GlideSlope::WorldToWindow(size_t index) const {
+  return WorldToWindow(g_flight_data.lat(index), g_flight_data.lon(index),
+                       g_flight_data.agl(index));
+}
+
 }  // namespace xplmpp
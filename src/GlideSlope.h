@@ -20,46 +20,120 @@
 #ifndef LANDEX_GLIDESLOPE_H
 #define LANDEX_GLIDESLOPE_H
 
+#include "Canvas.h"
 #include "Common.h"
 #include "FlightData.h"
+#include "FlightPathCache.h"
+#include "TextFormat.h"
 
-#include "xplmpp/XPLMScreen.h"
 #include "xplmpp/Rect.h"
 
 namespace xplmpp {
 
-// Represents the glide slope
+// Holds the info text between frames, so that it is only formatted again
+// when there is a new sample or the last landing changes.
+struct GlideSlopeInfoCache {
+  static const size_t kMaxLines = 5;
+
+  bool valid = false;
+
+  // The state the text was formatted for
+  unsigned generation = 0;
+  unsigned last_landing_generation = 0;
+  size_t end_sequence = 0;
+
+  TextLine lines[kMaxLines];
+  size_t line_count = 0;
+};
+
+// Zoom and pan of the glide slope view. The zoom scales both axes around the
+// landing point, so the slope keeps its shape on the screen.
+struct GlideSlopeView {
+  float zoom = 1.0f;
+  float pan = 0.0f;  // meters along the approach, positive looks further out
+
+  bool is_default() const { return zoom == 1.0f && pan == 0.0f; }
+
+  bool operator==(const GlideSlopeView& other) const {
+    return zoom == other.zoom && pan == other.pan;
+  }
+  bool operator!=(const GlideSlopeView& other) const { return !(*this == other); }
+};
+
+// Represents the glide slope view. It is kept between frames along with its
+// layout, which is only worked out again when the rectangle, the zoom and
+// pan, or the settings change.
 class GlideSlope {
 public:
-  GlideSlope(const RectF& rc);
-  ~GlideSlope();
+  GlideSlope() = default;
+  ~GlideSlope() = default;
+
+  void SetRect(const RectF& rc);
 
-  void Draw();
+  const GlideSlopeView& view() const { return view_; }
+  void SetView(const GlideSlopeView& view);
+
+  // Lays the view out again on the next frame, e.g. for new settings.
+  void Invalidate() { layout_valid_ = false; }
+
+  void Draw(Canvas& canvas);
 
 private:
-  void DrawFrame();
-  void DrawInfo();
-  void DrawGrid();
-  void DrawSlope();
-  void DrawFlightPath();
-  void DrawApproachPath();
+  void Layout();
+  void LayoutSlope();
+
+  void DrawFrame(Canvas& canvas);
+  void DrawInfo(Canvas& canvas);
+  void UpdateInfoCache();
+  void DrawGrid(Canvas& canvas);
+  void DrawSlope(Canvas& canvas);
+  void DrawFlightPath(Canvas& canvas);
+  void DrawApproachPath(Canvas& canvas);
+  void DrawFlightPathLod(Canvas& canvas);
 
-  float WorldToWindowX(float x) const;
-  float WorldToWindowY(float y) const;
+  bool IsApproachingLastLanding(const Data& data);
+  PointF GetSlopeRayPoint(float offset) const;
+
+  void UpdatePathCache();
+  void BuildBeforeLandingPath(size_t landing_index);
+  void UpdateAfterLandingPath();
+  void UpdateApproachPath();
 
   PointF WorldToWindow(const PointF& pt) const;
   PointF WorldToWindow(double lat, double lon, float agl) const;
   PointF WorldToWindow(const Data& data) const;
+  PointF WorldToWindow(size_t index) const;
 
   RectF rc_;       // Caller's rectangle (frame)
+  GlideSlopeView view_;
+
+  // Layout of rc_ and view_
+  bool layout_valid_ = false;
   RectF rc_view_;  // View rectangle (caller's rectangle sans view margins)
   RectF rc_slope_; // Slope rectangle (BL=landing point, TR = slope top center)
 
-  float slope_height_; // Slope triangle height on the right (window)
-  PointF slope_right_; // Slope center right in world coordinates
+  float slope_height_ = 0; // Slope triangle height on the right (window)
+  PointF slope_right_;     // Slope center right in world coordinates
+
+  PathTransform transform_;  // World to window, see WorldToWindow()
+
+  float v_grid_ = 0;  // Grid spacing in window coordinates, 0 for none
+  float h_grid_ = 0;
+
+  // Slope areas and center line clipped to the view
+  PointF slope_outer_[8];
+  size_t slope_outer_count_ = 0;
+  PointF slope_inner_[8];
+  size_t slope_inner_count_ = 0;
+  PointF slope_center_[2];
+  bool has_slope_center_ = false;
+
+  FlightPathCache path_cache_;
+  GlideSlopeInfoCache info_cache_;
 
-  static bool has_prev_distance_;
-  static float prev_distance_;
+  // Approach distance trend
+  bool has_prev_distance_ = false;
+  float prev_distance_ = 0.0f;
 };
 
 }  // namespace xplmpp
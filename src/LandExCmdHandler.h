@@ -26,6 +26,16 @@ namespace xplmpp {
 enum class Cmd {
   showWindow = 1,
   clearWindow,
+  exportSession,
+  toggleRecording,
+  scrollLogUp,
+  scrollLogDown,
+  scrollLogEnd,
+  zoomIn,
+  zoomOut,
+  panLeft,
+  panRight,
+  resetView,
 };
 
 // Plugin command handler interface.
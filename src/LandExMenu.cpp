@@ -30,7 +30,17 @@ namespace xplmpp {
 LandExMenu::LandExMenu(CmdHandler* cmd_handler)
 : cmd_handler_(cmd_handler)
 , cmd_show_window_(this)
-, cmd_clear_window_(this) {
+, cmd_clear_window_(this)
+, cmd_export_session_(this)
+, cmd_toggle_recording_(this)
+, cmd_scroll_log_up_(this)
+, cmd_scroll_log_down_(this)
+, cmd_scroll_log_end_(this)
+, cmd_zoom_in_(this)
+, cmd_zoom_out_(this)
+, cmd_pan_left_(this)
+, cmd_pan_right_(this)
+, cmd_reset_view_(this) {
 }
 
 LandExMenu::~LandExMenu() {
@@ -46,6 +56,30 @@ bool LandExMenu::Create() {
   AppendMenuItemWithCommand("Clear Window",
       cmd_clear_window_.Create("LandEx/clear_window", "Clear Window"));
 
+  AppendMenuItemWithCommand("Export Session",
+      cmd_export_session_.Create("LandEx/export_session", "Export Session"));
+
+  AppendMenuItemWithCommand("Start/Stop Recording",
+      cmd_toggle_recording_.Create("LandEx/toggle_recording", "Start/Stop Recording"));
+
+  // Log scrolling is left for key bindings
+  cmd_scroll_log_up_.Create("LandEx/scroll_log_up", "Scroll Log Up");
+  cmd_scroll_log_down_.Create("LandEx/scroll_log_down", "Scroll Log Down");
+  cmd_scroll_log_end_.Create("LandEx/scroll_log_end", "Scroll Log To The Latest");
+
+  AppendMenuItemWithCommand("Zoom In",
+      cmd_zoom_in_.Create("LandEx/zoom_in", "Zoom Glide Slope In"));
+
+  AppendMenuItemWithCommand("Zoom Out",
+      cmd_zoom_out_.Create("LandEx/zoom_out", "Zoom Glide Slope Out"));
+
+  AppendMenuItemWithCommand("Reset View",
+      cmd_reset_view_.Create("LandEx/reset_view", "Reset Glide Slope View"));
+
+  // Panning is left for key bindings
+  cmd_pan_left_.Create("LandEx/pan_left", "Pan Glide Slope Toward Runway");
+  cmd_pan_right_.Create("LandEx/pan_right", "Pan Glide Slope Toward Approach");
+
   return true;
 }
 
@@ -64,6 +98,36 @@ bool LandExMenu::OnCommand(XPLMCommandRef cmd_ref, XPLMCommandPhase phase) {
   } else
   if (cmd_ref == cmd_clear_window_.ref()) {
     cmd_handler_->OnCommand(Cmd::clearWindow);
+  } else
+  if (cmd_ref == cmd_export_session_.ref()) {
+    cmd_handler_->OnCommand(Cmd::exportSession);
+  } else
+  if (cmd_ref == cmd_toggle_recording_.ref()) {
+    cmd_handler_->OnCommand(Cmd::toggleRecording);
+  } else
+  if (cmd_ref == cmd_scroll_log_up_.ref()) {
+    cmd_handler_->OnCommand(Cmd::scrollLogUp);
+  } else
+  if (cmd_ref == cmd_scroll_log_down_.ref()) {
+    cmd_handler_->OnCommand(Cmd::scrollLogDown);
+  } else
+  if (cmd_ref == cmd_scroll_log_end_.ref()) {
+    cmd_handler_->OnCommand(Cmd::scrollLogEnd);
+  } else
+  if (cmd_ref == cmd_zoom_in_.ref()) {
+    cmd_handler_->OnCommand(Cmd::zoomIn);
+  } else
+  if (cmd_ref == cmd_zoom_out_.ref()) {
+    cmd_handler_->OnCommand(Cmd::zoomOut);
+  } else
+  if (cmd_ref == cmd_pan_left_.ref()) {
+    cmd_handler_->OnCommand(Cmd::panLeft);
+  } else
+  if (cmd_ref == cmd_pan_right_.ref()) {
+    cmd_handler_->OnCommand(Cmd::panRight);
+  } else
+  if (cmd_ref == cmd_reset_view_.ref()) {
+    cmd_handler_->OnCommand(Cmd::resetView);
   }
 
   return false;
@@ -45,6 +45,16 @@ private:
 
   XPLMCommand cmd_show_window_;
   XPLMCommand cmd_clear_window_;
+  XPLMCommand cmd_export_session_;
+  XPLMCommand cmd_toggle_recording_;
+  XPLMCommand cmd_scroll_log_up_;
+  XPLMCommand cmd_scroll_log_down_;
+  XPLMCommand cmd_scroll_log_end_;
+  XPLMCommand cmd_zoom_in_;
+  XPLMCommand cmd_zoom_out_;
+  XPLMCommand cmd_pan_left_;
+  XPLMCommand cmd_pan_right_;
+  XPLMCommand cmd_reset_view_;
 
   CmdHandler* cmd_handler_;
 };
@@ -19,12 +19,16 @@
 
 #include "LandExPlugin.h"
 
-#include <sstream>
+#include <ctime>
+#include <filesystem>
 
 #include "FlightData.h"
-#include "FlightMath.h"
 #include "Settings.h"
 
+#include "XPLMUtilities.h"
+
+#include "xplmpp/XPLMPath.h"
+
 namespace xplmpp {
 
 #define ACTIVATE_PLUGIN_ERROR_CALLBACK 0
@@ -34,24 +38,6 @@ namespace xplmpp {
 #pragma comment(lib, "absl_strings")
 #pragma comment(lib, "absl_internal_throw_delegate")
 
-static const float kReallyFlyingAgl = 10.0f;
-
-namespace {
-
-std::string LandingQuality(float vy) {
-  if (vy < 0.25f) return "EXCELLENT LANDING"; // ~50 fpm
-  if (vy < 0.50f) return "GREAT LANDING";
-  if (vy < 1.00f) return "GOOD LANDING";
-  if (vy < 1.50f) return "ACCEPTABLE LANDING";
-  if (vy < 2.00f) return "HARD LANDING";
-  if (vy < 2.50f) return "BAD LANDING";
-  if (vy < 3.00f) return "ANY SURVIVORS?";
-
-  return "R.I.P.";
-}
-
-}  // namespace
-
 /*
  * LandEx plugin implementation.
  */
@@ -79,6 +65,7 @@ bool LandExPlugin::OnStart(char* name, char* signature, char* description) {
   strcpy_s(description, kMaxOnStartStringLength, description_.c_str());
 
   vr_enabled_.Find("sim/graphics/VR/enabled");
+  aircraft_icao_ = ::XPLMFindDataRef("sim/aircraft/view/acf_ICAO");
 
   return true;
 }
@@ -127,41 +114,83 @@ void LandExPlugin::OnCommand(Cmd cmd) {
       window_.Clear();
       g_flight_data.Reset();
       break;
+    case Cmd::exportSession:
+      ExportSession();
+      break;
+    case Cmd::toggleRecording:
+      ToggleRecording();
+      break;
+    case Cmd::scrollLogUp:
+      window_.ScrollLog(1);
+      break;
+    case Cmd::scrollLogDown:
+      window_.ScrollLog(-1);
+      break;
+    case Cmd::scrollLogEnd:
+      window_.ScrollLogToEnd();
+      break;
+    case Cmd::zoomIn:
+      window_.ZoomView(1);
+      break;
+    case Cmd::zoomOut:
+      window_.ZoomView(-1);
+      break;
+    case Cmd::panLeft:
+      window_.PanView(-1);
+      break;
+    case Cmd::panRight:
+      window_.PanView(1);
+      break;
+    case Cmd::resetView:
+      window_.ResetView();
+      break;
   }
 }
 
+void LandExPlugin::OnFlightLoopTick() {
+  UpdateSettings();
+  runways_.Update();
+  UpdateExport();
+  if (stats_writer_.TakeFailures())
+    LOG(WARNING) << "Could not save the landing stats '" << stats_writer_.filename() << "'.";
+  if (server_.is_running())
+    server_.Send(g_flight_data);
+}
+
 void LandExPlugin::OnAirplaneFlying(const FlyingInfo& info) {
-  if (flying_tick_count_++ > 0) {
-    if (!really_flying_ && info.agl >= kReallyFlyingAgl) {
+  switch (classifier_.OnAirplaneFlying(info)) {
+    case LandingClassifier::FlyingEvent::none:
+      return;
+    case LandingClassifier::FlyingEvent::reallyFlying:
       window_.AddLine("...");
-      really_flying_ = true;
-    }
-    return;
+      return;
+    case LandingClassifier::FlyingEvent::takeoff:
+      break;
   }
 
-  std::stringstream s;
-  s << "Flying:   "
-    << "  Vy=" << RoundOff(MetersPerSecondToFeetPerMinute(info.vertical_speed)) << " fpm"
-    << "  Vg=" << RoundOff(MetersPerSecondToKnots(info.ground_speed)) << " kts"
-    << "  AGL=" << RoundOff(MetersToFeet(info.agl)) << " ft"
-    << "  MSL=" << RoundOff(info.msl) << " ft";
-  window_.AddLine(s.str());
+  window_.log().AddFlying(info);
 }
 
 void LandExPlugin::OnAirplaneLanded(const LandingInfo& info) {
-  bool was_really_flying = really_flying_;
-  really_flying_ = false;
-  flying_tick_count_ = 0;
-
-  std::stringstream s;
-  s << "Landed: "
-    << "  Vy=" << RoundOff(MetersPerSecondToFeetPerMinute(info.vertical_speed)) << " fpm"
-    << "  Vg=" << RoundOff(MetersPerSecondToKnots(info.ground_speed)) << " kts"
-    << "  G=" << RoundOff(info.gforce) << " m/sec^2";
+  bool was_really_flying = classifier_.OnAirplaneLanded();
+
+  window_.log().AddLanded(info, was_really_flying);
+  server_.AddLanding(info, was_really_flying);
+
   if (was_really_flying) {
-    s << "    " << LandingQuality(fabs(info.vertical_speed));
+    AddRunway(info);
+    AddToHistory(info);
+    AddToStats(info);
   }
-  window_.AddLine(s.str());
+}
+
+void LandExPlugin::OnLandingAnalyzed(const LandingAnalysis& analysis) {
+  window_.log().AddAnalysis(analysis);
+}
+
+void LandExPlugin::OnTrafficLanded(int id, const std::string& aircraft,
+                                   const LandingInfo& info) {
+  window_.log().AddTraffic(id, aircraft, info);
 }
 
 void LandExPlugin::OnPluginError(const char* error) {
@@ -169,10 +198,15 @@ void LandExPlugin::OnPluginError(const char* error) {
 }
 
 bool LandExPlugin::Init() {
-  g_settings.Load();
+  std::string settings_filename = XPLMPath::GetPrefsFolder() + "LandEx.prf";
+  g_settings.Load(settings_filename);
+  g_settings.LogWarnings();
 
   g_log.set_log_level(static_cast<LogLevel>(g_settings.log_level()));
 
+  g_flight_data.set_history_limits(g_settings.history_distance(),
+                                   g_settings.history_time());
+
   if (!window_.Create(IsVREnabled())) {
     LOG(FATAL) << "Could not create the window.";
     return false;
@@ -183,13 +217,33 @@ bool LandExPlugin::Init() {
     return false;
   }
 
+  if (!history_.Open(XPLMPath::GetPrefsFolder() + "LandEx-landings.lxh",
+                     XPLMPath::GetPrefsFolder() + "LandEx-landings.lxi")) {
+    LOG(WARNING) << "Could not open the landing history, landings will not be saved.";
+  }
+
+  OpenStats();
+
+  OpenRunways();
+
+  StartServer();
+
   flight_loop_ = FlightLoop::Create(this);
 
+  settings_watcher_.Start(settings_filename);
+
   return true;
 }
 
 void LandExPlugin::Quit() {
+  settings_watcher_.Stop();
+  exporter_.Stop();
+  server_.Stop();
   flight_loop_.reset(nullptr);
+  history_.Close();
+  stats_writer_.Stop();
+  stats_.Clear();
+  runways_.Close();
   window_.Destroy();
   menu_.Destroy();
 }
@@ -198,6 +252,209 @@ bool LandExPlugin::IsVREnabled() {
   return !!vr_enabled_.GetDatai();
 }
 
+void LandExPlugin::UpdateSettings() {
+  std::unique_ptr<const Settings> settings = settings_watcher_.TryGetSettings();
+  if (!settings)
+    return;
+
+  settings->LogWarnings();
+
+  // Everything reading the settings runs on this thread between the ticks,
+  // so they can be replaced all at once here
+  unsigned changes = g_settings.Compare(*settings);
+  g_settings = *settings;
+
+  if (changes) {
+    LOG(INFO) << "Settings reloaded.";
+    ApplySettings(changes);
+  }
+}
+
+void LandExPlugin::ApplySettings(unsigned changes) {
+  if (changes & Settings::kLogChanged)
+    g_log.set_log_level(static_cast<LogLevel>(g_settings.log_level()));
+
+  if (changes & Settings::kHistoryChanged)
+    g_flight_data.set_history_limits(g_settings.history_distance(),
+                                     g_settings.history_time());
+
+  if ((changes & Settings::kFlareChanged) && flight_loop_)
+    flight_loop_->set_flare_height(g_settings.flare_height());
+
+  if (changes & Settings::kLayoutChanged)
+    window_.OnLayoutChanged();
+
+  if (changes & Settings::kServerChanged)
+    StartServer();
+}
+
+void LandExPlugin::ToggleRecording() {
+  if (!flight_loop_)
+    return;
+
+  if (flight_loop_->is_recording()) {
+    flight_loop_->StopRecording();
+    window_.AddLine("Recording stopped.");
+    return;
+  }
+
+  char timestamp[32];
+  time_t now = time(nullptr);
+  strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", localtime(&now));
+
+  std::string filename =
+      XPLMPath::GetPrefsFolder() + "LandEx-" + timestamp + ".lxr";
+  if (!flight_loop_->StartRecording(filename)) {
+    window_.AddLine("Could not start recording.");
+    return;
+  }
+
+  window_.AddLine("Recording to " + filename);
+}
+
+void LandExPlugin::OpenRunways() {
+  char system_path[512] = {};
+  ::XPLMGetSystemPath(system_path);
+
+  // The global airports moved to the default scenery in X-Plane 12
+  static const char* apt_dat_filenames[] = {
+    "Global Scenery/Global Airports/Earth nav data/apt.dat",
+    "Custom Scenery/Global Airports/Earth nav data/apt.dat",
+  };
+
+  for (const char* apt_dat_filename : apt_dat_filenames) {
+    std::string filename = std::string(system_path) + apt_dat_filename;
+    std::error_code ec;
+    if (!std::filesystem::exists(filename, ec))
+      continue;
+
+    runways_.Open(filename, XPLMPath::GetPrefsFolder() + "LandEx-runways.lxc");
+    return;
+  }
+
+  LOG(WARNING) << "Could not find apt.dat, runways are not known.";
+}
+
+void LandExPlugin::AddRunway(const LandingInfo& info) {
+  RunwayMatch match;
+  if (!runways_.FindRunway(info.lat, info.lon, info.heading, match))
+    return;
+
+  // Measure the approach and the landing from the runway threshold
+  const RunwayEnd& runway = *match.runway;
+  g_flight_data.SetLastLandingRunway(runway.lat, runway.lon, runway.heading);
+
+  window_.log().AddRunway(runway.airport_code(), runway.runway_number(),
+                          match.distance, match.offset);
+}
+
+void LandExPlugin::ExportSession() {
+  if (exporter_.is_exporting()) {
+    window_.AddLine("Export in progress.");
+    return;
+  }
+
+  if (g_flight_data.empty()) {
+    window_.AddLine("Nothing to export.");
+    return;
+  }
+
+  char timestamp[32];
+  time_t now = time(nullptr);
+  strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", localtime(&now));
+
+  std::string filename =
+      XPLMPath::GetPrefsFolder() + "LandEx-" + timestamp + ".lxe";
+  if (!exporter_.Start(filename, g_flight_data)) {
+    window_.AddLine("Could not start export.");
+    return;
+  }
+
+  window_.AddLine("Exporting to " + filename);
+}
+
+void LandExPlugin::UpdateExport() {
+  if (!exporter_.Update(g_flight_data))
+    return;
+
+  if (!exporter_.ok()) {
+    LOG(ERROR) << "Could not write '" << exporter_.filename() << "'.";
+    window_.AddLine("Could not export.");
+    return;
+  }
+
+  // The flight data may have been cleared before all of it was copied
+  char text[64];
+  snprintf(text, sizeof(text), "Exported %zu of %zu samples.",
+           exporter_.row_count(), exporter_.planned_row_count());
+  window_.AddLine(text);
+}
+
+std::string LandExPlugin::GetAircraftType() {
+  char icao[sizeof(LandingRecord::aircraft) + 1] = {};
+  if (aircraft_icao_)
+    ::XPLMGetDatab(aircraft_icao_, icao, 0, sizeof(icao) - 1);
+  return icao;
+}
+
+void LandExPlugin::AddToHistory(const LandingInfo& info) {
+  if (!history_.is_open())
+    return;
+
+  std::string aircraft = GetAircraftType();
+  if (!history_.Append(LandingRecord(info, aircraft, time(nullptr))))
+    return;
+  history_.Flush();
+
+  LandingRecord best, worst;
+  if (!history_.GetBest(aircraft, best) || !history_.GetWorst(aircraft, worst))
+    return;
+
+  window_.log().AddHistory(aircraft, history_.GetCount(aircraft),
+                           best.vertical_speed, worst.vertical_speed);
+}
+
+void LandExPlugin::OpenStats() {
+  std::string filename = XPLMPath::GetPrefsFolder() + "LandEx-stats.lxs";
+  stats_.Clear();
+  stats_writer_.Start(filename);
+
+  std::error_code ec;
+  if (std::filesystem::exists(filename, ec)) {
+    stats_.Load(filename);
+    return;
+  }
+
+  // Start off with the landings already in the history
+  if (!history_.is_open() || !history_.size())
+    return;
+
+  for (size_t n = 0; n < history_.size(); ++n)
+    stats_.Add(history_.Get(n));
+  stats_writer_.Save(stats_);
+}
+
+void LandExPlugin::AddToStats(const LandingInfo& info) {
+  std::string aircraft = GetAircraftType();
+  stats_.Add(LandingRecord(info, aircraft, time(nullptr)));
+
+  // Saved on the writer thread, the sim thread never waits on the file
+  stats_writer_.Save(stats_);
+
+  LandingSummary summary;
+  if (stats_.GetSummary(aircraft, summary))
+    window_.log().AddStats(aircraft, summary);
+}
+
+void LandExPlugin::StartServer() {
+  server_.Stop();
+  if (g_settings.server_port() <= 0)
+    return;
+
+  if (!server_.Start(g_settings.server_port()))
+    window_.AddLine("Could not start the telemetry server.");
+}
+
 /*
  * LandEx plugin factory implementation.
  */
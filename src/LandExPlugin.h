@@ -32,6 +32,14 @@
 #include "LandExMenu.h"
 #include "LandExCmdHandler.h"
 #include "FlightLoop.h"
+#include "LandingClassifier.h"
+#include "LandingHistory.h"
+#include "LandingStats.h"
+#include "LandingStatsWriter.h"
+#include "RunwayDatabase.h"
+#include "SessionExporter.h"
+#include "SettingsWatcher.h"
+#include "TelemetryServer.h"
 
 namespace xplmpp {
 
@@ -56,8 +64,12 @@ private:
   void OnCommand(Cmd cmd) override;
 
   // FlightLoopClient interface
+  void OnFlightLoopTick() override;
   void OnAirplaneFlying(const FlyingInfo& info) override;
   void OnAirplaneLanded(const LandingInfo& info) override;
+  void OnLandingAnalyzed(const LandingAnalysis& analysis) override;
+  void OnTrafficLanded(int id, const std::string& aircraft,
+                       const LandingInfo& info) override;
 
   // XPLMErrorCallback::Handler
   void OnPluginError(const char* error) override;
@@ -67,6 +79,24 @@ private:
 
   bool IsVREnabled();
 
+  void UpdateSettings();
+  void ApplySettings(unsigned changes);
+
+  void ToggleRecording();
+  void ExportSession();
+  void UpdateExport();
+
+  void OpenRunways();
+  void AddRunway(const LandingInfo& info);
+
+  std::string GetAircraftType();
+  void AddToHistory(const LandingInfo& info);
+
+  void OpenStats();
+  void AddToStats(const LandingInfo& info);
+
+  void StartServer();
+
   std::string name_;
   std::string signature_;
   std::string description_;
@@ -77,10 +107,17 @@ private:
   std::unique_ptr<FlightLoop> flight_loop_;
   std::unique_ptr<XPLMErrorCallback> error_callback_;
 
-  int flying_tick_count_ = 0;
-  bool really_flying_ = false;
+  LandingClassifier classifier_;
+  LandingHistory history_;
+  LandingStats stats_;
+  LandingStatsWriter stats_writer_;
+  RunwayDatabase runways_;
+  SessionExporter exporter_;
+  TelemetryServer server_;
+  SettingsWatcher settings_watcher_;
 
   XPLMData vr_enabled_;
+  XPLMDataRef aircraft_icao_ = nullptr;  // byte array, XPLMData has no accessor
 };
 
 // Implements the plugin factory
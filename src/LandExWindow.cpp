@@ -19,16 +19,24 @@
 
 #include "LandExWindow.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "xplmpp/XPLMScreen.h"
 #include "xplmpp/Rect.h"
 
 #include "XPLMGraphics.h"
 
-#include "GlideSlope.h"
+#include "GLCanvas.h"
+#include "Settings.h"
 
 namespace xplmpp {
 
-static const int kLineCountLimit = 100;
+static const size_t kLogCapacity = 4096;  // lines
+
+static const float kMinZoom = 1.0f / 8;
+static const float kMaxZoom = 256.0f;
+static const float kMaxPanViews = 8.0f;  // default view widths either way
 
 static const Point kDefWindowPos = Point(50, 150);
 static const Size kDefWindowSize = Size(465, 300);
@@ -38,7 +46,8 @@ static const Size kMaxWindowSize = Size(800, 1000);
 /*
  * LandEx plugin window implementation.
  */
-LandExWindow::LandExWindow() {
+LandExWindow::LandExWindow()
+: log_(kLogCapacity) {
 }
 
 LandExWindow::~LandExWindow() {
@@ -73,7 +82,7 @@ void LandExWindow::Hide() {
 }
 
 void LandExWindow::Clear() {
-  lines_.clear();
+  log_.Clear();
 }
 
 void LandExWindow::UpdateOnVRChange(bool vr) {
@@ -88,11 +97,39 @@ void LandExWindow::UpdateOnVRChange(bool vr) {
 }
 
 void LandExWindow::AddLine(const std::string& line) {
-  lines_.emplace_back(line);
+  log_.AddMessage(line);
+}
 
-  while (lines_.size() > kLineCountLimit) {
-    lines_.erase(lines_.begin());
-  }
+void LandExWindow::ScrollLog(int pages) {
+  log_.ScrollBy(pages * std::max(visible_rows_ - 1, 1));
+}
+
+void LandExWindow::ScrollLogToEnd() {
+  log_.ScrollToEnd();
+}
+
+void LandExWindow::ZoomView(int steps) {
+  GlideSlopeView view = glide_slope_.view();
+  view.zoom = std::min(std::max(view.zoom * powf(2.0f, static_cast<float>(steps)),
+                                kMinZoom), kMaxZoom);
+  glide_slope_.SetView(view);
+}
+
+void LandExWindow::PanView(int steps) {
+  GlideSlopeView view = glide_slope_.view();
+  float view_width = g_settings.runway_distance() + g_settings.approach_distance();
+  float max_pan = view_width * kMaxPanViews;
+  view.pan = std::min(std::max(view.pan + steps * view_width / view.zoom / 4,
+                               -max_pan), max_pan);
+  glide_slope_.SetView(view);
+}
+
+void LandExWindow::ResetView() {
+  glide_slope_.SetView(GlideSlopeView());
+}
+
+void LandExWindow::OnLayoutChanged() {
+  glide_slope_.Invalidate();
 }
 
 void LandExWindow::GetDefaultWindowPos(Rect& rc) {
@@ -129,27 +166,38 @@ void LandExWindow::OnDrawWindow() {
     static_cast<float>(rc.right),
     static_cast<float>(glide_slope_bottom));
 
-  GlideSlope glide_slope(rc_glide_slope);
-  glide_slope.Draw();
+  GLCanvas canvas;
+
+  glide_slope_.SetRect(rc_glide_slope);
+  glide_slope_.Draw(canvas);
 
   int char_width, char_height;
-  ::XPLMGetFontDimensions(xplmFont_Proportional,
-      &char_width, &char_height, nullptr);
+  canvas.GetFontDimensions(&char_width, &char_height);
 
   int line_height = char_height + char_height / 4;
-  int text_height = line_height * static_cast<int>(lines_.size());
+  visible_rows_ = std::max((glide_slope_bottom - rc.bottom - 1) / line_height, 1);
+
+  static const float clr_white[] = { 1.0, 1.0, 1.0 };
+  static const float clr_grey[] = { 0.6f, 0.6f, 0.6f };
 
+  // Only the rows that fit under the glide slope get formatted, bottom up
+  // from the latest line, or from where the log is scrolled to.
   int x = rc.left;
-  int y = rc.bottom + text_height - line_height;
-  for (const std::string& line : lines_) {
-    if (y + line_height < glide_slope_bottom) {
-      static float clr_white[] = { 1.0, 1.0, 1.0 };
-      ::XPLMDrawString(clr_white, x, y,
-          const_cast <char*>(line.c_str()), nullptr,
-          xplmFont_Proportional);
-    }
-
-    y -= line_height;
+  int y = rc.bottom;
+  int rows = visible_rows_;
+  if (log_.scroll() && rows > 1) {
+    row_.clear();
+    row_ << "... " << log_.scroll() << " more";
+    canvas.DrawString(clr_grey, x, y, row_.c_str());
+    y += line_height;
+    --rows;
+  }
+
+  size_t index = log_.size() - log_.scroll();
+  for (; rows > 0 && index > 0; --rows) {
+    log_.Format(--index, row_);
+    canvas.DrawString(clr_white, x, y, row_.c_str());
+    y += line_height;
   }
 }
 
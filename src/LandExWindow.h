@@ -26,6 +26,9 @@
 
 #include "xplmpp/XPLMWindow.h"
 
+#include "GlideSlope.h"
+#include "LandingLog.h"
+
 namespace xplmpp {
 
 // Represents the plugin window
@@ -45,13 +48,33 @@ public:
 
   void AddLine(const std::string& line);
 
+  LandingLog& log() { return log_; }
+
+  // Scrolls the log by |pages| screens, back to the older lines for
+  // positive |pages|.
+  void ScrollLog(int pages);
+  void ScrollLogToEnd();
+
+  // Zooms the glide slope view in by |steps| doubling steps, out for
+  // negative |steps|, and pans it by |steps| quarters of its width.
+  void ZoomView(int steps);
+  void PanView(int steps);
+  void ResetView();
+
+  // Drops whatever was laid out for the previous glide slope settings.
+  void OnLayoutChanged();
+
 private:
   // XPLMWindow interface.
   void OnDrawWindow() override;
 
   void GetDefaultWindowPos(Rect& rc);
 
-  std::vector<std::string> lines_;
+  LandingLog log_;
+  int visible_rows_ = 1;
+  TextLine row_;
+
+  GlideSlope glide_slope_;
 
 };
 
@@ -0,0 +1,218 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Background landing analysis implementation.
+
+#include "LandingAnalyzer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "FlightMath.h"
+#include "FlightTracker.h"
+
+namespace xplmpp {
+
+static const size_t kQueueCapacity = 4096;  // records
+static const size_t kResultQueueCapacity = 16;
+static const auto kWorkerMinIdleSleep = std::chrono::milliseconds(1);
+static const auto kWorkerMaxIdleSleep = std::chrono::milliseconds(20);
+
+static const float kHistorySeconds = 120.0f;
+static const float kMaxGroundRollSeconds = 90.0f;
+static const float kFloatHeight = 5.0f * kFtToMeters;
+static const float kGateHeight = 500.0f * kFtToMeters;  // stabilized approach gate
+static const float kStableVerticalSpeedDeviation = 300.0f / 196.8504f;  // 300 fpm
+static const float kStableHeadingDeviation = 10.0f;  // degrees
+
+namespace {
+
+bool IsState(const FlightRecord& record, FlightTracker::State state) {
+  return record.state == static_cast<uint8_t>(state);
+}
+
+}  // namespace
+
+LandingAnalyzer::LandingAnalyzer(float flare_height)
+: flare_height_(flare_height)
+, queue_(kQueueCapacity)
+, results_(kResultQueueCapacity) {
+}
+
+LandingAnalyzer::~LandingAnalyzer() {
+  Stop();
+}
+
+void LandingAnalyzer::Start() {
+  if (is_running())
+    return;
+
+  stopping_ = false;
+  worker_thread_ = std::thread(&LandingAnalyzer::WorkerThread, this);
+}
+
+void LandingAnalyzer::Stop() {
+  if (!is_running())
+    return;
+
+  stopping_ = true;
+  worker_thread_.join();
+
+  if (dropped_count_) {
+    LOG(WARNING) << "Landing analyzer dropped " << dropped_count_ << " records.";
+  }
+}
+
+void LandingAnalyzer::WorkerThread() {
+  auto idle_sleep = kWorkerMinIdleSleep;
+
+  for (;;) {
+    // Check before draining so that nothing posted before Stop() is lost
+    bool stopping = stopping_;
+
+    FlightRecord record;
+    bool popped = false;
+    while (queue_.TryPop(record)) {
+      popped = true;
+      Process(record);
+    }
+
+    if (stopping) {
+      // Report the landing still rolling out as is
+      if (has_contact_)
+        AnalyzeLanding();
+      break;
+    }
+
+    // Back off while idle, but keep up when records come in fast
+    if (popped) {
+      idle_sleep = kWorkerMinIdleSleep;
+    } else {
+      std::this_thread::sleep_for(idle_sleep);
+      idle_sleep = std::min(idle_sleep * 2, kWorkerMaxIdleSleep);
+    }
+  }
+}
+
+void LandingAnalyzer::Process(const FlightRecord& record) {
+  // Start over if the sim time went back, e.g. a situation was reloaded
+  if (!history_.empty() && record.time < history_.back().time) {
+    history_.clear();
+    has_contact_ = false;
+  }
+
+  bool touchdown = !history_.empty() &&
+                   IsState(history_.back(), FlightTracker::State::flying) &&
+                   IsState(record, FlightTracker::State::landed);
+
+  history_.push_back(record);
+
+  if (touchdown && !has_contact_) {
+    has_contact_ = true;
+    contact_time_ = record.time;
+  }
+
+  // Wait for the ground roll to end before analyzing the landing
+  if (has_contact_ &&
+      (record.ground_speed < kTaxiSpeed ||
+       !IsState(record, FlightTracker::State::landed) ||
+       record.time - contact_time_ > kMaxGroundRollSeconds))
+    AnalyzeLanding();
+
+  // Drop the records too old to matter, unless waiting on a ground roll
+  if (!has_contact_) {
+    while (record.time - history_.front().time > kHistorySeconds)
+      history_.pop_front();
+  }
+}
+
+void LandingAnalyzer::AnalyzeLanding() {
+  size_t contact = 0;
+  while (history_[contact].time < contact_time_)
+    ++contact;
+
+  LandingAnalysis analysis;
+  Analyze(contact, history_.size() - 1, analysis);
+  if (!results_.TryPush(analysis)) {
+    LOG(WARNING) << "Landing analysis result dropped.";
+  }
+  has_contact_ = false;
+}
+
+void LandingAnalyzer::Analyze(size_t contact, size_t end,
+                              LandingAnalysis& analysis) const {
+  // The gear may be loaded a few frames before the airplane is considered
+  // on the ground.
+  while (contact > 0 && history_[contact - 1].faxil_gear != 0.0f &&
+         !(history_[contact - 1].flags & FlightRecord::kReplayMode))
+    --contact;
+
+  const FlightRecord& touchdown = history_[contact];
+  RunwayFrame frame(touchdown.lat, touchdown.lon, touchdown.heading);
+
+  analysis.contact_time = touchdown.time;
+
+  // Flare: from the last frame above the flare height down to the contact
+  float flare_height = flare_height_;
+  size_t flare = contact;
+  while (flare > 0 && history_[flare - 1].agl < flare_height)
+    --flare;
+  analysis.has_flare = flare > 0;
+  analysis.flare_time = touchdown.time - history_[flare].time;
+  analysis.flare_vertical_speed = history_[flare].vertical_speed;
+
+  // Float: the part of the flare right above the runway
+  size_t floating = contact;
+  while (floating > 0 && history_[floating - 1].agl < kFloatHeight)
+    --floating;
+  analysis.float_time = touchdown.time - history_[floating].time;
+  analysis.float_distance = -frame.AlongTrack(history_[floating].lat, history_[floating].lon);
+
+  // Ground roll: from the contact down to the taxi speed
+  const FlightRecord& last = history_[end];
+  analysis.ground_roll_time = last.time - touchdown.time;
+  analysis.ground_roll_distance = frame.AlongTrack(last.lat, last.lon);
+  analysis.ground_roll_complete = last.ground_speed < kTaxiSpeed;
+
+  // Stability: between the stabilized approach gate and the flare height
+  size_t count = 0;
+  double mean = 0, m2 = 0;
+  float heading_deviation = 0;
+  for (size_t index = flare; index-- > 0;) {
+    const FlightRecord& record = history_[index];
+    if (!IsState(record, FlightTracker::State::flying) || record.agl > kGateHeight)
+      break;
+
+    // Welford's running variance
+    ++count;
+    double delta = record.vertical_speed - mean;
+    mean += delta / count;
+    m2 += delta * (record.vertical_speed - mean);
+
+    heading_deviation = std::max(heading_deviation,
+                                 HeadingDelta(record.heading, touchdown.heading));
+  }
+
+  analysis.approach_samples = count;
+  analysis.vertical_speed_deviation = count ? static_cast<float>(sqrt(m2 / count)) : 0.0f;
+  analysis.heading_deviation = heading_deviation;
+  analysis.stabilized = count > 0 &&
+      analysis.vertical_speed_deviation < kStableVerticalSpeedDeviation &&
+      analysis.heading_deviation < kStableHeadingDeviation;
+}
+
+}  // namespace xplmpp
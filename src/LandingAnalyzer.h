@@ -0,0 +1,97 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Background landing analysis.
+
+#ifndef LANDEX_LANDINGANALYZER_H
+#define LANDEX_LANDINGANALYZER_H
+
+#include <atomic>
+#include <deque>
+#include <thread>
+
+#include "Common.h"
+
+#include "FlightLoopClient.h"
+#include "FlightRecorder.h"
+#include "SpscQueue.h"
+
+namespace xplmpp {
+
+// Analyzes the landings on a worker thread. Flight records are handed over
+// through a lock-free queue, and the worker keeps its own history of them,
+// so Post() costs the caller a queue push no matter how heavy the analysis
+// gets. Results come back through another lock-free queue to be picked up
+// by the caller's thread with TryGetResult().
+class LandingAnalyzer {
+public:
+  // |flare_height| is in meters
+  explicit LandingAnalyzer(float flare_height);
+  ~LandingAnalyzer();
+
+  void Start();
+  void Stop();
+
+  bool is_running() const { return worker_thread_.joinable(); }
+
+  // Producer side, never blocks. Records that do not fit in the queue are
+  // dropped and counted.
+  void Post(const FlightRecord& record) {
+    if (!TryPost(record))
+      ++dropped_count_;
+  }
+
+  // Same as above, but leaves it to the caller to deal with the full queue
+  bool TryPost(const FlightRecord& record) {
+    return queue_.TryPush(record);
+  }
+
+  // Consumer side, returns false if there are no results
+  bool TryGetResult(LandingAnalysis& analysis) {
+    return results_.TryPop(analysis);
+  }
+
+  size_t dropped_count() const { return dropped_count_; }
+
+  // Takes effect from the next landing analyzed
+  void set_flare_height(float flare_height) { flare_height_ = flare_height; }
+
+private:
+  void WorkerThread();
+
+  void Process(const FlightRecord& record);
+  void AnalyzeLanding();
+  void Analyze(size_t contact, size_t end, LandingAnalysis& analysis) const;
+
+  std::atomic<float> flare_height_;
+
+  SpscQueue<FlightRecord> queue_;
+  SpscQueue<LandingAnalysis> results_;
+  size_t dropped_count_ = 0;
+
+  std::thread worker_thread_;
+  std::atomic<bool> stopping_{false};
+
+  // Worker owned
+  std::deque<FlightRecord> history_;
+  bool has_contact_ = false;
+  float contact_time_ = 0;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_LANDINGANALYZER_H
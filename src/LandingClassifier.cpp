@@ -0,0 +1,91 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Landing classification implementation.
+
+#include "LandingClassifier.h"
+
+namespace xplmpp {
+
+static const float kReallyFlyingAgl = 10.0f;
+
+static const float kQualityLimits[] = {
+  0.25f,  // ~50 fpm
+  0.50f,
+  1.00f,
+  1.50f,
+  2.00f,
+  2.50f,
+  3.00f,
+};
+
+static const char* kQualityNames[] = {
+  "EXCELLENT LANDING",
+  "GREAT LANDING",
+  "GOOD LANDING",
+  "ACCEPTABLE LANDING",
+  "HARD LANDING",
+  "BAD LANDING",
+  "ANY SURVIVORS?",
+  "R.I.P.",
+};
+
+static_assert(numbof(kQualityNames) == numbof(kQualityLimits) + 1,
+              "Landing quality tables mismatch");
+
+const char* LandingQuality(float vy) {
+  return LandingQualityName(LandingQualityIndex(vy));
+}
+
+int LandingQualityIndex(float vy) {
+  size_t index = 0;
+  while (index < numbof(kQualityLimits) && vy >= kQualityLimits[index])
+    ++index;
+  return static_cast<int>(index);
+}
+
+const char* LandingQualityName(int index) {
+  if (index < 0 || static_cast<size_t>(index) >= numbof(kQualityNames))
+    return "";
+  return kQualityNames[index];
+}
+
+int LandingQualityCount() {
+  return static_cast<int>(numbof(kQualityNames));
+}
+
+LandingClassifier::FlyingEvent LandingClassifier::OnAirplaneFlying(
+    const FlyingInfo& info) {
+  if (flying_tick_count_++ > 0) {
+    if (!really_flying_ && info.agl >= kReallyFlyingAgl) {
+      really_flying_ = true;
+      return FlyingEvent::reallyFlying;
+    }
+    return FlyingEvent::none;
+  }
+
+  return FlyingEvent::takeoff;
+}
+
+bool LandingClassifier::OnAirplaneLanded() {
+  bool was_really_flying = really_flying_;
+  really_flying_ = false;
+  flying_tick_count_ = 0;
+  return was_really_flying;
+}
+
+}  // namespace xplmpp
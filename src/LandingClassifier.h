@@ -0,0 +1,64 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Landing classification.
+
+#ifndef LANDEX_LANDINGCLASSIFIER_H
+#define LANDEX_LANDINGCLASSIFIER_H
+
+#include "Common.h"
+
+#include "FlightLoopClient.h"
+
+namespace xplmpp {
+
+// Returns the landing quality for the touchdown vertical speed |vy|,
+// meters/sec.
+const char* LandingQuality(float vy);
+
+// Returns the landing quality as an index, 0 being the best, so that it can
+// be stored and compared.
+int LandingQualityIndex(float vy);
+const char* LandingQualityName(int index);
+int LandingQualityCount();
+
+// Follows the flying reports to tell real flights from hopping around on the
+// ground, since only landings after a real flight are worth classifying.
+class LandingClassifier {
+public:
+  enum class FlyingEvent {
+    none,
+    takeoff,       // first flying report since landing
+    reallyFlying,  // got high enough to be really flying
+  };
+
+  LandingClassifier() = default;
+  ~LandingClassifier() = default;
+
+  FlyingEvent OnAirplaneFlying(const FlyingInfo& info);
+
+  // Returns true if the airplane was really flying before landing.
+  bool OnAirplaneLanded();
+
+private:
+  int flying_tick_count_ = 0;
+  bool really_flying_ = false;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_LANDINGCLASSIFIER_H
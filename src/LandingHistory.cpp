@@ -0,0 +1,452 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Persistent landing history implementation.
+
+#include "LandingHistory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <functional>
+
+#include "LandingClassifier.h"
+
+namespace xplmpp {
+
+// History file header, followed by the records.
+struct HistoryHeader {
+  char magic[4];         // kHistoryMagic
+  uint32_t version;      // kHistoryVersion
+  uint32_t header_size;  // offset of the first record
+  uint32_t record_size;  // sizeof(LandingRecord)
+  uint64_t count;        // number of records, updated after each record
+  int64_t created;       // ties the index to this very history file
+};
+
+// Index file header, followed by the aircraft table, the cell chain heads and
+// the cell chain links, one per record.
+struct LandingIndexHeader {
+  char magic[4];          // kIndexMagic
+  uint32_t version;       // kIndexVersion
+  int64_t created;        // HistoryHeader::created
+  uint32_t record_count;  // number of records indexed
+  uint32_t capacity;      // number of records the links have room for
+  uint32_t aircraft_count;
+  uint32_t reserved;
+};
+
+// Per aircraft type statistics, record indexes.
+struct LandingAircraftEntry {
+  char aircraft[8];
+  uint32_t count;
+  uint32_t best;
+  uint32_t worst;
+  uint32_t last;
+};
+
+static_assert(sizeof(HistoryHeader) == 32, "HistoryHeader layout");
+static_assert(sizeof(LandingIndexHeader) == 32, "LandingIndexHeader layout");
+static_assert(sizeof(LandingAircraftEntry) == 24, "LandingAircraftEntry layout");
+
+static const char kHistoryMagic[4] = { 'L', 'X', 'L', 'H' };
+static const uint32_t kHistoryVersion = 1;
+static const char kIndexMagic[4] = { 'L', 'X', 'L', 'I' };
+static const uint32_t kIndexVersion = 1;
+
+static const size_t kInitialCapacity = 256;  // records
+static const size_t kMaxAircraftCount = 256;
+static const size_t kCellBucketCount = 4096;  // hashed 1x1 degree cells
+static const uint32_t kNoRecord = 0xFFFFFFFF;
+
+static const size_t kAircraftTableOffset = sizeof(LandingIndexHeader);
+static const size_t kCellHeadsOffset =
+    kAircraftTableOffset + kMaxAircraftCount * sizeof(LandingAircraftEntry);
+static const size_t kNextInCellOffset =
+    kCellHeadsOffset + kCellBucketCount * sizeof(uint32_t);
+
+namespace {
+
+HistoryHeader* GetHistoryHeader(const MappedFile& file) {
+  return reinterpret_cast<HistoryHeader*>(file.data());
+}
+
+void CopyAircraft(char* dst, const char* src) {
+  size_t n = 0;
+  for (; n < sizeof(LandingRecord::aircraft) && src[n]; ++n)
+    dst[n] = src[n];
+  for (; n < sizeof(LandingRecord::aircraft); ++n)
+    dst[n] = 0;
+}
+
+size_t GetCellBucket(double lat, double lon) {
+  int lat_cell = static_cast<int>(floor(std::min(std::max(lat, -90.0), 90.0))) + 90;
+  int lon_cell = static_cast<int>(floor(std::min(std::max(lon, -180.0), 180.0))) + 180;
+  return static_cast<size_t>(lat_cell * 361 + lon_cell) % kCellBucketCount;
+}
+
+bool IsInBox(const LandingRecord& record, double min_lat, double min_lon,
+             double max_lat, double max_lon) {
+  return record.lat >= min_lat && record.lat <= max_lat &&
+         record.lon >= min_lon && record.lon <= max_lon;
+}
+
+}  // namespace
+
+/*
+ * Landing record implementation.
+ */
+LandingRecord::LandingRecord(const LandingInfo& info, const std::string& aircraft,
+                             int64_t timestamp)
+: timestamp(timestamp)
+, lat(info.lat)
+, lon(info.lon)
+, heading(info.heading)
+, vertical_speed(info.vertical_speed)
+, ground_speed(info.ground_speed)
+, gforce(info.gforce)
+, peak_vertical_speed(info.peak_vertical_speed)
+, quality(static_cast<uint8_t>(LandingQualityIndex(fabs(info.vertical_speed))))
+, reserved() {
+  CopyAircraft(this->aircraft, aircraft.c_str());
+}
+
+std::string LandingRecord::aircraft_type() const {
+  return std::string(aircraft, strnlen(aircraft, sizeof(aircraft)));
+}
+
+/*
+ * Landing history implementation.
+ */
+LandingHistory::~LandingHistory() {
+  Close();
+}
+
+bool LandingHistory::Open(const std::string& filename,
+                          const std::string& index_filename) {
+  Close();
+
+  if (!file_.Open(filename, sizeof(HistoryHeader) + kInitialCapacity * sizeof(LandingRecord)))
+    return false;
+
+  HistoryHeader* header = GetHistoryHeader(file_);
+  if (!memcmp(header->magic, "\0\0\0\0", sizeof(header->magic))) {
+    // Brand new history
+    memcpy(header->magic, kHistoryMagic, sizeof(header->magic));
+    header->version = kHistoryVersion;
+    header->header_size = sizeof(HistoryHeader);
+    header->record_size = sizeof(LandingRecord);
+    header->count = 0;
+    header->created = time(nullptr);
+  }
+
+  if (memcmp(header->magic, kHistoryMagic, sizeof(header->magic)) != 0 ||
+      header->version != kHistoryVersion ||
+      header->header_size < sizeof(HistoryHeader) ||
+      header->record_size != sizeof(LandingRecord) ||
+      header->header_size + header->count * sizeof(LandingRecord) > file_.size() ||
+      header->count >= kNoRecord) {
+    LOG(ERROR) << "Invalid landing history file '" << filename << "'.";
+    file_.Close();
+    return false;
+  }
+
+  if (!OpenIndex(index_filename)) {
+    file_.Close();
+    return false;
+  }
+
+  return true;
+}
+
+void LandingHistory::Close() {
+  Flush();
+  index_.Close();
+  file_.Close();
+}
+
+bool LandingHistory::OpenIndex(const std::string& index_filename) {
+  if (!index_.Open(index_filename, kNextInCellOffset + kInitialCapacity * sizeof(uint32_t)))
+    return false;
+
+  const HistoryHeader* history_header = GetHistoryHeader(file_);
+  const LandingIndexHeader* header = index_header();
+  if (memcmp(header->magic, kIndexMagic, sizeof(header->magic)) != 0 ||
+      header->version != kIndexVersion ||
+      header->created != history_header->created ||
+      header->record_count > history_header->count ||
+      header->capacity < header->record_count ||
+      kNextInCellOffset + header->capacity * sizeof(uint32_t) > index_.size() ||
+      header->aircraft_count > kMaxAircraftCount) {
+    if (memcmp(header->magic, "\0\0\0\0", sizeof(header->magic)) != 0)
+      LOG(INFO) << "Rebuilding landing history index '" << index_filename << "'.";
+    if (!ResetIndex())
+      return false;
+  }
+
+  // Catch up with the landings appended since the index was last updated,
+  // normally none.
+  uint32_t count = static_cast<uint32_t>(history_header->count);
+  if (!ReserveIndex(count))
+    return false;
+  for (uint32_t index = index_header()->record_count; index < count; ++index) {
+    IndexRecord(index);
+    index_header()->record_count = index + 1;
+  }
+
+  return true;
+}
+
+bool LandingHistory::ResetIndex() {
+  memset(index_.data(), 0, kNextInCellOffset);
+
+  LandingIndexHeader* header = index_header();
+  memcpy(header->magic, kIndexMagic, sizeof(header->magic));
+  header->version = kIndexVersion;
+  header->created = GetHistoryHeader(file_)->created;
+  header->record_count = 0;
+  header->capacity = static_cast<uint32_t>(
+      (index_.size() - kNextInCellOffset) / sizeof(uint32_t));
+  header->aircraft_count = 0;
+
+  std::fill(cell_heads(), cell_heads() + kCellBucketCount, kNoRecord);
+  return true;
+}
+
+bool LandingHistory::ReserveIndex(size_t record_count) {
+  size_t capacity = index_header()->capacity;
+  if (record_count <= capacity)
+    return true;
+
+  capacity = std::max(capacity, kInitialCapacity);
+  while (capacity < record_count)
+    capacity *= 2;
+
+  if (!index_.Resize(kNextInCellOffset + capacity * sizeof(uint32_t)))
+    return false;
+
+  index_header()->capacity = static_cast<uint32_t>(capacity);
+  return true;
+}
+
+void LandingHistory::IndexRecord(uint32_t index) {
+  const LandingRecord& record = Get(index);
+
+  // Link the record at the head of its cell chain. A crash right before
+  // record_count is updated leaves the record indexed but not counted in,
+  // and it is indexed again on the next open, so skip what is done already.
+  uint32_t& head = cell_heads()[GetCellBucket(record.lat, record.lon)];
+  if (head != index) {
+    next_in_cell()[index] = head;
+    head = index;
+  }
+
+  LandingAircraftEntry* entry = FindOrAddAircraft(record.aircraft);
+  if (!entry || (entry->count && entry->last == index))
+    return;
+
+  float vy = fabs(record.vertical_speed);
+  if (!entry->count++) {
+    entry->best = entry->worst = index;
+  } else {
+    if (vy < fabs(Get(entry->best).vertical_speed))
+      entry->best = index;
+    if (vy >= fabs(Get(entry->worst).vertical_speed))
+      entry->worst = index;
+  }
+  entry->last = index;
+}
+
+bool LandingHistory::Append(const LandingRecord& record) {
+  if (!is_open())
+    return false;
+
+  HistoryHeader* header = GetHistoryHeader(file_);
+  size_t count = header->count;
+  size_t required = header->header_size + (count + 1) * sizeof(LandingRecord);
+  if (required > file_.size()) {
+    if (!file_.Resize(std::max(required, file_.size() * 2))) {
+      LOG(ERROR) << "Could not grow the landing history.";
+      return false;
+    }
+    header = GetHistoryHeader(file_);
+  }
+
+  // Write the record before counting it in, so a crash in between leaves a
+  // consistent history
+  memcpy(file_.data() + header->header_size + count * sizeof(LandingRecord),
+         &record, sizeof(record));
+  header->count = count + 1;
+
+  if (!ReserveIndex(count + 1)) {
+    LOG(ERROR) << "Could not grow the landing history index.";
+    return false;
+  }
+  IndexRecord(static_cast<uint32_t>(count));
+  index_header()->record_count = static_cast<uint32_t>(count + 1);
+
+  return true;
+}
+
+void LandingHistory::Flush() {
+  if (file_.is_open())
+    file_.Flush();
+  if (index_.is_open())
+    index_.Flush();
+}
+
+size_t LandingHistory::size() const {
+  return is_open() ? static_cast<size_t>(GetHistoryHeader(file_)->count) : 0;
+}
+
+const LandingRecord& LandingHistory::Get(size_t index) const {
+  const HistoryHeader* header = GetHistoryHeader(file_);
+  return reinterpret_cast<const LandingRecord*>(file_.data() + header->header_size)[index];
+}
+
+void LandingHistory::GetLast(size_t count, std::vector<LandingRecord>& records) const {
+  records.clear();
+
+  size_t size = this->size();
+  count = std::min(count, size);
+  records.reserve(count);
+  for (size_t n = 0; n < count; ++n)
+    records.push_back(Get(size - 1 - n));
+}
+
+size_t LandingHistory::GetCount(const std::string& aircraft) const {
+  const LandingAircraftEntry* entry = FindAircraft(aircraft.c_str());
+  return entry ? entry->count : 0;
+}
+
+bool LandingHistory::GetBest(const std::string& aircraft, LandingRecord& record) const {
+  const LandingAircraftEntry* entry = FindAircraft(aircraft.c_str());
+  if (!entry || !entry->count)
+    return false;
+
+  record = Get(entry->best);
+  return true;
+}
+
+bool LandingHistory::GetWorst(const std::string& aircraft, LandingRecord& record) const {
+  const LandingAircraftEntry* entry = FindAircraft(aircraft.c_str());
+  if (!entry || !entry->count)
+    return false;
+
+  record = Get(entry->worst);
+  return true;
+}
+
+void LandingHistory::FindInBox(double min_lat, double min_lon, double max_lat, double max_lon,
+                               std::vector<LandingRecord>& records) const {
+  records.clear();
+  if (!is_open())
+    return;
+
+  double lat_cells = floor(max_lat) - floor(min_lat) + 1;
+  double lon_cells = floor(max_lon) - floor(min_lon) + 1;
+  if (lat_cells <= 0 || lon_cells <= 0)
+    return;
+
+  if (lat_cells * lon_cells >= kCellBucketCount) {
+    // Most of the world, the index would not help
+    for (size_t index = size(); index-- > 0; ) {
+      const LandingRecord& record = Get(index);
+      if (IsInBox(record, min_lat, min_lon, max_lat, max_lon))
+        records.push_back(record);
+    }
+    return;
+  }
+
+  // Walk the chains of the cells under the box, different cells may share a
+  // chain
+  std::vector<bool> visited(kCellBucketCount);
+  std::vector<uint32_t> found;
+  for (double lat = floor(min_lat); lat <= max_lat; lat += 1.0) {
+    for (double lon = floor(min_lon); lon <= max_lon; lon += 1.0) {
+      size_t bucket = GetCellBucket(lat, lon);
+      if (visited[bucket])
+        continue;
+      visited[bucket] = true;
+
+      for (uint32_t index = cell_heads()[bucket]; index != kNoRecord;
+           index = next_in_cell()[index]) {
+        if (IsInBox(Get(index), min_lat, min_lon, max_lat, max_lon))
+          found.push_back(index);
+      }
+    }
+  }
+
+  std::sort(found.begin(), found.end(), std::greater<uint32_t>());
+  records.reserve(found.size());
+  for (uint32_t index : found)
+    records.push_back(Get(index));
+}
+
+const LandingAircraftEntry* LandingHistory::FindAircraft(
+    const char* aircraft) const {
+  if (!is_open())
+    return nullptr;
+
+  char key[sizeof(LandingRecord::aircraft)];
+  CopyAircraft(key, aircraft);
+
+  const LandingAircraftEntry* table = aircraft_table();
+  for (uint32_t n = 0; n < index_header()->aircraft_count; ++n) {
+    if (!memcmp(table[n].aircraft, key, sizeof(key)))
+      return &table[n];
+  }
+
+  return nullptr;
+}
+
+LandingAircraftEntry* LandingHistory::FindOrAddAircraft(const char* aircraft) {
+  LandingAircraftEntry* entry = const_cast<LandingAircraftEntry*>(FindAircraft(aircraft));
+  if (entry)
+    return entry;
+
+  LandingIndexHeader* header = index_header();
+  if (header->aircraft_count == kMaxAircraftCount) {
+    LOG(WARNING) << "Too many aircraft types in the landing history.";
+    return nullptr;
+  }
+
+  entry = &aircraft_table()[header->aircraft_count++];
+  CopyAircraft(entry->aircraft, aircraft);
+  entry->count = 0;
+  entry->best = entry->worst = entry->last = kNoRecord;
+  return entry;
+}
+
+LandingIndexHeader* LandingHistory::index_header() const {
+  return reinterpret_cast<LandingIndexHeader*>(index_.data());
+}
+
+LandingAircraftEntry* LandingHistory::aircraft_table() const {
+  return reinterpret_cast<LandingAircraftEntry*>(index_.data() + kAircraftTableOffset);
+}
+
+uint32_t* LandingHistory::cell_heads() const {
+  return reinterpret_cast<uint32_t*>(index_.data() + kCellHeadsOffset);
+}
+
+uint32_t* LandingHistory::next_in_cell() const {
+  return reinterpret_cast<uint32_t*>(index_.data() + kNextInCellOffset);
+}
+
+}  // namespace xplmpp
@@ -0,0 +1,116 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Persistent landing history.
+
+#ifndef LANDEX_LANDINGHISTORY_H
+#define LANDEX_LANDINGHISTORY_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "Common.h"
+#include "FlightLoopClient.h"
+#include "MappedFile.h"
+
+namespace xplmpp {
+
+// Landing history record, one per landing. Records are appended to the
+// history file and never change afterwards.
+struct LandingRecord {
+  LandingRecord() = default;
+  LandingRecord(const LandingInfo& info, const std::string& aircraft, int64_t timestamp);
+
+  std::string aircraft_type() const;
+
+  int64_t timestamp;          // seconds since the epoch
+  char aircraft[8];           // ICAO type designator, zero padded
+  double lat;
+  double lon;
+  float heading;              // degrees
+  float vertical_speed;       // meters/sec at the contact
+  float ground_speed;         // meters/sec at the contact
+  float gforce;               // meters/sec^2 at the contact
+  float peak_vertical_speed;  // meters/sec around touchdown
+  uint8_t quality;            // LandingQualityIndex()
+  uint8_t reserved[3];
+};
+
+static_assert(sizeof(LandingRecord) == 56, "LandingRecord layout");
+
+struct LandingIndexHeader;
+struct LandingAircraftEntry;
+
+// Stores the landings in an append-only file of fixed size records, and
+// keeps a memory mapped index next to it for the queries. Opening reads
+// only the records the index has not seen yet, so it takes the same time
+// however long the history is.
+class LandingHistory {
+public:
+  LandingHistory() = default;
+  ~LandingHistory();
+
+  // Opens or creates the history and its index.
+  bool Open(const std::string& filename, const std::string& index_filename);
+  void Close();
+
+  bool is_open() const { return file_.is_open() && index_.is_open(); }
+
+  bool Append(const LandingRecord& record);
+
+  // Schedules the appended landings to be written to disk.
+  void Flush();
+
+  size_t size() const;
+  const LandingRecord& Get(size_t index) const;
+
+  // Returns up to |count| latest landings, the most recent first.
+  void GetLast(size_t count, std::vector<LandingRecord>& records) const;
+
+  // Finds the softest and the hardest landings in an aircraft type.
+  size_t GetCount(const std::string& aircraft) const;
+  bool GetBest(const std::string& aircraft, LandingRecord& record) const;
+  bool GetWorst(const std::string& aircraft, LandingRecord& record) const;
+
+  // Finds the landings within a lat/lon box, the most recent first. The box
+  // must not cross the antimeridian.
+  void FindInBox(double min_lat, double min_lon, double max_lat, double max_lon,
+                 std::vector<LandingRecord>& records) const;
+
+private:
+  bool OpenIndex(const std::string& index_filename);
+  bool ResetIndex();
+  bool ReserveIndex(size_t record_count);
+  void IndexRecord(uint32_t index);
+
+  const LandingAircraftEntry* FindAircraft(const char* aircraft) const;
+  LandingAircraftEntry* FindOrAddAircraft(const char* aircraft);
+
+  LandingIndexHeader* index_header() const;
+  LandingAircraftEntry* aircraft_table() const;
+  uint32_t* cell_heads() const;
+  uint32_t* next_in_cell() const;
+
+  MappedFile file_;
+  MappedFile index_;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_LANDINGHISTORY_H
@@ -0,0 +1,310 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Landing log implementation.
+
+#include "LandingLog.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "LandingClassifier.h"
+
+namespace xplmpp {
+
+// Entry flags, per entry type
+static const uint8_t kClassify = 0x01;      // landed after a real flight
+static const uint8_t kRollComplete = 0x01;  // rollout down to taxi speed
+static const uint8_t kStabilized = 0x01;    // stabilized approach
+
+// Stats entry quantities
+static const uint8_t kStatsVerticalSpeed = 0;
+static const uint8_t kStatsGforce = 1;
+static const uint8_t kStatsGroundSpeed = 2;
+
+LandingLog::LandingLog(size_t capacity)
+: entries_(capacity)
+, texts_(capacity) {
+}
+
+LandingLog::Entry& LandingLog::Add(EntryType type) {
+  size_t slot;
+  if (size_ < entries_.size()) {
+    slot = first_ + size_++;
+    if (slot >= entries_.size())
+      slot -= entries_.size();
+  } else {
+    // Overwrite the oldest entry
+    slot = first_;
+    first_ = first_ + 1 < entries_.size() ? first_ + 1 : 0;
+  }
+
+  // Keep the view on the same entries when scrolled back
+  if (scroll_ && scroll_ + 1 < size_)
+    ++scroll_;
+
+  Entry& entry = entries_[slot];
+  entry = Entry();
+  entry.type = type;
+  return entry;
+}
+
+uint32_t LandingLog::AddText(const std::string& text) {
+  texts_[text_count_ % texts_.size()] = text;
+  return text_count_++;
+}
+
+const std::string& LandingLog::GetText(uint32_t text) const {
+  static const std::string empty;
+  if (text_count_ - text > texts_.size())
+    return empty;  // long gone
+  return texts_[text % texts_.size()];
+}
+
+void LandingLog::AddMessage(const std::string& text) {
+  Entry& entry = Add(EntryType::message);
+  entry.text = AddText(text);
+}
+
+void LandingLog::AddFlying(const FlyingInfo& info) {
+  Entry& entry = Add(EntryType::flying);
+  entry.values[0] = info.vertical_speed;
+  entry.values[1] = info.ground_speed;
+  entry.values[2] = info.agl;
+  entry.values[3] = info.msl;
+}
+
+void LandingLog::AddLanded(const LandingInfo& info, bool classify) {
+  Entry& landed = Add(EntryType::landed);
+  landed.flags = classify ? kClassify : 0;
+  landed.values[0] = info.vertical_speed;
+  landed.values[1] = info.ground_speed;
+  landed.values[2] = info.gforce;
+
+  Entry& peak = Add(EntryType::peak);
+  peak.values[0] = info.peak_vertical_speed;
+  peak.values[1] = info.min_gforce;
+  peak.values[2] = info.peak_gforce;
+}
+
+void LandingLog::AddAnalysis(const LandingAnalysis& analysis) {
+  if (analysis.has_flare) {
+    Entry& flare = Add(EntryType::flare);
+    flare.values[0] = analysis.flare_time;
+    flare.values[1] = analysis.flare_vertical_speed;
+    flare.values[2] = analysis.float_time;
+    flare.values[3] = analysis.float_distance;
+  }
+
+  Entry& rollout = Add(EntryType::rollout);
+  rollout.flags = analysis.ground_roll_complete ? kRollComplete : 0;
+  rollout.values[0] = analysis.ground_roll_distance;
+  rollout.values[1] = analysis.ground_roll_time;
+
+  if (analysis.approach_samples) {
+    Entry& approach = Add(EntryType::approach);
+    approach.flags = analysis.stabilized ? kStabilized : 0;
+    approach.values[0] = analysis.vertical_speed_deviation;
+    approach.values[1] = analysis.heading_deviation;
+  }
+}
+
+void LandingLog::AddHistory(const std::string& aircraft, size_t count,
+                            float best_vertical_speed, float worst_vertical_speed) {
+  Entry& entry = Add(EntryType::history);
+  entry.text = AddText(aircraft);
+  entry.values[0] = static_cast<float>(count);
+  entry.values[1] = best_vertical_speed;
+  entry.values[2] = worst_vertical_speed;
+}
+
+void LandingLog::AddTraffic(int id, const std::string& aircraft,
+                            const LandingInfo& info) {
+  // Aircraft are told apart by their mode S id, the type may be missing
+  char text[32];
+  snprintf(text, sizeof(text), "%.8s %06X",
+           aircraft.empty() ? "-" : aircraft.c_str(), static_cast<unsigned>(id));
+
+  Entry& entry = Add(EntryType::traffic);
+  entry.text = AddText(text);
+  entry.values[0] = info.vertical_speed;
+  entry.values[1] = info.ground_speed;
+  entry.values[2] = info.peak_vertical_speed;
+}
+
+void LandingLog::AddRunway(const std::string& airport, const std::string& runway,
+                           float distance, float offset) {
+  Entry& entry = Add(EntryType::runway);
+  entry.text = AddText(airport + " " + runway);
+  entry.values[0] = distance;
+  entry.values[1] = offset;
+}
+
+void LandingLog::AddStats(const std::string& aircraft, const LandingSummary& summary) {
+  static_assert(LandingSummary::kQuantileCount == 3, "Stats entry layout");
+
+  // One line per quantity, p50, p90 and p99 in each
+  const struct {
+    uint8_t quantity;
+    const float* values;
+  } lines[] = {
+    { kStatsVerticalSpeed, summary.vertical_speed },
+    { kStatsGforce, summary.gforce },
+    { kStatsGroundSpeed, summary.ground_speed },
+  };
+
+  uint32_t text = AddText(aircraft);
+  for (const auto& line : lines) {
+    Entry& entry = Add(EntryType::stats);
+    entry.flags = line.quantity;
+    entry.text = text;
+    std::copy(line.values, line.values + LandingSummary::kQuantileCount, entry.values);
+    entry.values[3] = static_cast<float>(summary.count);
+  }
+}
+
+void LandingLog::Clear() {
+  first_ = 0;
+  size_ = 0;
+  scroll_ = 0;
+}
+
+const LandingLog::Entry& LandingLog::entry(size_t index) const {
+  size_t slot = first_ + index;
+  return entries_[slot < entries_.size() ? slot : slot - entries_.size()];
+}
+
+void LandingLog::Format(size_t index, TextLine& s) const {
+  const Entry& entry = this->entry(index);
+  const float* values = entry.values;
+
+  s.clear();
+  switch (entry.type) {
+    case EntryType::message:
+      s << GetText(entry.text);
+      break;
+
+    case EntryType::flying:
+      s << "Flying:   "
+        << "  Vy=" << FeetPerMinute(values[0])
+        << "  Vg=" << Knots(values[1])
+        << "  AGL=" << Feet(values[2])
+        << "  MSL=" << Quantity(values[3], "ft");
+      break;
+
+    case EntryType::landed:
+      s << "Landed: "
+        << "  Vy=" << FeetPerMinute(values[0])
+        << "  Vg=" << Knots(values[1])
+        << "  G=" << Quantity(values[2], "m/sec^2");
+      if (entry.flags & kClassify)
+        s << "    " << LandingQuality(fabs(values[0]));
+      break;
+
+    case EntryType::peak:
+      s << "Peak:   "
+        << "  Vy=" << FeetPerMinute(values[0])
+        << "  G=" << values[1] << ".." << Quantity(values[2], "m/sec^2");
+      break;
+
+    case EntryType::flare:
+      s << "Flare:  "
+        << "  " << Quantity(values[0], "sec")
+        << "  from Vy=" << FeetPerMinute(values[1])
+        << "  float " << Quantity(values[2], "sec")
+        << "  " << Feet(values[3], 0);
+      break;
+
+    case EntryType::rollout:
+      s << "Rollout:"
+        << "  " << Feet(values[0], 0)
+        << "  " << Quantity(values[1], "sec");
+      if (!(entry.flags & kRollComplete))
+        s << "  (not stopped)";
+      break;
+
+    case EntryType::approach:
+      s << "Approach:"
+        << " " << (entry.flags & kStabilized ? "stable" : "unstable")
+        << "  Vy dev=" << FeetPerMinute(values[0])
+        << "  Hdg dev=" << Quantity(values[1], "deg");
+      break;
+
+    case EntryType::history: {
+      const std::string& aircraft = GetText(entry.text);
+      s << "History:"
+        << "  " << static_cast<size_t>(values[0]) << " landings in "
+        << (aircraft.empty() ? "this aircraft" : aircraft.c_str())
+        << "  best Vy=" << FeetPerMinute(values[1])
+        << "  worst Vy=" << FeetPerMinute(values[2]);
+      break;
+    }
+
+    case EntryType::traffic:
+      s << "Traffic: " << GetText(entry.text)
+        << "  Vy=" << FeetPerMinute(values[0])
+        << "  Vg=" << Knots(values[1])
+        << "  peak Vy=" << FeetPerMinute(values[2])
+        << "    " << LandingQuality(fabs(values[0]));
+      break;
+
+    case EntryType::runway:
+      s << "Runway: " << GetText(entry.text)
+        << "  " << Feet(values[0], 0) << " past threshold"
+        << "  " << Feet(fabs(values[1]), 0) << (values[1] < 0 ? " left" : " right");
+      break;
+
+    case EntryType::stats: {
+      const std::string& aircraft = GetText(entry.text);
+      s << "Stats:  "
+        << "  " << (aircraft.empty() ? "this aircraft" : aircraft.c_str());
+      switch (entry.flags) {
+        case kStatsVerticalSpeed:
+          s << "  Vy p50=" << FeetPerMinute(values[0], 0)
+            << "  p90=" << FeetPerMinute(values[1], 0)
+            << "  p99=" << FeetPerMinute(values[2], 0)
+            << "  in " << static_cast<size_t>(values[3]) << " landings";
+          break;
+        case kStatsGforce:
+          s << "  G p50=" << Quantity(values[0], "m/sec^2", 2)
+            << "  p90=" << Quantity(values[1], "m/sec^2", 2)
+            << "  p99=" << Quantity(values[2], "m/sec^2", 2);
+          break;
+        case kStatsGroundSpeed:
+          s << "  Vg p50=" << Knots(values[0], 0)
+            << "  p90=" << Knots(values[1], 0)
+            << "  p99=" << Knots(values[2], 0);
+          break;
+      }
+      break;
+    }
+  }
+}
+
+void LandingLog::ScrollBy(int rows) {
+  if (rows < 0) {
+    size_t back = static_cast<size_t>(-rows);
+    scroll_ = scroll_ > back ? scroll_ - back : 0;
+  } else {
+    size_t limit = size_ ? size_ - 1 : 0;
+    scroll_ = std::min(scroll_ + static_cast<size_t>(rows), limit);
+  }
+}
+
+}  // namespace xplmpp
@@ -0,0 +1,108 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Landing log.
+
+#ifndef LANDEX_LANDINGLOG_H
+#define LANDEX_LANDINGLOG_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "Common.h"
+#include "FlightLoopClient.h"
+#include "LandingStats.h"
+#include "TextFormat.h"
+
+namespace xplmpp {
+
+// Keeps the landing log as compact records in a ring, and formats them into
+// text only when asked, so that only the rows on screen are ever formatted.
+class LandingLog {
+public:
+  enum class EntryType : uint8_t {
+    message,
+    flying,
+    landed,
+    peak,
+    flare,
+    rollout,
+    approach,
+    history,
+    traffic,
+    runway,
+    stats,
+  };
+
+  struct Entry {
+    EntryType type;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t text;     // message sequence number for entries with text
+    float values[6];   // meaning depends on the type, SI units
+  };
+
+  explicit LandingLog(size_t capacity);
+  ~LandingLog() = default;
+
+  void AddMessage(const std::string& text);
+  void AddFlying(const FlyingInfo& info);
+  void AddLanded(const LandingInfo& info, bool classify);
+  void AddAnalysis(const LandingAnalysis& analysis);
+  void AddHistory(const std::string& aircraft, size_t count,
+                  float best_vertical_speed, float worst_vertical_speed);
+  void AddTraffic(int id, const std::string& aircraft, const LandingInfo& info);
+  void AddRunway(const std::string& airport, const std::string& runway,
+                 float distance, float offset);
+  void AddStats(const std::string& aircraft, const LandingSummary& summary);
+
+  void Clear();
+
+  // Entries, 0 being the oldest.
+  size_t size() const { return size_; }
+  const Entry& entry(size_t index) const;
+  void Format(size_t index, TextLine& text) const;
+
+  // Number of rows scrolled back from the latest entry. The view stays put
+  // while new entries come in unless it is at the latest one.
+  size_t scroll() const { return scroll_; }
+
+  // Scrolls back to the older entries for positive |rows|.
+  void ScrollBy(int rows);
+  void ScrollToEnd() { scroll_ = 0; }
+
+private:
+  Entry& Add(EntryType type);
+  uint32_t AddText(const std::string& text);
+  const std::string& GetText(uint32_t text) const;
+
+  std::vector<Entry> entries_;
+  size_t first_ = 0;
+  size_t size_ = 0;
+  size_t scroll_ = 0;
+
+  // Entries add one text at most, so with the same capacity the texts stay
+  // around as long as their entries
+  std::vector<std::string> texts_;
+  uint32_t text_count_ = 0;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_LANDINGLOG_H
@@ -0,0 +1,221 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Landing statistics per aircraft type implementation.
+
+#include "LandingStats.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <filesystem>
+#include <fstream>
+
+namespace xplmpp {
+
+// Stats file header, followed by the aircraft types, each being the type
+// designator and the non-empty buckets of its sketches.
+struct StatsHeader {
+  char magic[4];           // kStatsMagic
+  uint32_t version;        // kStatsVersion
+  uint32_t bucket_count;   // QuantileSketch::kBucketCount
+  uint32_t aircraft_count;
+};
+
+struct StatsBucket {
+  uint16_t index;
+  uint16_t reserved;
+  uint32_t count;
+};
+
+static_assert(sizeof(StatsHeader) == 16, "StatsHeader layout");
+static_assert(sizeof(StatsBucket) == 8, "StatsBucket layout");
+
+static const char kStatsMagic[4] = { 'L', 'X', 'S', 'T' };
+static const uint32_t kStatsVersion = 1;
+
+// Stats files are merged, so a bogus count must not run away with memory
+static const uint32_t kMaxAircraftCount = 4096;
+
+const float LandingSummary::kQuantiles[kQuantileCount] = { 0.5f, 0.9f, 0.99f };
+
+namespace {
+
+void WriteSketch(std::ofstream& file, const QuantileSketch& sketch) {
+  uint32_t count = 0;
+  for (int n = 0; n < QuantileSketch::kBucketCount; ++n)
+    count += !!sketch.bucket(n);
+  file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+  for (int n = 0; n < QuantileSketch::kBucketCount; ++n) {
+    if (!sketch.bucket(n))
+      continue;
+    StatsBucket bucket = { static_cast<uint16_t>(n), 0, sketch.bucket(n) };
+    file.write(reinterpret_cast<const char*>(&bucket), sizeof(bucket));
+  }
+}
+
+bool ReadSketch(std::ifstream& file, QuantileSketch& sketch) {
+  uint32_t count = 0;
+  if (!file.read(reinterpret_cast<char*>(&count), sizeof(count)) ||
+      count > QuantileSketch::kBucketCount)
+    return false;
+
+  for (uint32_t n = 0; n < count; ++n) {
+    StatsBucket bucket;
+    if (!file.read(reinterpret_cast<char*>(&bucket), sizeof(bucket)) ||
+        bucket.index >= QuantileSketch::kBucketCount)
+      return false;
+    sketch.AddToBucket(bucket.index, bucket.count);
+  }
+
+  return true;
+}
+
+}  // namespace
+
+bool LandingStats::Load(const std::string& filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open())
+    return false;
+
+  StatsHeader header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      memcmp(header.magic, kStatsMagic, sizeof(kStatsMagic)) ||
+      header.version != kStatsVersion ||
+      header.bucket_count != QuantileSketch::kBucketCount ||
+      header.aircraft_count > kMaxAircraftCount) {
+    LOG(WARNING) << "Invalid landing stats file '" << filename << "', ignored.";
+    return false;
+  }
+
+  // Read it all aside, so that a damaged file adds nothing
+  LandingStats stats;
+  for (uint32_t n = 0; n < header.aircraft_count; ++n) {
+    char aircraft[sizeof(AircraftStats::aircraft)];
+    if (!file.read(aircraft, sizeof(aircraft))) {
+      LOG(WARNING) << "Truncated landing stats file '" << filename << "', ignored.";
+      return false;
+    }
+
+    AircraftStats* entry = stats.FindOrAddAircraft(aircraft);
+    if (!ReadSketch(file, entry->vertical_speed) ||
+        !ReadSketch(file, entry->gforce) ||
+        !ReadSketch(file, entry->ground_speed)) {
+      LOG(WARNING) << "Invalid landing stats file '" << filename << "', ignored.";
+      return false;
+    }
+  }
+
+  Merge(stats);
+  return true;
+}
+
+bool LandingStats::Save(const std::string& filename) const {
+  StatsHeader header;
+  memcpy(header.magic, kStatsMagic, sizeof(kStatsMagic));
+  header.version = kStatsVersion;
+  header.bucket_count = QuantileSketch::kBucketCount;
+  header.aircraft_count = static_cast<uint32_t>(aircraft_.size());
+
+  // Write it aside and move it in place, so that the stats are never lost
+  // to a partly written file
+  std::string temp_filename = filename + ".tmp";
+  {
+    std::ofstream file(temp_filename, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const AircraftStats& stats : aircraft_) {
+      file.write(stats.aircraft, sizeof(stats.aircraft));
+      WriteSketch(file, stats.vertical_speed);
+      WriteSketch(file, stats.gforce);
+      WriteSketch(file, stats.ground_speed);
+    }
+    if (!file.good())
+      return false;
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(temp_filename, filename, ec);
+  return !ec;
+}
+
+void LandingStats::Add(const LandingRecord& record) {
+  AircraftStats* stats = FindOrAddAircraft(record.aircraft);
+  stats->vertical_speed.Add(fabsf(record.vertical_speed));
+  stats->gforce.Add(record.gforce);
+  stats->ground_speed.Add(record.ground_speed);
+  UpdateSummary(*stats);
+}
+
+void LandingStats::Merge(const LandingStats& other) {
+  for (const AircraftStats& other_stats : other.aircraft_) {
+    AircraftStats* stats = FindOrAddAircraft(other_stats.aircraft);
+    stats->vertical_speed.Merge(other_stats.vertical_speed);
+    stats->gforce.Merge(other_stats.gforce);
+    stats->ground_speed.Merge(other_stats.ground_speed);
+    UpdateSummary(*stats);
+  }
+}
+
+void LandingStats::Clear() {
+  aircraft_.clear();
+}
+
+bool LandingStats::GetSummary(const std::string& aircraft, LandingSummary& summary) const {
+  char key[sizeof(AircraftStats::aircraft)] = {};
+  strncpy(key, aircraft.c_str(), sizeof(key));
+
+  const AircraftStats* stats = FindAircraft(key);
+  if (!stats)
+    return false;
+
+  summary = stats->summary;
+  return true;
+}
+
+LandingStats::AircraftStats* LandingStats::FindOrAddAircraft(const char* aircraft) {
+  const AircraftStats* stats = FindAircraft(aircraft);
+  if (stats)
+    return const_cast<AircraftStats*>(stats);
+
+  aircraft_.emplace_back();
+  AircraftStats& new_stats = aircraft_.back();
+  memcpy(new_stats.aircraft, aircraft, sizeof(new_stats.aircraft));
+  return &new_stats;
+}
+
+const LandingStats::AircraftStats* LandingStats::FindAircraft(const char* aircraft) const {
+  for (const AircraftStats& stats : aircraft_) {
+    if (!memcmp(stats.aircraft, aircraft, sizeof(stats.aircraft)))
+      return &stats;
+  }
+  return nullptr;
+}
+
+void LandingStats::UpdateSummary(AircraftStats& stats) {
+  // A fixed number of buckets, however many landings
+  LandingSummary& summary = stats.summary;
+  summary.count = stats.vertical_speed.count();
+  stats.vertical_speed.GetQuantiles(LandingSummary::kQuantiles, LandingSummary::kQuantileCount,
+                                    summary.vertical_speed);
+  stats.gforce.GetQuantiles(LandingSummary::kQuantiles, LandingSummary::kQuantileCount,
+                            summary.gforce);
+  stats.ground_speed.GetQuantiles(LandingSummary::kQuantiles, LandingSummary::kQuantileCount,
+                                  summary.ground_speed);
+}
+
+}  // namespace xplmpp
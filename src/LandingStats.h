@@ -0,0 +1,85 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Landing statistics per aircraft type.
+
+#ifndef LANDEX_LANDINGSTATS_H
+#define LANDEX_LANDINGSTATS_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "Common.h"
+#include "LandingHistory.h"
+#include "QuantileSketch.h"
+
+namespace xplmpp {
+
+// Touchdown quantiles of an aircraft type, vertical speed as the descent
+// rate, all in SI units.
+struct LandingSummary {
+  static constexpr size_t kQuantileCount = 3;
+  static const float kQuantiles[kQuantileCount];  // p50, p90, p99
+
+  uint64_t count = 0;
+  float vertical_speed[kQuantileCount] = {};
+  float gforce[kQuantileCount] = {};
+  float ground_speed[kQuantileCount] = {};
+};
+
+// Keeps the distributions of the touchdown vertical speed, G and ground speed
+// of each aircraft type in quantile sketches, so that memory and the stats
+// file stay the same size however many landings there are. Stats loaded from
+// several files, e.g. from different installs, add up.
+class LandingStats {
+public:
+  LandingStats() = default;
+  ~LandingStats() = default;
+
+  // Adds the stats saved in |filename| to these.
+  bool Load(const std::string& filename);
+  bool Save(const std::string& filename) const;
+
+  void Add(const LandingRecord& record);
+  void Merge(const LandingStats& other);
+  void Clear();
+
+  bool empty() const { return aircraft_.empty(); }
+
+  bool GetSummary(const std::string& aircraft, LandingSummary& summary) const;
+
+private:
+  struct AircraftStats {
+    char aircraft[8];
+    QuantileSketch vertical_speed;
+    QuantileSketch gforce;
+    QuantileSketch ground_speed;
+    LandingSummary summary;
+  };
+
+  AircraftStats* FindOrAddAircraft(const char* aircraft);
+  const AircraftStats* FindAircraft(const char* aircraft) const;
+  static void UpdateSummary(AircraftStats& stats);
+
+  std::vector<AircraftStats> aircraft_;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_LANDINGSTATS_H
@@ -0,0 +1,72 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Landing statistics writer implementation.
+
+#include "LandingStatsWriter.h"
+
+#include <chrono>
+#include <memory>
+
+namespace xplmpp {
+
+static const auto kWriterIdleSleep = std::chrono::milliseconds(100);
+
+LandingStatsWriter::~LandingStatsWriter() {
+  Stop();
+}
+
+bool LandingStatsWriter::Start(const std::string& filename) {
+  if (is_running())
+    return true;
+
+  filename_ = filename;
+  stopping_ = false;
+  writer_thread_ = std::thread(&LandingStatsWriter::WriterThread, this);
+  return true;
+}
+
+void LandingStatsWriter::Stop() {
+  if (is_running()) {
+    stopping_ = true;
+    writer_thread_.join();
+  }
+
+  delete pending_.exchange(nullptr);
+}
+
+void LandingStatsWriter::WriterThread() {
+  // Runs on the writer thread, so it leaves the reporting to the caller
+  for (;;) {
+    // Check before taking the stats so that the last copy is written
+    bool stopping = stopping_;
+
+    std::unique_ptr<LandingStats> stats(pending_.exchange(nullptr));
+    if (stats) {
+      if (!stats->Save(filename_))
+        ++failures_;
+      continue;
+    }
+
+    if (stopping)
+      break;
+
+    std::this_thread::sleep_for(kWriterIdleSleep);
+  }
+}
+
+}  // namespace xplmpp
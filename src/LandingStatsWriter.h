@@ -0,0 +1,70 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Landing statistics writer.
+
+#ifndef LANDEX_LANDINGSTATSWRITER_H
+#define LANDEX_LANDINGSTATSWRITER_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "Common.h"
+#include "LandingStats.h"
+
+namespace xplmpp {
+
+// Saves the landing stats on a writer thread, so that the caller's thread
+// never waits on the file. Each Save() hands over a copy of the stats through
+// an atomic pointer, and only the latest copy is written if the writer falls
+// behind.
+class LandingStatsWriter {
+public:
+  LandingStatsWriter() = default;
+  ~LandingStatsWriter();
+
+  bool Start(const std::string& filename);
+
+  // Writes the copy still pending, if any, and stops.
+  void Stop();
+
+  bool is_running() const { return writer_thread_.joinable(); }
+
+  void Save(const LandingStats& stats) {
+    delete pending_.exchange(new LandingStats(stats));
+  }
+
+  // Returns the number of saves that failed since the previous call
+  unsigned TakeFailures() { return failures_.exchange(0); }
+
+  const std::string& filename() const { return filename_; }
+
+private:
+  void WriterThread();
+
+  std::string filename_;
+
+  std::thread writer_thread_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<LandingStats*> pending_{nullptr};
+  std::atomic<unsigned> failures_{0};
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_LANDINGSTATSWRITER_H
@@ -0,0 +1,301 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Memory mapped file implementation.
+
+#include "MappedFile.h"
+
+#if IBM
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace xplmpp {
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+#if IBM
+
+bool MappedFile::Open(const std::string& filename, size_t min_size) {
+  Close();
+
+  HANDLE file = ::CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    LOG(ERROR) << "Could not open '" << filename << "', error " << ::GetLastError();
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!::GetFileSizeEx(file, &size)) {
+    LOG(ERROR) << "Could not get the size of '" << filename << "'.";
+    ::CloseHandle(file);
+    return false;
+  }
+
+  filename_ = filename;
+  file_ = file;
+  size_ = static_cast<size_t>(size.QuadPart);
+
+  if (size_ < min_size)
+    return Resize(min_size);
+
+  if (!Map()) {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+bool MappedFile::OpenReadOnly(const std::string& filename) {
+  Close();
+
+  HANDLE file = ::CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    LOG(ERROR) << "Could not open '" << filename << "', error " << ::GetLastError();
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!::GetFileSizeEx(file, &size)) {
+    LOG(ERROR) << "Could not get the size of '" << filename << "'.";
+    ::CloseHandle(file);
+    return false;
+  }
+
+  filename_ = filename;
+  file_ = file;
+  size_ = static_cast<size_t>(size.QuadPart);
+  read_only_ = true;
+
+  if (!Map()) {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void MappedFile::Close() {
+  Unmap();
+
+  if (file_) {
+    ::CloseHandle(file_);
+    file_ = nullptr;
+  }
+
+  size_ = 0;
+  read_only_ = false;
+}
+
+bool MappedFile::Resize(size_t size) {
+  if (read_only_)
+    return false;
+
+  Unmap();
+
+  LARGE_INTEGER distance;
+  distance.QuadPart = size;
+  if (!::SetFilePointerEx(file_, distance, nullptr, FILE_BEGIN) ||
+      !::SetEndOfFile(file_)) {
+    LOG(ERROR) << "Could not resize '" << filename_ << "', error " << ::GetLastError();
+    Close();
+    return false;
+  }
+
+  size_ = size;
+  if (!Map()) {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+bool MappedFile::Flush() {
+  return data_ && !read_only_ && ::FlushViewOfFile(data_, 0);
+}
+
+bool MappedFile::Map() {
+  if (!size_)
+    return true;
+
+  mapping_ = ::CreateFileMappingA(file_, nullptr,
+                                  read_only_ ? PAGE_READONLY : PAGE_READWRITE,
+                                  0, 0, nullptr);
+  if (!mapping_) {
+    LOG(ERROR) << "Could not map '" << filename_ << "', error " << ::GetLastError();
+    return false;
+  }
+
+  data_ = static_cast<char*>(::MapViewOfFile(
+      mapping_, read_only_ ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS, 0, 0, 0));
+  if (!data_) {
+    LOG(ERROR) << "Could not map '" << filename_ << "', error " << ::GetLastError();
+    ::CloseHandle(mapping_);
+    mapping_ = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+void MappedFile::Unmap() {
+  if (data_) {
+    ::UnmapViewOfFile(data_);
+    data_ = nullptr;
+  }
+
+  if (mapping_) {
+    ::CloseHandle(mapping_);
+    mapping_ = nullptr;
+  }
+}
+
+#else  // #if IBM
+
+bool MappedFile::Open(const std::string& filename, size_t min_size) {
+  Close();
+
+  int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    LOG(ERROR) << "Could not open '" << filename << "', error " << errno;
+    return false;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    LOG(ERROR) << "Could not get the size of '" << filename << "'.";
+    ::close(fd);
+    return false;
+  }
+
+  filename_ = filename;
+  fd_ = fd;
+  size_ = static_cast<size_t>(st.st_size);
+
+  if (size_ < min_size)
+    return Resize(min_size);
+
+  if (!Map()) {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+bool MappedFile::OpenReadOnly(const std::string& filename) {
+  Close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "Could not open '" << filename << "', error " << errno;
+    return false;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    LOG(ERROR) << "Could not get the size of '" << filename << "'.";
+    ::close(fd);
+    return false;
+  }
+
+  filename_ = filename;
+  fd_ = fd;
+  size_ = static_cast<size_t>(st.st_size);
+  read_only_ = true;
+
+  if (!Map()) {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void MappedFile::Close() {
+  Unmap();
+
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+
+  size_ = 0;
+  read_only_ = false;
+}
+
+bool MappedFile::Resize(size_t size) {
+  if (read_only_)
+    return false;
+
+  Unmap();
+
+  if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+    LOG(ERROR) << "Could not resize '" << filename_ << "', error " << errno;
+    Close();
+    return false;
+  }
+
+  size_ = size;
+  if (!Map()) {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+bool MappedFile::Flush() {
+  return data_ && !read_only_ && ::msync(data_, size_, MS_ASYNC) == 0;
+}
+
+bool MappedFile::Map() {
+  if (!size_)
+    return true;
+
+  void* data = ::mmap(nullptr, size_, read_only_ ? PROT_READ : PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd_, 0);
+  if (data == MAP_FAILED) {
+    LOG(ERROR) << "Could not map '" << filename_ << "', error " << errno;
+    return false;
+  }
+
+  data_ = static_cast<char*>(data);
+  return true;
+}
+
+void MappedFile::Unmap() {
+  if (data_) {
+    ::munmap(data_, size_);
+    data_ = nullptr;
+  }
+}
+
+#endif  // #if IBM
+
+}  // namespace xplmpp
@@ -0,0 +1,83 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Memory mapped file.
+
+#ifndef LANDEX_MAPPEDFILE_H
+#define LANDEX_MAPPEDFILE_H
+
+#include <string>
+
+#include "Common.h"
+
+namespace xplmpp {
+
+// Represents a file mapped into memory for reading and writing, or just for
+// reading. The mapping covers the whole file and moves when the file is
+// resized, so pointers into data() do not survive Resize().
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Opens or creates |filename|, growing it to at least |min_size| bytes.
+  bool Open(const std::string& filename, size_t min_size);
+
+  // Opens an existing |filename| for reading only, data() must not be
+  // written to and the file cannot be resized.
+  bool OpenReadOnly(const std::string& filename);
+
+  void Close();
+
+  bool is_open() const { return data_ != nullptr; }
+  bool is_read_only() const { return read_only_; }
+
+  // Grows or shrinks the file and remaps it.
+  bool Resize(size_t size);
+
+  // Schedules the changes to be written to disk, does not wait for it.
+  bool Flush();
+
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  const std::string& filename() const { return filename_; }
+
+private:
+  bool Map();
+  void Unmap();
+
+  std::string filename_;
+
+#if IBM
+  void* file_ = nullptr;     // HANDLE
+  void* mapping_ = nullptr;  // HANDLE
+#else
+  int fd_ = -1;
+#endif
+
+  char* data_ = nullptr;
+  size_t size_ = 0;
+  bool read_only_ = false;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_MAPPEDFILE_H
@@ -0,0 +1,90 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Streaming quantile sketch implementation.
+
+#include "QuantileSketch.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace xplmpp {
+
+static const float kLogGrowth = logf(QuantileSketch::kGrowth);
+
+void QuantileSketch::Add(float value) {
+  // Bucket n > 0 holds the values in (min * growth^(n-1), min * growth^n]
+  int index = 0;
+  if (value > kMinValue)
+    index = std::min(static_cast<int>(ceilf(logf(value / kMinValue) / kLogGrowth)),
+                     kBucketCount - 1);
+  ++buckets_[index];
+  ++count_;
+}
+
+void QuantileSketch::Merge(const QuantileSketch& other) {
+  for (int n = 0; n < kBucketCount; ++n)
+    buckets_[n] += other.buckets_[n];
+  count_ += other.count_;
+}
+
+void QuantileSketch::Clear() {
+  count_ = 0;
+  memset(buckets_, 0, sizeof(buckets_));
+}
+
+void QuantileSketch::AddToBucket(int index, uint32_t count) {
+  assert(index >= 0 && index < kBucketCount);
+  buckets_[index] += count;
+  count_ += count;
+}
+
+float QuantileSketch::GetBucketValue(int index) const {
+  // The value within 1% of both ends of the bucket
+  if (!index)
+    return 0;
+  return kMinValue * powf(kGrowth, static_cast<float>(index)) * 2.0f / (kGrowth + 1.0f);
+}
+
+void QuantileSketch::GetQuantiles(const float* quantiles, size_t quantile_count,
+                                  float* values) const {
+  if (!count_) {
+    std::fill(values, values + quantile_count, 0.0f);
+    return;
+  }
+
+  size_t q = 0;
+  uint64_t seen = 0;
+  for (int n = 0; n < kBucketCount && q < quantile_count; ++n) {
+    seen += buckets_[n];
+    while (q < quantile_count && seen > quantiles[q] * (count_ - 1))
+      values[q++] = GetBucketValue(n);
+  }
+
+  for (; q < quantile_count; ++q)
+    values[q] = GetBucketValue(kBucketCount - 1);
+}
+
+float QuantileSketch::GetQuantile(float quantile) const {
+  float value;
+  GetQuantiles(&quantile, 1, &value);
+  return value;
+}
+
+}  // namespace xplmpp
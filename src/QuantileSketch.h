@@ -0,0 +1,68 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Streaming quantile sketch.
+
+#ifndef LANDEX_QUANTILESKETCH_H
+#define LANDEX_QUANTILESKETCH_H
+
+#include <stdint.h>
+
+#include "Common.h"
+
+namespace xplmpp {
+
+// Estimates the quantiles of a stream of non-negative values to within 1% of
+// the value, in a fixed amount of memory. Values are counted in buckets
+// growing by 2% each, so adding a value is a logarithm and an increment, and
+// merging two sketches adds up their buckets.
+class QuantileSketch {
+public:
+  // Covers 0.01 to over 10000 in any units, smaller values are counted in
+  // the first bucket and larger ones in the last.
+  static constexpr int kBucketCount = 704;
+  static constexpr float kMinValue = 0.01f;
+  static constexpr float kGrowth = 1.02f;
+
+  QuantileSketch() { Clear(); }
+
+  void Add(float value);
+  void Merge(const QuantileSketch& other);
+  void Clear();
+
+  uint64_t count() const { return count_; }
+  bool empty() const { return !count_; }
+
+  // Returns the value at |quantiles|, each in the range [0, 1] and in the
+  // increasing order, in a single pass over the buckets.
+  void GetQuantiles(const float* quantiles, size_t quantile_count, float* values) const;
+  float GetQuantile(float quantile) const;
+
+  // Bucket access for the persistence
+  uint32_t bucket(int index) const { return buckets_[index]; }
+  void AddToBucket(int index, uint32_t count);
+
+private:
+  float GetBucketValue(int index) const;
+
+  uint64_t count_;
+  uint32_t buckets_[kBucketCount];
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_QUANTILESKETCH_H
@@ -0,0 +1,491 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Runway database implementation.
+
+#include "RunwayDatabase.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
+
+#include "FlightMath.h"
+
+namespace xplmpp {
+
+namespace {
+
+// Cache file header, followed by the index of the cells and the runway ends
+// sorted by the cell.
+struct RunwayCacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t record_size;
+  uint64_t count;
+  uint64_t source_size;  // apt.dat the cache was built from
+  int64_t source_time;
+  uint32_t cell_count;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(RunwayCacheHeader) == 48, "RunwayCacheHeader layout");
+
+}  // namespace
+
+static const char kCacheMagic[4] = { 'L', 'X', 'R', 'W' };
+static const uint32_t kCacheVersion = 1;
+
+// One degree cells, the index holds the first runway end of each cell and
+// one past the last cell
+static const int kCellRows = 180;
+static const int kCellColumns = 360;
+static const size_t kCellCount = kCellRows * kCellColumns;
+static const size_t kIndexOffset = sizeof(RunwayCacheHeader);
+static const size_t kRunwaysOffset =
+    (kIndexOffset + (kCellCount + 1) * sizeof(uint32_t) + 7) & ~size_t(7);
+
+// apt.dat row codes
+static const int kLandAirportRow = 1;
+static const int kSeaplaneBaseRow = 16;
+static const int kHeliportRow = 17;
+static const int kLandRunwayRow = 100;
+
+// Land runway row fields
+static const size_t kRunwayWidthField = 1;
+static const size_t kRunwayEndFields[2] = { 8, 17 };
+static const size_t kRunwayFieldCount = 26;
+
+// Chunks smaller than that are not worth another thread
+static const size_t kMinChunkSize = 4 << 20;
+
+// Runway matching
+static const float kMaxHeadingDelta = 30.0f;      // degrees
+static const float kMaxShortOfThreshold = 300.0f;  // meters
+static const float kCenterlineMargin = 15.0f;     // meters past the runway edge
+static const double kMaxRunwayDegrees = 0.1;      // longer than any runway
+
+namespace {
+
+size_t GetCell(double lat, double lon) {
+  int row = std::min(std::max(static_cast<int>(floor(lat)) + kCellRows / 2, 0), kCellRows - 1);
+  int column = (static_cast<int>(floor(lon)) + kCellColumns / 2) % kCellColumns;
+  if (column < 0)
+    column += kCellColumns;
+  return static_cast<size_t>(row) * kCellColumns + column;
+}
+
+void CopyField(absl::string_view field, char* dst, size_t size) {
+  memset(dst, 0, size);
+  memcpy(dst, field.data(), std::min(field.size(), size));
+}
+
+// Splits |line| into up to |max_count| whitespace separated fields.
+size_t SplitFields(absl::string_view line, absl::string_view* fields, size_t max_count) {
+  size_t count = 0;
+  size_t pos = 0;
+  while (count < max_count) {
+    while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t' || line[pos] == '\r'))
+      ++pos;
+    if (pos == line.size())
+      break;
+    size_t begin = pos;
+    while (pos < line.size() && line[pos] != ' ' && line[pos] != '\t' && line[pos] != '\r')
+      ++pos;
+    fields[count++] = line.substr(begin, pos - begin);
+  }
+  return count;
+}
+
+int GetRowCode(absl::string_view line) {
+  int code = 0;
+  size_t pos = 0;
+  for (; pos < line.size() && line[pos] >= '0' && line[pos] <= '9'; ++pos)
+    code = code * 10 + (line[pos] - '0');
+  if (!pos || (pos < line.size() && line[pos] != ' ' && line[pos] != '\t'))
+    return -1;
+  return code;
+}
+
+bool IsAirportRow(int code) {
+  return code == kLandAirportRow || code == kSeaplaneBaseRow || code == kHeliportRow;
+}
+
+// Makes the runway ends of a land runway row, one for each direction.
+bool AddRunway(const char* airport, const absl::string_view* fields,
+               std::vector<RunwayEnd>& runways) {
+  float width;
+  double lat[2], lon[2];
+  float displaced[2];
+  if (!absl::SimpleAtof(fields[kRunwayWidthField], &width))
+    return false;
+  for (int n = 0; n < 2; ++n) {
+    const absl::string_view* end = fields + kRunwayEndFields[n];
+    if (!absl::SimpleAtod(end[1], &lat[n]) ||
+        !absl::SimpleAtod(end[2], &lon[n]) ||
+        !absl::SimpleAtof(end[3], &displaced[n]))
+      return false;
+  }
+
+  // Toward the opposite end, north and east of this one
+  for (int n = 0; n < 2; ++n) {
+    int other = 1 - n;
+    float north, east;
+    RunwayFrame(lat[n], lon[n], 0.0f).Project(lat[other], lon[other], &north, &east);
+    float length = sqrtf(north * north + east * east);
+    if (length <= displaced[n])
+      continue;
+
+    RunwayEnd runway;
+    memset(&runway, 0, sizeof(runway));
+    memcpy(runway.airport, airport, sizeof(runway.airport));
+    CopyField(fields[kRunwayEndFields[n]], runway.runway, sizeof(runway.runway));
+    runway.heading = static_cast<float>(atan2(east, north) * 180.0 / M_PI);
+    if (runway.heading < 0)
+      runway.heading += 360.0f;
+
+    // Landing starts past the displaced threshold
+    double t = displaced[n] / length;
+    runway.lat = lat[n] + t * (lat[other] - lat[n]);
+    runway.lon = lon[n] + t * (lon[other] - lon[n]);
+    runway.length = length - displaced[n];
+    runway.width = width;
+    runway.displaced = displaced[n];
+    runways.push_back(runway);
+  }
+
+  return true;
+}
+
+void ParseChunk(const char* p, const char* end, std::vector<RunwayEnd>& runways,
+                const std::atomic<bool>* stopping) {
+  char airport[sizeof(RunwayEnd::airport)] = {};
+  bool land_airport = false;
+  absl::string_view fields[kRunwayFieldCount];
+
+  size_t line_count = 0;
+  while (p < end) {
+    const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+    if (!eol)
+      eol = end;
+    absl::string_view line(p, eol - p);
+    p = eol < end ? eol + 1 : end;
+
+    if ((++line_count & 0xFFFF) == 0 && stopping && *stopping)
+      return;
+
+    // Most rows are taxiways, signs and such, so the row code is looked at
+    // before splitting the fields
+    int code = GetRowCode(line);
+    if (IsAirportRow(code)) {
+      land_airport = code == kLandAirportRow;
+      if (SplitFields(line, fields, 5) == 5) {
+        CopyField(fields[4], airport, sizeof(airport));
+      } else {
+        land_airport = false;
+      }
+    } else
+    if (code == kLandRunwayRow && land_airport) {
+      if (SplitFields(line, fields, kRunwayFieldCount) == kRunwayFieldCount)
+        AddRunway(airport, fields, runways);
+    }
+  }
+}
+
+// Returns the offset of the first airport row at or past |offset|.
+size_t FindAirportRow(const char* data, size_t size, size_t offset) {
+  const char* p = data + offset;
+  const char* end = data + size;
+  while (p < end) {
+    const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+    if (!eol)
+      break;
+    p = eol + 1;
+    if (IsAirportRow(GetRowCode(absl::string_view(p, std::min<size_t>(end - p, 4)))))
+      return p - data;
+  }
+  return size;
+}
+
+bool GetFileTime(const std::string& filename, uint64_t& size, int64_t& time) {
+  std::error_code ec;
+  std::filesystem::path path(filename);
+  size = std::filesystem::file_size(path, ec);
+  if (ec)
+    return false;
+  time = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+  return !ec;
+}
+
+}  // namespace
+
+std::string RunwayEnd::airport_code() const {
+  return std::string(airport, strnlen(airport, sizeof(airport)));
+}
+
+std::string RunwayEnd::runway_number() const {
+  return std::string(runway, strnlen(runway, sizeof(runway)));
+}
+
+RunwayDatabase::~RunwayDatabase() {
+  Close();
+}
+
+bool RunwayDatabase::Open(const std::string& apt_dat_filename,
+                          const std::string& cache_filename) {
+  Close();
+
+  apt_dat_filename_ = apt_dat_filename;
+  cache_filename_ = cache_filename;
+  if (!GetFileTime(apt_dat_filename_, source_size_, source_time_)) {
+    LOG(WARNING) << "Could not find '" << apt_dat_filename_ << "', runways are not known.";
+    return false;
+  }
+
+  if (LoadCache())
+    return true;
+
+  LOG(INFO) << "Building the runway cache from '" << apt_dat_filename_ << "'.";
+  if (!apt_dat_.OpenReadOnly(apt_dat_filename_))
+    return false;
+
+  unsigned thread_count = std::min(std::max(std::thread::hardware_concurrency(), 1u), 8u);
+  stopping_ = false;
+  build_done_ = false;
+  build_thread_ = std::thread(&RunwayDatabase::BuildCache, this, thread_count);
+  return true;
+}
+
+void RunwayDatabase::Close() {
+  if (build_thread_.joinable()) {
+    stopping_ = true;
+    build_thread_.join();
+  }
+
+  apt_dat_.Close();
+  cache_.Close();
+}
+
+void RunwayDatabase::BuildCache(unsigned thread_count) {
+  // Runs on the build thread, so it leaves the logging to Update()
+  std::vector<RunwayEnd> runways;
+  Parse(apt_dat_.data(), apt_dat_.size(), thread_count, runways, &stopping_);
+  build_count_ = runways.size();
+  build_ok_ = !stopping_ &&
+      WriteCache(cache_filename_, std::move(runways), source_size_, source_time_);
+  build_done_ = true;
+}
+
+void RunwayDatabase::Update() {
+  if (!build_thread_.joinable() || !build_done_)
+    return;
+
+  build_thread_.join();
+  apt_dat_.Close();
+
+  if (!build_ok_) {
+    LOG(WARNING) << "Could not write the runway cache '" << cache_filename_ << "'.";
+    return;
+  }
+
+  LOG(INFO) << "Found " << build_count_ << " runway ends.";
+  LoadCache();
+}
+
+bool RunwayDatabase::LoadCache() {
+  std::error_code ec;
+  if (!std::filesystem::exists(cache_filename_, ec))
+    return false;
+
+  if (!cache_.OpenReadOnly(cache_filename_))
+    return false;
+
+  const RunwayCacheHeader* header =
+      reinterpret_cast<const RunwayCacheHeader*>(cache_.data());
+  if (cache_.size() < kRunwaysOffset ||
+      memcmp(header->magic, kCacheMagic, sizeof(kCacheMagic)) ||
+      header->version != kCacheVersion ||
+      header->header_size != sizeof(RunwayCacheHeader) ||
+      header->record_size != sizeof(RunwayEnd) ||
+      header->cell_count != kCellCount ||
+      cache_.size() != kRunwaysOffset + header->count * sizeof(RunwayEnd) ||
+      cell_index()[kCellCount] != header->count) {
+    LOG(WARNING) << "Invalid runway cache '" << cache_filename_ << "', rebuilding.";
+    cache_.Close();
+    return false;
+  }
+
+  if (header->source_size != source_size_ || header->source_time != source_time_) {
+    cache_.Close();
+    return false;
+  }
+
+  return true;
+}
+
+size_t RunwayDatabase::size() const {
+  if (!is_ready())
+    return 0;
+  return static_cast<size_t>(
+      reinterpret_cast<const RunwayCacheHeader*>(cache_.data())->count);
+}
+
+const RunwayEnd& RunwayDatabase::runway(size_t index) const {
+  assert(index < size());
+  return runways()[index];
+}
+
+const uint32_t* RunwayDatabase::cell_index() const {
+  return reinterpret_cast<const uint32_t*>(cache_.data() + kIndexOffset);
+}
+
+const RunwayEnd* RunwayDatabase::runways() const {
+  return reinterpret_cast<const RunwayEnd*>(cache_.data() + kRunwaysOffset);
+}
+
+bool RunwayDatabase::FindRunway(double lat, double lon, float heading,
+                                RunwayMatch& match) const {
+  match = RunwayMatch();
+  if (!is_ready())
+    return false;
+
+  const uint32_t* index = cell_index();
+  const RunwayEnd* runways = this->runways();
+  double max_lon_delta = kMaxRunwayDegrees / std::max(cos(DegreeToRadian(lat)), 0.01);
+
+  // A runway starting in the next cell can still reach the aircraft
+  size_t cell = GetCell(lat, lon);
+  int row = static_cast<int>(cell / kCellColumns);
+  int column = static_cast<int>(cell % kCellColumns);
+  for (int r = std::max(row - 1, 0); r <= std::min(row + 1, kCellRows - 1); ++r) {
+    for (int c = column - 1; c <= column + 1; ++c) {
+      size_t neighbor = r * kCellColumns + (c + kCellColumns) % kCellColumns;
+      for (uint32_t n = index[neighbor]; n < index[neighbor + 1]; ++n) {
+        const RunwayEnd& runway = runways[n];
+        if (fabs(runway.lat - lat) > kMaxRunwayDegrees)
+          continue;
+        double lon_delta = fabs(runway.lon - lon);
+        if (std::min(lon_delta, 360.0 - lon_delta) > max_lon_delta)
+          continue;
+
+        float heading_delta = fabsf(fmodf(heading - runway.heading + 540.0f, 360.0f) - 180.0f);
+        if (heading_delta > kMaxHeadingDelta)
+          continue;
+
+        float along, cross;
+        RunwayFrame(runway.lat, runway.lon, runway.heading).Project(lat, lon, &along, &cross);
+        if (along < -kMaxShortOfThreshold || along > runway.length ||
+            fabsf(cross) > runway.width / 2 + kCenterlineMargin)
+          continue;
+
+        // Closest to the centerline wins among the parallel runways
+        if (!match.runway || fabsf(cross) < fabsf(match.offset)) {
+          match.runway = &runway;
+          match.distance = along;
+          match.offset = cross;
+        }
+      }
+    }
+  }
+
+  return match.runway != nullptr;
+}
+
+void RunwayDatabase::Parse(const char* data, size_t size, unsigned thread_count,
+                           std::vector<RunwayEnd>& runways,
+                           const std::atomic<bool>* stopping) {
+  runways.clear();
+  if (!data || !size)
+    return;
+
+  // Split at airport rows, so that each chunk knows whose runways it has
+  size_t chunk_count = std::max<size_t>(
+      std::min<size_t>(thread_count, size / kMinChunkSize + 1), 1);
+  std::vector<size_t> bounds(chunk_count + 1, size);
+  bounds[0] = 0;
+  for (size_t n = 1; n < chunk_count; ++n)
+    bounds[n] = FindAirportRow(data, size, std::max(size * n / chunk_count, bounds[n - 1]));
+
+  std::vector<std::vector<RunwayEnd>> chunks(chunk_count);
+  std::vector<std::thread> threads;
+  for (size_t n = 1; n < chunk_count; ++n) {
+    threads.emplace_back(ParseChunk, data + bounds[n], data + bounds[n + 1],
+                         std::ref(chunks[n]), stopping);
+  }
+  ParseChunk(data + bounds[0], data + bounds[1], chunks[0], stopping);
+  for (std::thread& thread : threads)
+    thread.join();
+
+  size_t count = 0;
+  for (const std::vector<RunwayEnd>& chunk : chunks)
+    count += chunk.size();
+  runways.reserve(count);
+  for (const std::vector<RunwayEnd>& chunk : chunks)
+    runways.insert(runways.end(), chunk.begin(), chunk.end());
+}
+
+bool RunwayDatabase::WriteCache(const std::string& filename, std::vector<RunwayEnd> runways,
+                                uint64_t source_size, int64_t source_time) {
+  // Sort the runway ends into the cells, keeping the file order in a cell
+  std::vector<uint32_t> index(kCellCount + 1, 0);
+  for (const RunwayEnd& runway : runways)
+    ++index[GetCell(runway.lat, runway.lon) + 1];
+  for (size_t n = 1; n <= kCellCount; ++n)
+    index[n] += index[n - 1];
+
+  std::vector<RunwayEnd> sorted(runways.size());
+  std::vector<uint32_t> next(index.begin(), index.end() - 1);
+  for (const RunwayEnd& runway : runways)
+    sorted[next[GetCell(runway.lat, runway.lon)]++] = runway;
+
+  RunwayCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+  header.version = kCacheVersion;
+  header.header_size = sizeof(RunwayCacheHeader);
+  header.record_size = sizeof(RunwayEnd);
+  header.count = sorted.size();
+  header.source_size = source_size;
+  header.source_time = source_time;
+  header.cell_count = kCellCount;
+
+  // Write it aside and move it in place, so that a partly written cache is
+  // never picked up
+  std::string temp_filename = filename + ".tmp";
+  {
+    std::ofstream file(temp_filename, std::ios::binary | std::ios::trunc);
+    static const char padding[8] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(uint32_t));
+    file.write(padding, kRunwaysOffset - kIndexOffset - index.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(sorted.data()), sorted.size() * sizeof(RunwayEnd));
+    if (!file.good())
+      return false;
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(temp_filename, filename, ec);
+  return !ec;
+}
+
+}  // namespace xplmpp
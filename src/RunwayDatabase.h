@@ -0,0 +1,126 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Runway database.
+
+#ifndef LANDEX_RUNWAYDATABASE_H
+#define LANDEX_RUNWAYDATABASE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Common.h"
+#include "MappedFile.h"
+
+namespace xplmpp {
+
+// Runway end, one for each direction a runway can be landed in.
+struct RunwayEnd {
+  char airport[8];   // airport code, zero padded
+  char runway[4];    // runway number, e.g. "09L", zero padded
+  float heading;     // true heading toward the opposite end, degrees
+  double lat;        // landing threshold, past any displaced threshold
+  double lon;
+  float length;      // meters from the landing threshold to the opposite end
+  float width;       // meters
+  float displaced;   // displaced threshold, meters
+  float reserved;
+
+  std::string airport_code() const;
+  std::string runway_number() const;
+};
+
+static_assert(sizeof(RunwayEnd) == 48, "RunwayEnd layout");
+
+// Where a landing happened on a runway.
+struct RunwayMatch {
+  const RunwayEnd* runway = nullptr;
+  float distance = 0;  // meters past the landing threshold
+  float offset = 0;    // meters off the centerline, positive to the right
+};
+
+// Finds the runway a landing was made on. The runways are read from the
+// sim's apt.dat once and kept in a cache file next to the settings, sorted
+// into one degree cells with an index of the cells, and mapped into memory.
+// Starting with the cache up to date takes no parsing at all, otherwise the
+// cache is built on a background thread and the database is ready once
+// Update() picks it up.
+class RunwayDatabase {
+public:
+  RunwayDatabase() = default;
+  ~RunwayDatabase();
+
+  // Loads the cache, or starts building it when it is missing or older
+  // than |apt_dat_filename|.
+  bool Open(const std::string& apt_dat_filename, const std::string& cache_filename);
+  void Close();
+
+  // Picks up the cache built in the background, if any. Must be called on
+  // the thread that called Open().
+  void Update();
+
+  bool is_ready() const { return cache_.is_open(); }
+  bool is_building() const { return build_thread_.joinable(); }
+
+  size_t size() const;
+  const RunwayEnd& runway(size_t index) const;
+
+  // Finds the runway end that the aircraft at |lat|, |lon| heading |heading|
+  // is on, or about to land on.
+  bool FindRunway(double lat, double lon, float heading, RunwayMatch& match) const;
+
+  // Parses the land runways out of apt.dat contents on |thread_count|
+  // threads, in file order. Stops early when |stopping| gets set.
+  static void Parse(const char* data, size_t size, unsigned thread_count,
+                    std::vector<RunwayEnd>& runways,
+                    const std::atomic<bool>* stopping = nullptr);
+
+  // Writes the cache of |runways|, built from a source file of
+  // |source_size| bytes last written at |source_time|.
+  static bool WriteCache(const std::string& filename, std::vector<RunwayEnd> runways,
+                         uint64_t source_size, int64_t source_time);
+
+private:
+  bool LoadCache();
+  void BuildCache(unsigned thread_count);
+
+  const uint32_t* cell_index() const;
+  const RunwayEnd* runways() const;
+
+  std::string apt_dat_filename_;
+  std::string cache_filename_;
+  uint64_t source_size_ = 0;
+  int64_t source_time_ = 0;
+
+  MappedFile cache_;
+
+  // Background build
+  MappedFile apt_dat_;
+  std::thread build_thread_;
+  std::atomic<bool> build_done_{false};
+  std::atomic<bool> stopping_{false};
+  bool build_ok_ = false;
+  size_t build_count_ = 0;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_RUNWAYDATABASE_H
@@ -0,0 +1,308 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Flight data session export implementation.
+
+#include "SessionExporter.h"
+
+#include <string.h>
+#if !IBM
+#include <sys/types.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace xplmpp {
+
+// Copying a chunk takes well under a millisecond
+static const size_t kChunkRows = 8192;
+static const size_t kChunkCount = 4;
+static const size_t kColumnAlignment = 64;
+static const auto kWriterIdleSleep = std::chrono::milliseconds(10);
+
+// Exported columns, in SI units and degrees
+static const struct {
+  const char* name;
+  SessionExportColumn::Type type;
+  uint32_t value_size;
+} kColumns[] = {
+  { "time", SessionExportColumn::kFloat32, sizeof(float) },
+  { "ground_speed", SessionExportColumn::kFloat32, sizeof(float) },
+  { "vertical_speed", SessionExportColumn::kFloat32, sizeof(float) },
+  { "agl", SessionExportColumn::kFloat32, sizeof(float) },
+  { "msl", SessionExportColumn::kFloat32, sizeof(float) },
+  { "lat", SessionExportColumn::kFloat64, sizeof(double) },
+  { "lon", SessionExportColumn::kFloat64, sizeof(double) },
+  { "heading", SessionExportColumn::kFloat32, sizeof(float) },
+  { "flying", SessionExportColumn::kUInt8, sizeof(uint8_t) },
+};
+
+static const size_t kColumnCount = numbof(kColumns);
+
+// Sessions of a few hours run past the 2 GB a long can seek on Windows
+static bool SeekFile(FILE* file, uint64_t offset) {
+#if IBM
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+// Chunk of rows, laid out as the columns of kChunkRows each
+struct SessionExporter::Chunk {
+  size_t first_row = 0;
+  size_t row_count = 0;
+  std::vector<uint8_t> data;
+};
+
+namespace {
+
+size_t Align(size_t offset) {
+  return (offset + kColumnAlignment - 1) & ~(kColumnAlignment - 1);
+}
+
+// Returns the offset of |column| in a chunk.
+size_t GetChunkOffset(size_t column) {
+  size_t offset = 0;
+  for (size_t n = 0; n < column; ++n)
+    offset += kChunkRows * kColumns[n].value_size;
+  return offset;
+}
+
+// Returns the offset of |column| in the file holding |row_count| rows.
+size_t GetFileOffset(size_t column, size_t row_count) {
+  size_t offset = Align(sizeof(SessionExportHeader) +
+                        kColumnCount * sizeof(SessionExportColumn));
+  for (size_t n = 0; n < column; ++n)
+    offset = Align(offset + row_count * kColumns[n].value_size);
+  return offset;
+}
+
+template <typename T>
+T* GetColumn(std::vector<uint8_t>& data, size_t column) {
+  return reinterpret_cast<T*>(&data[GetChunkOffset(column)]);
+}
+
+}  // namespace
+
+SessionExporter::SessionExporter()
+: chunks_(kChunkCount)
+, filled_(kChunkCount)
+, free_(kChunkCount) {
+  size_t chunk_size = GetChunkOffset(kColumnCount);
+  for (Chunk& chunk : chunks_)
+    chunk.data.resize(chunk_size);
+}
+
+SessionExporter::~SessionExporter() {
+  Stop();
+}
+
+bool SessionExporter::Start(const std::string& filename, const FlightData& data) {
+  if (is_exporting())
+    return false;
+
+  filename_ = filename;
+  ok_ = false;
+  row_count_ = 0;
+
+  generation_ = data.generation();
+  begin_sequence_ = data.first_sequence();
+  end_sequence_ = data.end_sequence();
+  next_sequence_ = begin_sequence_;
+  copy_done_ = false;
+
+  // Every chunk is free again, whatever an abandoned export left behind
+  Chunk* chunk;
+  while (filled_.TryPop(chunk)) {}
+  while (free_.TryPop(chunk)) {}
+  for (Chunk& chunk : chunks_)
+    free_.TryPush(&chunk);
+
+  copy_complete_ = false;
+  write_done_ = false;
+  stopping_ = false;
+  write_ok_ = false;
+  written_row_count_ = 0;
+  writer_thread_ = std::thread(&SessionExporter::WriterThread, this);
+  return true;
+}
+
+bool SessionExporter::Update(const FlightData& data) {
+  if (!is_exporting())
+    return false;
+
+  if (!copy_done_) {
+    if (data.generation() != generation_ || next_sequence_ < data.first_sequence()) {
+      // Reset or dropped before being copied, the rest is gone
+      copy_done_ = true;
+    } else {
+      Chunk* chunk;
+      if (next_sequence_ < end_sequence_ && free_.TryPop(chunk)) {
+        CopyChunk(data, *chunk);
+        next_sequence_ += chunk->row_count;
+        filled_.TryPush(chunk);
+      }
+      copy_done_ = next_sequence_ == end_sequence_;
+    }
+
+    if (copy_done_)
+      copy_complete_ = true;
+  }
+
+  if (!write_done_)
+    return false;
+
+  writer_thread_.join();
+  ok_ = write_ok_;
+  row_count_ = written_row_count_;
+  return true;
+}
+
+void SessionExporter::Stop() {
+  if (!is_exporting())
+    return;
+
+  stopping_ = true;
+  writer_thread_.join();
+}
+
+void SessionExporter::CopyChunk(const FlightData& data, Chunk& chunk) const {
+  chunk.first_row = next_sequence_ - begin_sequence_;
+  chunk.row_count = std::min(kChunkRows, end_sequence_ - next_sequence_);
+
+  // Column by column, each being a straight run through the flight data
+  size_t begin = next_sequence_ - data.first_sequence();
+  size_t end = begin + chunk.row_count;
+
+  float* time = GetColumn<float>(chunk.data, 0);
+  for (size_t index = begin; index < end; ++index)
+    *time++ = data.time(index);
+  float* ground_speed = GetColumn<float>(chunk.data, 1);
+  for (size_t index = begin; index < end; ++index)
+    *ground_speed++ = data.ground_speed(index);
+  float* vertical_speed = GetColumn<float>(chunk.data, 2);
+  for (size_t index = begin; index < end; ++index)
+    *vertical_speed++ = data.vertical_speed(index);
+  float* agl = GetColumn<float>(chunk.data, 3);
+  for (size_t index = begin; index < end; ++index)
+    *agl++ = data.agl(index);
+  float* msl = GetColumn<float>(chunk.data, 4);
+  for (size_t index = begin; index < end; ++index)
+    *msl++ = data.msl(index);
+  double* lat = GetColumn<double>(chunk.data, 5);
+  for (size_t index = begin; index < end; ++index)
+    *lat++ = data.lat(index);
+  double* lon = GetColumn<double>(chunk.data, 6);
+  for (size_t index = begin; index < end; ++index)
+    *lon++ = data.lon(index);
+  float* heading = GetColumn<float>(chunk.data, 7);
+  for (size_t index = begin; index < end; ++index)
+    *heading++ = data.heading(index);
+  uint8_t* flying = GetColumn<uint8_t>(chunk.data, 8);
+  for (size_t index = begin; index < end; ++index)
+    *flying++ = data.flying(index) ? 1 : 0;
+}
+
+void SessionExporter::WriterThread() {
+  // Runs on the writer thread, so it leaves the reporting to Update()
+  std::string temp_filename = filename_ + ".tmp";
+  FILE* file = fopen(temp_filename.c_str(), "wb");
+  bool ok = file && WriteHeader(file, 0);
+
+  size_t row_count = 0;
+  for (;;) {
+    // Check before draining so that nothing copied is left behind
+    bool complete = copy_complete_;
+
+    Chunk* chunk;
+    bool popped = false;
+    while (filled_.TryPop(chunk)) {
+      popped = true;
+      if (ok)
+        ok = WriteChunk(file, *chunk);
+      row_count += chunk->row_count;
+      free_.TryPush(chunk);
+    }
+
+    if (complete || stopping_)
+      break;
+
+    if (!popped)
+      std::this_thread::sleep_for(kWriterIdleSleep);
+  }
+
+  ok = ok && !stopping_ && WriteHeader(file, row_count);
+  if (file)
+    ok = fclose(file) == 0 && ok;
+
+  // Replace any earlier export of the same name only when done
+  if (ok) {
+    remove(filename_.c_str());
+    ok = rename(temp_filename.c_str(), filename_.c_str()) == 0;
+  }
+  if (!ok)
+    remove(temp_filename.c_str());
+
+  write_ok_ = ok;
+  written_row_count_ = row_count;
+  write_done_ = true;
+}
+
+bool SessionExporter::WriteChunk(FILE* file, const Chunk& chunk) const {
+  size_t planned_row_count = end_sequence_ - begin_sequence_;
+  for (size_t n = 0; n < kColumnCount; ++n) {
+    size_t value_size = kColumns[n].value_size;
+    uint64_t offset = GetFileOffset(n, planned_row_count) +
+                      static_cast<uint64_t>(chunk.first_row) * value_size;
+    if (!SeekFile(file, offset) ||
+        fwrite(&chunk.data[GetChunkOffset(n)], value_size, chunk.row_count, file) !=
+        chunk.row_count)
+      return false;
+  }
+  return true;
+}
+
+bool SessionExporter::WriteHeader(FILE* file, size_t row_count) const {
+  SessionExportHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kSessionExportMagic, sizeof(header.magic));
+  header.version = kSessionExportVersion;
+  header.header_size = sizeof(SessionExportHeader);
+  header.column_count = kColumnCount;
+  header.row_count = row_count;
+  header.column_size = sizeof(SessionExportColumn);
+
+  // The columns stay where they were planned, even if cut short
+  size_t planned_row_count = end_sequence_ - begin_sequence_;
+  SessionExportColumn columns[kColumnCount];
+  memset(columns, 0, sizeof(columns));
+  for (size_t n = 0; n < kColumnCount; ++n) {
+    strncpy(columns[n].name, kColumns[n].name, sizeof(columns[n].name) - 1);
+    columns[n].type = kColumns[n].type;
+    columns[n].value_size = kColumns[n].value_size;
+    columns[n].offset = GetFileOffset(n, planned_row_count);
+  }
+
+  return SeekFile(file, 0) &&
+         fwrite(&header, sizeof(header), 1, file) == 1 &&
+         fwrite(columns, sizeof(columns), 1, file) == 1;
+}
+
+}  // namespace xplmpp
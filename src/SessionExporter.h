@@ -0,0 +1,130 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Flight data session export.
+
+#ifndef LANDEX_SESSIONEXPORTER_H
+#define LANDEX_SESSIONEXPORTER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Common.h"
+#include "FlightData.h"
+#include "SpscQueue.h"
+
+namespace xplmpp {
+
+// Session export file header. The header is followed by the column table,
+// and each column is one contiguous little-endian array of |row_count|
+// values starting at a 64 byte aligned offset, so that it can be memory
+// mapped as is, e.g. with numpy.memmap().
+struct SessionExportHeader {
+  char magic[4];           // kSessionExportMagic
+  uint32_t version;        // kSessionExportVersion
+  uint32_t header_size;    // offset of the column table
+  uint32_t column_count;
+  uint64_t row_count;
+  uint32_t column_size;    // sizeof(SessionExportColumn)
+  uint32_t reserved;
+};
+
+struct SessionExportColumn {
+  enum Type : uint32_t {
+    kFloat32 = 1,
+    kFloat64 = 2,
+    kUInt8 = 3,
+  };
+
+  char name[24];       // zero padded
+  uint32_t type;
+  uint32_t value_size;
+  uint64_t offset;     // of the first value
+};
+
+static_assert(sizeof(SessionExportHeader) == 32, "SessionExportHeader layout");
+static_assert(sizeof(SessionExportColumn) == 40, "SessionExportColumn layout");
+
+static const char kSessionExportMagic[4] = { 'L', 'X', 'S', 'E' };
+static const uint32_t kSessionExportVersion = 1;
+
+// Exports the flight data as it was when the export started. The samples are
+// copied a chunk per Update() on the calling thread, so that a long session
+// never holds up a frame, and the chunks are written on a writer thread. If
+// the flight data is reset or drops the samples not copied yet, the export
+// ends with what was copied so far.
+class SessionExporter {
+public:
+  SessionExporter();
+  ~SessionExporter();
+
+  bool Start(const std::string& filename, const FlightData& data);
+
+  // Copies the next chunk of |data|. Returns true once the export is
+  // complete, see ok() and row_count() for how it went.
+  bool Update(const FlightData& data);
+
+  // Abandons the export in progress.
+  void Stop();
+
+  bool is_exporting() const { return writer_thread_.joinable(); }
+
+  const std::string& filename() const { return filename_; }
+  bool ok() const { return ok_; }
+  size_t row_count() const { return row_count_; }
+  size_t planned_row_count() const { return end_sequence_ - begin_sequence_; }
+
+private:
+  struct Chunk;
+
+  void CopyChunk(const FlightData& data, Chunk& chunk) const;
+  void WriterThread();
+  bool WriteChunk(FILE* file, const Chunk& chunk) const;
+  bool WriteHeader(FILE* file, size_t row_count) const;
+
+  std::string filename_;
+  bool ok_ = false;
+  size_t row_count_ = 0;
+
+  // Calling thread owned
+  unsigned generation_ = 0;
+  size_t begin_sequence_ = 0;
+  size_t end_sequence_ = 0;
+  size_t next_sequence_ = 0;
+  bool copy_done_ = false;
+
+  // Chunks go to the writer and come back to be filled again
+  std::vector<Chunk> chunks_;
+  SpscQueue<Chunk*> filled_;
+  SpscQueue<Chunk*> free_;
+
+  std::thread writer_thread_;
+  std::atomic<bool> copy_complete_{false};
+  std::atomic<bool> write_done_{false};
+  std::atomic<bool> stopping_{false};
+  bool write_ok_ = false;
+  size_t written_row_count_ = 0;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_SESSIONEXPORTER_H
@@ -25,8 +25,8 @@
 #include "absl/strings/strip.h"
 #include "absl/strings/match.h"
 #include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
 
-#include "xplmpp/XPLMPath.h"
 #include "xplmpp/File.h"
 
 namespace xplmpp {
@@ -53,17 +53,30 @@ bool ApplyDistanceUnits(float* value, const std::string& units) {
   return true;
 }
 
-}  // namespace
+bool ApplyTimeUnits(float* value, const std::string& units) {
+  if (units == "s" || units == "sec") {
+    // Seconds already
+  } else
+  if (units == "min") {
+    *value *= 60.0f;
+  } else
+  if (units == "h") {
+    *value *= 3600.0f;
+  } else
+    return false;
 
-std::string Settings::GetSettingsFilename() {
-  return XPLMPath::GetPrefsFolder() + "LandEx.prf";
+  return true;
 }
 
+}  // namespace
+
 bool Settings::Load(const char* filename) {
+  warnings_.clear();
+
   File file;
   if (!file.Open(filename, "rt")) {
-    LOG(WARNING) << "Could not open settings file '"
-                 << filename << "', assuming defaults.";
+    Warn(absl::StrCat("Could not open settings file '", filename,
+                      "', assuming defaults."));
     return false;
   }
 
@@ -72,32 +85,87 @@ bool Settings::Load(const char* filename) {
     absl::string_view input = absl::StripAsciiWhitespace(line);
     if (input.empty() || absl::StartsWith(input, "#"))
       continue;
-    LOG(VERBOSE) << input;
     if (!Load(absl::StrSplit(input, absl::ByAnyChar(" ="), absl::SkipWhitespace()))) {
-      LOG(WARNING) << "Invalid setting: '" << line << "', ignored.";
+      Warn(absl::StrCat("Invalid setting: '", line, "', ignored."));
     }
   }
 
   return true;
 }
 
+void Settings::LogWarnings() const {
+  for (const std::string& warning : warnings_) {
+    LOG(WARNING) << warning;
+  }
+}
+
+unsigned Settings::Compare(const Settings& other) const {
+  unsigned changes = 0;
+
+  if (log_level_ != other.log_level_)
+    changes |= kLogChanged;
+
+  if (runway_distance_ != other.runway_distance_ ||
+      approach_distance_ != other.approach_distance_ ||
+      vertical_grid_ != other.vertical_grid_ ||
+      horizontal_grid_ != other.horizontal_grid_)
+    changes |= kLayoutChanged;
+
+  if (history_distance_ != other.history_distance_ ||
+      history_time_ != other.history_time_)
+    changes |= kHistoryChanged;
+
+  if (flare_height_ != other.flare_height_)
+    changes |= kFlareChanged;
+
+  if (server_port_ != other.server_port_)
+    changes |= kServerChanged;
+
+  return changes;
+}
+
 bool Settings::Load(const std::vector<std::string>& vstr) {
   if (vstr.size() < 2)
     return false;
 
+  typedef bool (Settings::*Parser)(const std::vector<std::string>&,
+                                    std::function<void(Settings&, float)>);
+
   static struct {
     char* setting;
+    Parser parser;
     std::function<void(Settings&, float)> setter;
   } settings[] = {
-    "runway_distance", &Settings::set_runway_distance,
-    "approach_distance", &Settings::set_approach_distance,
-    "vertical_grid", &Settings::set_vertical_grid,
-    "horizontal_grid", &Settings::set_horizontal_grid,
+    "runway_distance", &Settings::SetDistance, &Settings::set_runway_distance,
+    "approach_distance", &Settings::SetDistance, &Settings::set_approach_distance,
+    "vertical_grid", &Settings::SetDistance, &Settings::set_vertical_grid,
+    "horizontal_grid", &Settings::SetDistance, &Settings::set_horizontal_grid,
+    "history_distance", &Settings::SetDistance, &Settings::set_history_distance,
+    "flare_height", &Settings::SetDistance, &Settings::set_flare_height,
+    "history_time", &Settings::SetTime, &Settings::set_history_time,
   };
 
   for (int n = 0; n < numbof(settings); ++n) {
     if (vstr[0] == settings[n].setting) {
-      SetDistance(vstr, settings[n].setter);
+      (this->*settings[n].parser)(vstr, settings[n].setter);
+      return true;
+    }
+  }
+
+  typedef bool (Settings::*IntParser)(const std::vector<std::string>&,
+                                       std::function<void(Settings&, int)>);
+
+  static struct {
+    char* setting;
+    IntParser parser;
+    std::function<void(Settings&, int)> setter;
+  } int_settings[] = {
+    "server_port", &Settings::SetPort, &Settings::set_server_port,
+  };
+
+  for (int n = 0; n < numbof(int_settings); ++n) {
+    if (vstr[0] == int_settings[n].setting) {
+      (this->*int_settings[n].parser)(vstr, int_settings[n].setter);
       return true;
     }
   }
@@ -109,12 +177,41 @@ bool Settings::SetDistance(const std::vector<std::string>& vstr,
                            std::function<void(Settings&, float)> setter) {
   float value = 0;
   if (!absl::SimpleAtof(vstr[1], &value)) {
-    LOG(WARNING) << "Invalid '" << vstr[0] << "' value, ignored.";
+    Warn(absl::StrCat("Invalid '", vstr[0], "' value, ignored."));
     return false;
   }
 
   if (vstr.size() > 2 && !ApplyDistanceUnits(&value, vstr[2])) {
-    LOG(WARNING) << "Invalid '" << vstr[0] << "' units ignored.";
+    Warn(absl::StrCat("Invalid '", vstr[0], "' units ignored."));
+    return false;
+  }
+
+  setter(*this, value);
+  return true;
+}
+
+bool Settings::SetTime(const std::vector<std::string>& vstr,
+                       std::function<void(Settings&, float)> setter) {
+  float value = 0;
+  if (!absl::SimpleAtof(vstr[1], &value)) {
+    Warn(absl::StrCat("Invalid '", vstr[0], "' value, ignored."));
+    return false;
+  }
+
+  if (vstr.size() > 2 && !ApplyTimeUnits(&value, vstr[2])) {
+    Warn(absl::StrCat("Invalid '", vstr[0], "' units ignored."));
+    return false;
+  }
+
+  setter(*this, value);
+  return true;
+}
+
+bool Settings::SetPort(const std::vector<std::string>& vstr,
+                       std::function<void(Settings&, int)> setter) {
+  int value = 0;
+  if (!absl::SimpleAtoi(vstr[1], &value) || value < 0 || value > 65535) {
+    Warn(absl::StrCat("Invalid '", vstr[0], "' value, ignored."));
     return false;
   }
 
@@ -20,6 +20,7 @@
 #ifndef LANDEX_SETTINGS_H
 #define LANDEX_SETTINGS_H
 
+#include <string>
 #include <vector>
 #include <functional>
 
@@ -32,15 +33,29 @@ public:
   Settings() = default;
   ~Settings() = default;
 
-  std::string GetSettingsFilename();
+  // Groups of settings that something depends on, see Compare()
+  enum Changes : unsigned {
+    kLogChanged = 0x01,
+    kLayoutChanged = 0x02,
+    kHistoryChanged = 0x04,
+    kFlareChanged = 0x08,
+    kServerChanged = 0x10,
+    kAllChanged = 0x1F,
+  };
 
+  // Loads the settings from |filename| over the current ones. Problems found
+  // are kept in warnings() rather than logged, so that the settings can be
+  // loaded on any thread.
   bool Load(const char* filename);
   bool Load(const std::string& filename) {
     return Load(filename.c_str());
   }
-  bool Load() {
-    return Load(GetSettingsFilename());
-  }
+
+  const std::vector<std::string>& warnings() const { return warnings_; }
+  void LogWarnings() const;
+
+  // Returns the Changes groups with values different in |other|.
+  unsigned Compare(const Settings& other) const;
 
 #define SETTING_I(name, def) \
    private: \
@@ -61,14 +76,25 @@ public:
   SETTING_F(approach_distance, 1.0f * kNmToMeters);
   SETTING_F(vertical_grid,     0.1f * kNmToMeters);
   SETTING_F(horizontal_grid, 100.0f * kFtToMeters);
+  SETTING_F(history_distance,  3.0f * kNmToMeters);
+  SETTING_F(flare_height,     50.0f * kFtToMeters);
+  SETTING_F(history_time,      0.0f);  // seconds, 0 = unlimited
+  SETTING_I(server_port, 0);  // telemetry server port, 0 = off
 
   #undef SETTING_I
   #undef SETTING_F
 
 private:
   bool Load(const std::vector<std::string>& vstr);
+  void Warn(const std::string& warning) { warnings_.push_back(warning); }
   bool SetDistance(const std::vector<std::string>& vstr,
                    std::function<void(Settings&, float)> setter);
+  bool SetTime(const std::vector<std::string>& vstr,
+               std::function<void(Settings&, float)> setter);
+  bool SetPort(const std::vector<std::string>& vstr,
+               std::function<void(Settings&, int)> setter);
+
+  std::vector<std::string> warnings_;
 };
 
 extern Settings g_settings;
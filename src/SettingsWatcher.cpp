@@ -0,0 +1,175 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Settings file watcher implementation.
+
+#include "SettingsWatcher.h"
+
+#include <chrono>
+#include <filesystem>
+
+#if LIN
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace xplmpp {
+
+static const auto kWakeUpInterval = std::chrono::milliseconds(250);
+static const auto kPollInterval = std::chrono::seconds(1);
+
+// Editors write files in pieces, so wait for them to settle before loading
+static const auto kSettleDownDelay = std::chrono::milliseconds(50);
+
+namespace {
+
+void GetFileTime(const std::string& filename, int64_t& time, int64_t& size) {
+  std::error_code ec;
+  std::filesystem::path path(filename);
+  time = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+  if (ec)
+    time = 0;
+  size = static_cast<int64_t>(std::filesystem::file_size(path, ec));
+  if (ec)
+    size = -1;
+}
+
+}  // namespace
+
+SettingsWatcher::~SettingsWatcher() {
+  Stop();
+}
+
+bool SettingsWatcher::Start(const std::string& filename) {
+  if (is_running())
+    return true;
+
+  filename_ = filename;
+  GetFileTime(filename_, file_time_, file_size_);
+
+#if LIN
+  // Watch the folder rather than the file, editors often save by writing
+  // a new file and renaming it over the old one
+  std::filesystem::path path(filename_);
+  std::string folder = path.parent_path().string();
+  notify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (notify_fd_ >= 0 &&
+      ::inotify_add_watch(notify_fd_, folder.empty() ? "." : folder.c_str(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    ::close(notify_fd_);
+    notify_fd_ = -1;
+  }
+  if (notify_fd_ < 0) {
+    LOG(WARNING) << "Could not watch '" << filename_ << "', polling it instead.";
+  }
+#endif
+
+  stopping_ = false;
+  worker_thread_ = std::thread(&SettingsWatcher::WorkerThread, this);
+  return true;
+}
+
+void SettingsWatcher::Stop() {
+  if (is_running()) {
+    stopping_ = true;
+    worker_thread_.join();
+  }
+
+#if LIN
+  if (notify_fd_ >= 0) {
+    ::close(notify_fd_);
+    notify_fd_ = -1;
+  }
+#endif
+
+  delete pending_.exchange(nullptr);
+}
+
+void SettingsWatcher::WorkerThread() {
+  while (WaitForChange())
+    LoadSettings();
+}
+
+bool SettingsWatcher::WaitForChange() {
+  return notify_fd_ >= 0 ? WaitForChangeNotify() : WaitForChangePoll();
+}
+
+bool SettingsWatcher::WaitForChangeNotify() {
+#if LIN
+  std::string name = std::filesystem::path(filename_).filename().string();
+  alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+
+  bool changed = false;
+  while (!stopping_) {
+    pollfd pfd = { notify_fd_, POLLIN, 0 };
+    int timeout = static_cast<int>(changed ? kSettleDownDelay.count()
+                                           : kWakeUpInterval.count());
+    int ready = ::poll(&pfd, 1, timeout);
+    if (ready < 0 && errno != EINTR)
+      return WaitForChangePoll();
+
+    // Nothing more happened after a change, the file is ready
+    if (ready == 0 && changed)
+      return true;
+
+    ssize_t length;
+    while ((length = ::read(notify_fd_, buffer, sizeof(buffer))) > 0) {
+      for (char* p = buffer; p < buffer + length;) {
+        const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+        if (event->len && name == event->name)
+          changed = true;
+        p += sizeof(inotify_event) + event->len;
+      }
+    }
+  }
+#endif
+
+  return false;
+}
+
+bool SettingsWatcher::WaitForChangePoll() {
+  for (;;) {
+    for (auto slept = std::chrono::milliseconds(0); slept < kPollInterval;
+         slept += kWakeUpInterval) {
+      if (stopping_)
+        return false;
+      std::this_thread::sleep_for(kWakeUpInterval);
+    }
+
+    int64_t time = 0, size = 0;
+    GetFileTime(filename_, time, size);
+    if (time != file_time_ || size != file_size_) {
+      file_time_ = time;
+      file_size_ = size;
+      std::this_thread::sleep_for(kSettleDownDelay);
+      return true;
+    }
+  }
+}
+
+void SettingsWatcher::LoadSettings() {
+  std::unique_ptr<Settings> settings = std::make_unique<Settings>();
+  settings->Load(filename_);
+
+  // Replace the settings not picked up yet, if any
+  delete pending_.exchange(settings.release());
+}
+
+}  // namespace xplmpp
@@ -0,0 +1,80 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Settings file watcher.
+
+#ifndef LANDEX_SETTINGSWATCHER_H
+#define LANDEX_SETTINGSWATCHER_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "Common.h"
+#include "Settings.h"
+
+namespace xplmpp {
+
+// Watches the settings file and loads it on a worker thread whenever it
+// changes, with inotify where there is one and by polling the file time
+// elsewhere. Each load makes a new Settings that is not changed afterwards,
+// and is handed over through an atomic pointer to be picked up with
+// TryGetSettings() on the caller's thread, at whatever point suits it.
+class SettingsWatcher {
+public:
+  SettingsWatcher() = default;
+  ~SettingsWatcher();
+
+  bool Start(const std::string& filename);
+  void Stop();
+
+  bool is_running() const { return worker_thread_.joinable(); }
+
+  // Returns the settings loaded since the previous call, or nullptr. Only
+  // the latest settings are kept if the file changed several times since.
+  std::unique_ptr<const Settings> TryGetSettings() {
+    return std::unique_ptr<const Settings>(pending_.exchange(nullptr));
+  }
+
+private:
+  void WorkerThread();
+
+  // Waits for the file to change, returns false when stopping
+  bool WaitForChange();
+  bool WaitForChangeNotify();
+  bool WaitForChangePoll();
+
+  void LoadSettings();
+
+  std::string filename_;
+
+  std::thread worker_thread_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<Settings*> pending_{nullptr};
+
+  // Worker owned
+  int notify_fd_ = -1;
+  int64_t file_time_ = 0;
+  int64_t file_size_ = 0;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_SETTINGSWATCHER_H
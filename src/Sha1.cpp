@@ -0,0 +1,105 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// SHA-1 message digest implementation, see RFC 3174.
+
+#include "Sha1.h"
+
+#include <string.h>
+
+namespace xplmpp {
+
+namespace {
+
+inline uint32_t RotateLeft(uint32_t value, int bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+void ProcessBlock(const uint8_t* block, uint32_t* state) {
+  uint32_t w[80];
+  for (int n = 0; n < 16; ++n) {
+    w[n] = (uint32_t(block[n * 4]) << 24) | (uint32_t(block[n * 4 + 1]) << 16) |
+           (uint32_t(block[n * 4 + 2]) << 8) | uint32_t(block[n * 4 + 3]);
+  }
+  for (int n = 16; n < 80; ++n)
+    w[n] = RotateLeft(w[n - 3] ^ w[n - 8] ^ w[n - 14] ^ w[n - 16], 1);
+
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+  for (int n = 0; n < 80; ++n) {
+    uint32_t f, k;
+    if (n < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999;
+    } else
+    if (n < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    } else
+    if (n < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDC;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+
+    uint32_t temp = RotateLeft(a, 5) + f + e + k + w[n];
+    e = d;
+    d = c;
+    c = RotateLeft(b, 30);
+    b = a;
+    a = temp;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+}  // namespace
+
+void Sha1(const void* data, size_t size, uint8_t digest[kSha1DigestSize]) {
+  uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  size_t offset = 0;
+  for (; offset + 64 <= size; offset += 64)
+    ProcessBlock(bytes + offset, state);
+
+  // Pad with a one bit, zeros and the length in bits, into one or two blocks
+  uint8_t tail[128] = {};
+  size_t tail_size = size - offset;
+  memcpy(tail, bytes + offset, tail_size);
+  tail[tail_size] = 0x80;
+  size_t tail_blocks = tail_size + 9 > 64 ? 2 : 1;
+  uint64_t bit_count = static_cast<uint64_t>(size) * 8;
+  for (int n = 0; n < 8; ++n)
+    tail[tail_blocks * 64 - 1 - n] = static_cast<uint8_t>(bit_count >> (n * 8));
+  for (size_t n = 0; n < tail_blocks; ++n)
+    ProcessBlock(tail + n * 64, state);
+
+  for (int n = 0; n < 5; ++n) {
+    digest[n * 4] = static_cast<uint8_t>(state[n] >> 24);
+    digest[n * 4 + 1] = static_cast<uint8_t>(state[n] >> 16);
+    digest[n * 4 + 2] = static_cast<uint8_t>(state[n] >> 8);
+    digest[n * 4 + 3] = static_cast<uint8_t>(state[n]);
+  }
+}
+
+}  // namespace xplmpp
@@ -0,0 +1,38 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// SHA-1 message digest.
+
+#ifndef LANDEX_SHA1_H
+#define LANDEX_SHA1_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Common.h"
+
+namespace xplmpp {
+
+static const size_t kSha1DigestSize = 20;
+
+// Calculates the SHA-1 digest of |size| bytes at |data|. It is only good for
+// protocol needs like the WebSocket handshake, not for security.
+void Sha1(const void* data, size_t size, uint8_t digest[kSha1DigestSize]);
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_SHA1_H
@@ -0,0 +1,102 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Lock-free single producer single consumer queue.
+
+#ifndef LANDEX_SPSCQUEUE_H
+#define LANDEX_SPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "Common.h"
+
+namespace xplmpp {
+
+// Represents a bounded lock-free queue with exactly one producer thread and
+// one consumer thread. Neither side ever blocks: TryPush() fails when the
+// queue is full and TryPop() fails when it is empty.
+template <typename T>
+class SpscQueue {
+public:
+  // |capacity| is rounded up to a power of two.
+  explicit SpscQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity)
+      size <<= 1;
+    items_.resize(size);
+    mask_ = size - 1;
+  }
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  size_t capacity() const { return items_.size(); }
+
+  // Producer side
+  bool TryPush(const T& item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ == items_.size()) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ == items_.size())
+        return false;
+    }
+
+    items_[tail & mask_] = item;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  bool TryPop(T& item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_)
+        return false;
+    }
+
+    item = std::move(items_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Either side, approximate
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  std::vector<T> items_;
+  size_t mask_;
+
+  // Consumer owned
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+  size_t tail_cache_ = 0;
+
+  // Producer owned
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+  size_t head_cache_ = 0;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_SPSCQUEUE_H
@@ -0,0 +1,845 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Telemetry stream server implementation.
+
+#include "TelemetryServer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+
+#if IBM
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#if LIN
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+
+#include "LandingClassifier.h"
+#include "Sha1.h"
+
+namespace xplmpp {
+
+#if IBM
+#pragma comment(lib, "ws2_32")
+
+typedef SOCKET Socket;
+static const Socket kInvalidSocket = INVALID_SOCKET;
+#else
+typedef int Socket;
+static const Socket kInvalidSocket = -1;
+#endif
+
+static const int kListenBacklog = 8;
+static const size_t kQueueCapacity = 64;          // messages
+static const size_t kMaxSamplesPerMessage = 4096;
+static const size_t kMaxRequestSize = 8192;       // bytes
+static const size_t kMaxClientFrameSize = 4096;   // bytes
+static const size_t kMaxClientBacklog = 256 * 1024;  // bytes
+static const auto kSlowClientTimeout = std::chrono::seconds(10);
+static const int kMaxEvents = 64;
+
+// Without a way to wake the I/O thread it checks the queue this often
+#if LIN
+static const int kWaitTimeoutMs = 100;
+#else
+static const int kWaitTimeoutMs = 10;
+#endif
+
+static const char kWebSocketGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// WebSocket opcodes
+static const uint8_t kOpcodeBinary = 0x2;
+static const uint8_t kOpcodeClose = 0x8;
+static const uint8_t kOpcodePing = 0x9;
+static const uint8_t kOpcodePong = 0xA;
+
+static const char kHttpNote[] =
+    "LandEx telemetry. Connect a WebSocket client to this address to stream "
+    "the flight data and the landings.\n";
+
+namespace {
+
+Socket ToSocket(intptr_t socket) {
+  return static_cast<Socket>(socket);
+}
+
+void CloseSocket(Socket socket) {
+#if IBM
+  ::closesocket(socket);
+#else
+  ::close(socket);
+#endif
+}
+
+bool SetNonBlocking(Socket socket) {
+#if IBM
+  u_long mode = 1;
+  return ::ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+  int flags = ::fcntl(socket, F_GETFL, 0);
+  return flags >= 0 && ::fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+bool IsWouldBlock() {
+#if IBM
+  return ::WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+int SocketError() {
+#if IBM
+  return ::WSAGetLastError();
+#else
+  return errno;
+#endif
+}
+
+long SendBytes(Socket socket, const uint8_t* data, size_t size) {
+#if IBM
+  return ::send(socket, reinterpret_cast<const char*>(data), static_cast<int>(size), 0);
+#elif LIN
+  return ::send(socket, data, size, MSG_NOSIGNAL);
+#else
+  return ::send(socket, data, size, 0);
+#endif
+}
+
+long ReceiveBytes(Socket socket, uint8_t* data, size_t size) {
+#if IBM
+  return ::recv(socket, reinterpret_cast<char*>(data), static_cast<int>(size), 0);
+#else
+  return ::recv(socket, data, size, 0);
+#endif
+}
+
+std::string GetAcceptKey(absl::string_view key) {
+  std::string text = absl::StrCat(key, kWebSocketGuid);
+  uint8_t digest[kSha1DigestSize];
+  Sha1(text.data(), text.size(), digest);
+  return absl::Base64Escape(
+      absl::string_view(reinterpret_cast<const char*>(digest), sizeof(digest)));
+}
+
+}  // namespace
+
+/*
+ * Socket readiness notification, epoll on Linux and poll() elsewhere.
+ */
+class TelemetryServer::Poller {
+public:
+  struct Event {
+    void* context;
+    bool readable;
+    bool writable;
+    bool error;
+  };
+
+  Poller() = default;
+  ~Poller();
+
+  bool Create();
+
+  bool Add(Socket socket, void* context);
+  void SetWritable(Socket socket, void* context, bool writable);
+  void Remove(Socket socket);
+
+  int Wait(int timeout_ms, Event* events, int max_events);
+
+private:
+#if LIN
+  int epoll_ = -1;
+#else
+  std::vector<pollfd> fds_;
+  std::vector<void*> contexts_;
+#endif
+};
+
+#if LIN
+
+TelemetryServer::Poller::~Poller() {
+  if (epoll_ >= 0)
+    ::close(epoll_);
+}
+
+bool TelemetryServer::Poller::Create() {
+  epoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+  return epoll_ >= 0;
+}
+
+bool TelemetryServer::Poller::Add(Socket socket, void* context) {
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.ptr = context;
+  return ::epoll_ctl(epoll_, EPOLL_CTL_ADD, socket, &event) == 0;
+}
+
+void TelemetryServer::Poller::SetWritable(Socket socket, void* context, bool writable) {
+  epoll_event event = {};
+  event.events = EPOLLIN | (writable ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+  event.data.ptr = context;
+  ::epoll_ctl(epoll_, EPOLL_CTL_MOD, socket, &event);
+}
+
+void TelemetryServer::Poller::Remove(Socket socket) {
+  epoll_event event = {};
+  ::epoll_ctl(epoll_, EPOLL_CTL_DEL, socket, &event);
+}
+
+int TelemetryServer::Poller::Wait(int timeout_ms, Event* events, int max_events) {
+  epoll_event ready[kMaxEvents];
+  int count = ::epoll_wait(epoll_, ready, std::min(max_events, kMaxEvents), timeout_ms);
+  for (int n = 0; n < count; ++n) {
+    events[n].context = ready[n].data.ptr;
+    events[n].readable = !!(ready[n].events & EPOLLIN);
+    events[n].writable = !!(ready[n].events & EPOLLOUT);
+    events[n].error = !!(ready[n].events & (EPOLLERR | EPOLLHUP));
+  }
+  return std::max(count, 0);
+}
+
+#else  // #if LIN
+
+TelemetryServer::Poller::~Poller() {
+}
+
+bool TelemetryServer::Poller::Create() {
+  return true;
+}
+
+bool TelemetryServer::Poller::Add(Socket socket, void* context) {
+  pollfd fd = {};
+  fd.fd = socket;
+  fd.events = POLLIN;
+  fds_.push_back(fd);
+  contexts_.push_back(context);
+  return true;
+}
+
+void TelemetryServer::Poller::SetWritable(Socket socket, void* context, bool writable) {
+  for (pollfd& fd : fds_) {
+    if (fd.fd == socket)
+      fd.events = POLLIN | (writable ? POLLOUT : 0);
+  }
+}
+
+void TelemetryServer::Poller::Remove(Socket socket) {
+  for (size_t n = 0; n < fds_.size(); ++n) {
+    if (fds_[n].fd == socket) {
+      fds_.erase(fds_.begin() + n);
+      contexts_.erase(contexts_.begin() + n);
+      return;
+    }
+  }
+}
+
+int TelemetryServer::Poller::Wait(int timeout_ms, Event* events, int max_events) {
+#if IBM
+  int ready = ::WSAPoll(fds_.data(), static_cast<ULONG>(fds_.size()), timeout_ms);
+#else
+  int ready = ::poll(fds_.data(), fds_.size(), timeout_ms);
+#endif
+  int count = 0;
+  for (size_t n = 0; ready > 0 && n < fds_.size() && count < max_events; ++n) {
+    short revents = fds_[n].revents;
+    if (!revents)
+      continue;
+    events[count].context = contexts_[n];
+    events[count].readable = !!(revents & POLLIN);
+    events[count].writable = !!(revents & POLLOUT);
+    events[count].error = !!(revents & (POLLERR | POLLHUP | POLLNVAL));
+    ++count;
+  }
+  return count;
+}
+
+#endif  // #if LIN
+
+/*
+ * Telemetry client connection, I/O thread owned.
+ */
+struct TelemetryServer::Client {
+  enum class State {
+    request,    // waiting for the HTTP request
+    streaming,  // WebSocket open
+    closing,    // closing once the output is sent
+    closed,
+  };
+
+  Socket socket = kInvalidSocket;
+  State state = State::request;
+  std::string input;
+
+  std::deque<Message> output;
+  size_t output_offset = 0;  // of the first message
+  size_t output_size = 0;    // bytes queued
+  bool writable = false;     // waiting to be able to write
+  std::chrono::steady_clock::time_point last_progress;
+};
+
+/*
+ * Telemetry server implementation.
+ */
+TelemetryServer::TelemetryServer()
+: messages_(kQueueCapacity) {
+#if IBM
+  WSADATA wsa_data;
+  ::WSAStartup(MAKEWORD(2, 2), &wsa_data);
+#endif
+}
+
+TelemetryServer::~TelemetryServer() {
+  Stop();
+#if IBM
+  ::WSACleanup();
+#endif
+}
+
+bool TelemetryServer::Start(int port) {
+  Stop();
+
+  Socket socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (socket == kInvalidSocket) {
+    LOG(ERROR) << "Could not create the telemetry socket, error " << SocketError();
+    return false;
+  }
+
+  int reuse = 1;
+  ::setsockopt(socket, SOL_SOCKET, SO_REUSEADDR,
+               reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(static_cast<uint16_t>(port));
+  socklen_t address_size = sizeof(address);
+  if (::bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      ::listen(socket, kListenBacklog) != 0 ||
+      !SetNonBlocking(socket) ||
+      ::getsockname(socket, reinterpret_cast<sockaddr*>(&address), &address_size) != 0) {
+    LOG(ERROR) << "Could not listen on port " << port << ", error " << SocketError();
+    CloseSocket(socket);
+    return false;
+  }
+
+  poller_ = std::make_unique<Poller>();
+  if (!poller_->Create() || !poller_->Add(socket, &listen_socket_)) {
+    LOG(ERROR) << "Could not poll the telemetry socket.";
+    poller_.reset();
+    CloseSocket(socket);
+    return false;
+  }
+
+#if LIN
+  int wake_event = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_event >= 0 && poller_->Add(wake_event, &wake_event_)) {
+    wake_event_ = wake_event;
+  } else
+  if (wake_event >= 0) {
+    ::close(wake_event);
+  }
+#endif
+
+  listen_socket_ = static_cast<intptr_t>(socket);
+  port_ = ntohs(address.sin_port);
+
+  LOG(INFO) << "Telemetry server listening on port " << port_ << ".";
+
+  has_sequence_ = false;
+  landings_.clear();
+  Message message;
+  while (messages_.TryPop(message)) {}
+
+  stopping_ = false;
+  client_count_ = 0;
+  dropped_count_ = 0;
+  io_thread_ = std::thread(&TelemetryServer::IoThread, this);
+  return true;
+}
+
+void TelemetryServer::Stop() {
+  if (!is_running())
+    return;
+
+  stopping_ = true;
+  Wake();
+  io_thread_.join();
+
+  for (std::unique_ptr<Client>& client : clients_)
+    Close(*client);
+  clients_.clear();
+  client_count_ = 0;
+
+  CloseSocket(ToSocket(listen_socket_));
+  listen_socket_ = -1;
+#if LIN
+  if (wake_event_ >= 0)
+    ::close(static_cast<int>(wake_event_));
+#endif
+  wake_event_ = -1;
+  poller_.reset();
+
+  LOG(INFO) << "Telemetry server stopped.";
+}
+
+void TelemetryServer::AddLanding(const LandingInfo& info, bool classify) {
+  TelemetryLanding landing = {};
+  landing.contact_time = info.contact_time;
+  landing.vertical_speed = info.vertical_speed;
+  landing.ground_speed = info.ground_speed;
+  landing.gforce = info.gforce;
+  landing.peak_vertical_speed = info.peak_vertical_speed;
+  landing.heading = info.heading;
+  landing.lat = info.lat;
+  landing.lon = info.lon;
+  landing.quality = classify ?
+      static_cast<uint8_t>(LandingQualityIndex(fabs(info.vertical_speed))) :
+      TelemetryLanding::kNotClassified;
+  landings_.push_back(landing);
+}
+
+void TelemetryServer::Send(const FlightData& data) {
+  if (!is_running())
+    return;
+
+  // Pick up from where the previous message left off, the samples from
+  // before the start or missed in between are not sent
+  uint16_t flags = 0;
+  if (!has_sequence_ || generation_ != data.generation() ||
+      next_sequence_ < data.first_sequence() || next_sequence_ > data.end_sequence()) {
+    flags |= TelemetryHeader::kGap;
+    next_sequence_ = has_sequence_ ? data.first_sequence() : data.end_sequence();
+    generation_ = data.generation();
+    has_sequence_ = true;
+  }
+
+  size_t end_sequence = data.end_sequence();
+  if (end_sequence - next_sequence_ > kMaxSamplesPerMessage) {
+    flags |= TelemetryHeader::kGap;
+    next_sequence_ = end_sequence - kMaxSamplesPerMessage;
+  }
+
+  size_t sample_count = end_sequence - next_sequence_;
+  size_t landing_count = std::min(landings_.size(), kMaxSamplesPerMessage);
+  size_t first_sequence = next_sequence_;
+  next_sequence_ = end_sequence;
+
+  // Nobody to send to, or nothing to send
+  if (!client_count_ || (!sample_count && !landing_count)) {
+    landings_.clear();
+    return;
+  }
+
+  std::vector<uint8_t> payload(sizeof(TelemetryHeader) +
+                               sample_count * sizeof(TelemetrySample) +
+                               landing_count * sizeof(TelemetryLanding));
+
+  TelemetryHeader* header = reinterpret_cast<TelemetryHeader*>(payload.data());
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, kTelemetryMagic, sizeof(header->magic));
+  header->version = kTelemetryVersion;
+  header->flags = flags;
+  header->sample_count = static_cast<uint16_t>(sample_count);
+  header->landing_count = static_cast<uint16_t>(landing_count);
+  header->first_sequence = first_sequence;
+
+  TelemetrySample* samples =
+      reinterpret_cast<TelemetrySample*>(payload.data() + sizeof(TelemetryHeader));
+  size_t index = first_sequence - data.first_sequence();
+  for (size_t n = 0; n < sample_count; ++n, ++index) {
+    TelemetrySample& sample = samples[n];
+    memset(&sample, 0, sizeof(sample));
+    sample.time = data.time(index);
+    sample.ground_speed = data.ground_speed(index);
+    sample.vertical_speed = data.vertical_speed(index);
+    sample.agl = data.agl(index);
+    sample.msl = data.msl(index);
+    sample.heading = data.heading(index);
+    sample.lat = data.lat(index);
+    sample.lon = data.lon(index);
+    sample.flying = data.flying(index) ? 1 : 0;
+  }
+
+  if (landing_count) {
+    memcpy(samples + sample_count, landings_.data(), landing_count * sizeof(TelemetryLanding));
+    landings_.clear();
+  }
+
+  // Dropped if the I/O thread is that far behind
+  if (!messages_.TryPush(MakeFrame(kOpcodeBinary, payload.data(), payload.size()))) {
+    ++dropped_count_;
+    return;
+  }
+
+  Wake();
+}
+
+TelemetryServer::Message TelemetryServer::MakeFrame(uint8_t opcode, const void* payload,
+                                                    size_t size) {
+  // Server frames are never masked
+  std::vector<uint8_t> frame;
+  frame.reserve(size + 10);
+  frame.push_back(0x80 | opcode);
+  if (size < 126) {
+    frame.push_back(static_cast<uint8_t>(size));
+  } else
+  if (size <= 0xFFFF) {
+    frame.push_back(126);
+    frame.push_back(static_cast<uint8_t>(size >> 8));
+    frame.push_back(static_cast<uint8_t>(size));
+  } else {
+    frame.push_back(127);
+    for (int n = 7; n >= 0; --n)
+      frame.push_back(static_cast<uint8_t>(static_cast<uint64_t>(size) >> (n * 8)));
+  }
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(payload);
+  frame.insert(frame.end(), bytes, bytes + size);
+  return std::make_shared<const std::vector<uint8_t>>(std::move(frame));
+}
+
+void TelemetryServer::Wake() {
+#if LIN
+  if (wake_event_ >= 0) {
+    uint64_t one = 1;
+    ssize_t result = ::write(static_cast<int>(wake_event_), &one, sizeof(one));
+    (void)result;
+  }
+#endif
+}
+
+void TelemetryServer::IoThread() {
+  // Runs on the I/O thread, so it does not log
+  Poller::Event events[kMaxEvents];
+  while (!stopping_) {
+    int count = poller_->Wait(kWaitTimeoutMs, events, kMaxEvents);
+    for (int n = 0; n < count; ++n) {
+      const Poller::Event& event = events[n];
+      if (event.context == &listen_socket_) {
+        Accept();
+        continue;
+      }
+
+      if (event.context == &wake_event_) {
+#if LIN
+        uint64_t value;
+        ssize_t result = ::read(static_cast<int>(wake_event_), &value, sizeof(value));
+        (void)result;
+#endif
+        continue;
+      }
+
+      Client& client = *static_cast<Client*>(event.context);
+      if (client.state == Client::State::closed)
+        continue;
+      if (event.error && !event.readable) {
+        Close(client);
+        continue;
+      }
+      if (event.readable)
+        OnReadable(client);
+      if (event.writable && client.state != Client::State::closed)
+        OnWritable(client);
+    }
+
+    // Hand the messages over to every client that keeps up
+    Message message;
+    while (messages_.TryPop(message)) {
+      for (std::unique_ptr<Client>& client : clients_) {
+        if (client->state == Client::State::streaming)
+          Enqueue(*client, message, false);
+      }
+    }
+
+    // Drop the clients that stopped reading, and the closed ones
+    auto now = std::chrono::steady_clock::now();
+    for (std::unique_ptr<Client>& client : clients_) {
+      if (client->state != Client::State::closed && client->output_size &&
+          now - client->last_progress > kSlowClientTimeout)
+        Close(*client);
+    }
+
+    clients_.erase(std::remove_if(clients_.begin(), clients_.end(),
+                                  [](const std::unique_ptr<Client>& client) {
+                                    return client->state == Client::State::closed;
+                                  }),
+                   clients_.end());
+  }
+}
+
+void TelemetryServer::Accept() {
+  for (;;) {
+    Socket socket = ::accept(ToSocket(listen_socket_), nullptr, nullptr);
+    if (socket == kInvalidSocket)
+      return;
+
+    int no_delay = 1;
+    ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY,
+                 reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+#if APL
+    int no_sigpipe = 1;
+    ::setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+
+    std::unique_ptr<Client> client = std::make_unique<Client>();
+    client->socket = socket;
+    client->last_progress = std::chrono::steady_clock::now();
+    if (!SetNonBlocking(socket) || !poller_->Add(socket, client.get())) {
+      CloseSocket(socket);
+      continue;
+    }
+
+    clients_.push_back(std::move(client));
+  }
+}
+
+void TelemetryServer::OnReadable(Client& client) {
+  uint8_t buffer[4096];
+  for (;;) {
+    long size = ReceiveBytes(client.socket, buffer, sizeof(buffer));
+    if (size == 0 || (size < 0 && !IsWouldBlock())) {
+      Close(client);
+      return;
+    }
+    if (size < 0)
+      break;
+
+    // Anything after the close is of no interest
+    if (client.state == Client::State::closing)
+      continue;
+
+    client.input.append(reinterpret_cast<const char*>(buffer), size);
+
+    bool ok = client.state == Client::State::request ?
+        HandleRequest(client) : HandleFrames(client);
+    if (!ok)
+      Close(client);
+    if (client.state == Client::State::closed)
+      return;
+  }
+}
+
+void TelemetryServer::OnWritable(Client& client) {
+  if (!Flush(client))
+    Close(client);
+}
+
+bool TelemetryServer::HandleRequest(Client& client) {
+  size_t end = client.input.find("\r\n\r\n");
+  if (end == std::string::npos)
+    return client.input.size() <= kMaxRequestSize;
+
+  std::vector<absl::string_view> lines =
+      absl::StrSplit(absl::string_view(client.input).substr(0, end), "\r\n");
+
+  absl::string_view key;
+  bool upgrade = false;
+  for (size_t n = 1; n < lines.size(); ++n) {
+    std::pair<absl::string_view, absl::string_view> header =
+        absl::StrSplit(lines[n], absl::MaxSplits(':', 1));
+    absl::string_view name = absl::StripAsciiWhitespace(header.first);
+    absl::string_view value = absl::StripAsciiWhitespace(header.second);
+    if (absl::EqualsIgnoreCase(name, "Upgrade")) {
+      upgrade = absl::EqualsIgnoreCase(value, "websocket");
+    } else
+    if (absl::EqualsIgnoreCase(name, "Sec-WebSocket-Key")) {
+      key = value;
+    }
+  }
+
+  std::string response;
+  if (!absl::StartsWith(lines[0], "GET ")) {
+    response = "HTTP/1.1 405 Method Not Allowed\r\nConnection: close\r\n\r\n";
+    client.state = Client::State::closing;
+  } else
+  if (upgrade && !key.empty()) {
+    response = absl::StrCat("HTTP/1.1 101 Switching Protocols\r\n"
+                            "Upgrade: websocket\r\n"
+                            "Connection: Upgrade\r\n"
+                            "Sec-WebSocket-Accept: ", GetAcceptKey(key), "\r\n\r\n");
+    client.state = Client::State::streaming;
+    ++client_count_;
+  } else {
+    response = absl::StrCat("HTTP/1.1 200 OK\r\n"
+                            "Content-Type: text/plain\r\n"
+                            "Content-Length: ", sizeof(kHttpNote) - 1, "\r\n"
+                            "Connection: close\r\n\r\n", kHttpNote);
+    client.state = Client::State::closing;
+  }
+
+  client.input.erase(0, end + 4);
+  Enqueue(client, std::make_shared<const std::vector<uint8_t>>(response.begin(), response.end()),
+          true);
+  if (client.state == Client::State::closed)
+    return true;
+
+  return client.state != Client::State::streaming || HandleFrames(client);
+}
+
+bool TelemetryServer::HandleFrames(Client& client) {
+  // Clients only have control frames to say, the rest is ignored
+  for (;;) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(client.input.data());
+    size_t size = client.input.size();
+    if (size < 2)
+      return true;
+
+    uint8_t opcode = data[0] & 0x0F;
+    bool masked = !!(data[1] & 0x80);
+    uint64_t length = data[1] & 0x7F;
+    size_t header_size = 2;
+    if (length == 126) {
+      if (size < 4)
+        return true;
+      length = (uint64_t(data[2]) << 8) | data[3];
+      header_size = 4;
+    } else
+    if (length == 127) {
+      if (size < 10)
+        return true;
+      length = 0;
+      for (int n = 0; n < 8; ++n)
+        length = (length << 8) | data[2 + n];
+      header_size = 10;
+    }
+
+    // Client frames must be masked
+    if (!masked || length > kMaxClientFrameSize)
+      return false;
+
+    if (size < header_size + 4 + length)
+      return true;
+
+    const uint8_t* mask = data + header_size;
+    std::vector<uint8_t> payload(data + header_size + 4, data + header_size + 4 + length);
+    for (size_t n = 0; n < payload.size(); ++n)
+      payload[n] ^= mask[n & 3];
+    client.input.erase(0, header_size + 4 + static_cast<size_t>(length));
+
+    switch (opcode) {
+      case kOpcodeClose:
+        // Echo the close and hang up once it is sent
+        if (client.state == Client::State::streaming)
+          --client_count_;
+        client.state = Client::State::closing;
+        Enqueue(client, MakeFrame(kOpcodeClose, payload.data(),
+                                  std::min<size_t>(payload.size(), 2)), true);
+        return true;
+      case kOpcodePing:
+        Enqueue(client, MakeFrame(kOpcodePong, payload.data(), payload.size()), true);
+        break;
+      default:
+        break;
+    }
+
+    if (client.state == Client::State::closed)
+      return true;
+  }
+}
+
+void TelemetryServer::Enqueue(Client& client, const Message& message, bool control) {
+  // A client that does not keep up misses the messages, but not the
+  // protocol replies
+  if (!control && client.output_size + message->size() > kMaxClientBacklog) {
+    ++dropped_count_;
+    return;
+  }
+
+  if (client.output.empty())
+    client.last_progress = std::chrono::steady_clock::now();
+  client.output.push_back(message);
+  client.output_size += message->size();
+
+  if (!client.writable && !Flush(client))
+    Close(client);
+}
+
+bool TelemetryServer::Flush(Client& client) {
+  while (!client.output.empty()) {
+    const std::vector<uint8_t>& message = *client.output.front();
+    long sent = SendBytes(client.socket, message.data() + client.output_offset,
+                     message.size() - client.output_offset);
+    if (sent < 0) {
+      if (!IsWouldBlock())
+        return false;
+      break;
+    }
+
+    client.last_progress = std::chrono::steady_clock::now();
+    client.output_offset += sent;
+    client.output_size -= sent;
+    if (client.output_offset == message.size()) {
+      client.output.pop_front();
+      client.output_offset = 0;
+    }
+  }
+
+  // Wait for room to write the rest, or close once all is said
+  bool writable = !client.output.empty();
+  if (writable != client.writable) {
+    poller_->SetWritable(client.socket, &client, writable);
+    client.writable = writable;
+  }
+
+  if (!writable && client.state == Client::State::closing)
+    Close(client);
+
+  return true;
+}
+
+void TelemetryServer::Close(Client& client) {
+  if (client.state == Client::State::closed)
+    return;
+
+  if (client.state == Client::State::streaming)
+    --client_count_;
+
+  if (poller_)
+    poller_->Remove(client.socket);
+  CloseSocket(client.socket);
+  client.socket = kInvalidSocket;
+  client.state = Client::State::closed;
+  client.output.clear();
+  client.output_size = 0;
+}
+
+}  // namespace xplmpp
@@ -0,0 +1,159 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Telemetry stream server.
+
+#ifndef LANDEX_TELEMETRYSERVER_H
+#define LANDEX_TELEMETRYSERVER_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Common.h"
+#include "FlightData.h"
+#include "FlightLoopClient.h"
+#include "SpscQueue.h"
+
+namespace xplmpp {
+
+// Telemetry message, one per flight loop tick, sent as a binary WebSocket
+// message. The header is followed by the samples and then the landings, all
+// little-endian.
+struct TelemetryHeader {
+  enum Flags : uint16_t {
+    kGap = 0x01,  // samples are missing before these, e.g. after a reset
+  };
+
+  char magic[4];             // kTelemetryMagic
+  uint16_t version;          // kTelemetryVersion
+  uint16_t flags;
+  uint16_t sample_count;
+  uint16_t landing_count;
+  uint32_t reserved;
+  uint64_t first_sequence;   // FlightData sequence number of the first sample
+};
+
+struct TelemetrySample {
+  float time;
+  float ground_speed;
+  float vertical_speed;
+  float agl;
+  float msl;
+  float heading;
+  double lat;
+  double lon;
+  uint8_t flying;
+  uint8_t reserved[7];
+};
+
+struct TelemetryLanding {
+  static constexpr uint8_t kNotClassified = 0xFF;
+
+  float contact_time;
+  float vertical_speed;
+  float ground_speed;
+  float gforce;
+  float peak_vertical_speed;
+  float heading;
+  double lat;
+  double lon;
+  uint8_t quality;           // LandingQualityIndex() or kNotClassified
+  uint8_t reserved[7];
+};
+
+static_assert(sizeof(TelemetryHeader) == 24, "TelemetryHeader layout");
+static_assert(sizeof(TelemetrySample) == 48, "TelemetrySample layout");
+static_assert(sizeof(TelemetryLanding) == 48, "TelemetryLanding layout");
+
+static const char kTelemetryMagic[4] = { 'L', 'X', 'T', 'M' };
+static const uint16_t kTelemetryVersion = 1;
+
+// Streams the flight data samples and the landings to WebSocket clients, and
+// answers plain HTTP requests with a short note. The sockets are served on an
+// I/O thread, epoll based on Linux. The sim thread builds one message per
+// tick and hands it over through a lock-free queue, so it never waits on the
+// network. Clients that fall behind lose messages rather than slow anything
+// down, and are dropped if they stop reading altogether.
+class TelemetryServer {
+public:
+  TelemetryServer();
+  ~TelemetryServer();
+
+  // Listens on |port| on all interfaces, 0 picks any free port.
+  bool Start(int port);
+  void Stop();
+
+  bool is_running() const { return io_thread_.joinable(); }
+  int port() const { return port_; }
+
+  // Sim thread side, never blocks. Landings go out with the next Send().
+  void AddLanding(const LandingInfo& info, bool classify);
+  void Send(const FlightData& data);
+
+  size_t client_count() const { return client_count_; }
+
+  // Messages not delivered to some client for it being too slow
+  size_t dropped_count() const { return dropped_count_; }
+
+private:
+  typedef std::shared_ptr<const std::vector<uint8_t>> Message;
+  struct Client;
+  class Poller;
+
+  void IoThread();
+  void Accept();
+  void OnReadable(Client& client);
+  void OnWritable(Client& client);
+  bool HandleRequest(Client& client);
+  bool HandleFrames(Client& client);
+  void Enqueue(Client& client, const Message& message, bool control);
+  bool Flush(Client& client);
+  void Close(Client& client);
+  void Wake();
+
+  static Message MakeFrame(uint8_t opcode, const void* payload, size_t size);
+
+  int port_ = 0;
+  intptr_t listen_socket_ = -1;
+  intptr_t wake_event_ = -1;
+
+  // Sim thread owned
+  unsigned generation_ = 0;
+  size_t next_sequence_ = 0;
+  bool has_sequence_ = false;
+  std::vector<TelemetryLanding> landings_;
+
+  SpscQueue<Message> messages_;
+
+  // I/O thread owned
+  std::unique_ptr<Poller> poller_;
+  std::vector<std::unique_ptr<Client>> clients_;
+
+  std::thread io_thread_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<size_t> client_count_{0};
+  std::atomic<size_t> dropped_count_{0};
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_TELEMETRYSERVER_H
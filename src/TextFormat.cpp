@@ -0,0 +1,110 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Allocation-free text formatting implementation.
+
+#include "TextFormat.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace xplmpp {
+
+static const int kMaxDecimals = 6;
+static const long long kPowersOf10[kMaxDecimals + 1] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000,
+};
+
+void TextLine::Append(const char* text, size_t size) {
+  size = std::min(size, kCapacity - 1 - size_);
+  memcpy(text_ + size_, text, size);
+  size_ += size;
+  text_[size_] = 0;
+}
+
+TextLine& TextLine::operator<<(const char* text) {
+  Append(text, strlen(text));
+  return *this;
+}
+
+TextLine& TextLine::operator<<(const std::string& text) {
+  Append(text.data(), text.size());
+  return *this;
+}
+
+TextLine& TextLine::operator<<(int value) {
+  char buf[16];
+  std::to_chars_result result = std::to_chars(buf, buf + sizeof(buf), value);
+  Append(buf, result.ptr - buf);
+  return *this;
+}
+
+TextLine& TextLine::operator<<(size_t value) {
+  char buf[24];
+  std::to_chars_result result = std::to_chars(buf, buf + sizeof(buf), value);
+  Append(buf, result.ptr - buf);
+  return *this;
+}
+
+TextLine& TextLine::operator<<(const Quantity& quantity) {
+  AppendNumber(quantity.value, quantity.decimals);
+  Append(" ", 1);
+  return *this << quantity.units;
+}
+
+TextLine& TextLine::AppendNumber(float value, int decimals) {
+  decimals = std::min(std::max(decimals, 0), kMaxDecimals);
+
+  // Work in integer units of the last decimal place
+  double scaled = std::round(static_cast<double>(value) * kPowersOf10[decimals]);
+  if (!std::isfinite(scaled) || fabs(scaled) >= 9e18) {
+    Append("--", 2);
+    return *this;
+  }
+
+  long long units = static_cast<long long>(scaled);
+  while (decimals > 0 && units % 10 == 0) {
+    units /= 10;
+    --decimals;
+  }
+
+  char buf[32];
+  char* p = buf;
+  if (units < 0) {
+    *p++ = '-';
+    units = -units;
+  }
+
+  long long whole = units / kPowersOf10[decimals];
+  p = std::to_chars(p, buf + sizeof(buf), whole).ptr;
+
+  if (decimals > 0) {
+    long long fraction = units % kPowersOf10[decimals];
+    *p++ = '.';
+    // Leading zeros of the fraction
+    for (int n = decimals - 1; n > 0 && fraction < kPowersOf10[n]; --n)
+      *p++ = '0';
+    p = std::to_chars(p, buf + sizeof(buf), fraction).ptr;
+  }
+
+  Append(buf, p - buf);
+  return *this;
+}
+
+}  // namespace xplmpp
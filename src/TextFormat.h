@@ -0,0 +1,94 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Allocation-free text formatting.
+
+#ifndef LANDEX_TEXTFORMAT_H
+#define LANDEX_TEXTFORMAT_H
+
+#include <string>
+
+#include "Common.h"
+#include "FlightMath.h"
+
+namespace xplmpp {
+
+// A value with its units, printed rounded to |decimals| decimal places.
+struct Quantity {
+  Quantity(float value, const char* units, int decimals = 1)
+  : value(value)
+  , units(units)
+  , decimals(decimals) {}
+
+  float value;
+  const char* units;
+  int decimals;
+};
+
+// Unit conversions for display, the values are in SI units.
+inline Quantity Knots(float meters_per_second, int decimals = 1) {
+  return Quantity(MetersPerSecondToKnots(meters_per_second), "kts", decimals);
+}
+
+inline Quantity FeetPerMinute(float meters_per_second, int decimals = 1) {
+  return Quantity(MetersPerSecondToFeetPerMinute(meters_per_second), "fpm", decimals);
+}
+
+inline Quantity Feet(float meters, int decimals = 1) {
+  return Quantity(MetersToFeet(meters), "ft", decimals);
+}
+
+// Formats a line of text into a fixed buffer, so that formatting does not
+// allocate. Numbers go through std::to_chars, text that does not fit is cut.
+class TextLine {
+public:
+  static const size_t kCapacity = 256;
+
+  TextLine() { clear(); }
+
+  void clear() {
+    size_ = 0;
+    text_[0] = 0;
+  }
+
+  const char* c_str() const { return text_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  TextLine& operator<<(const char* text);
+  TextLine& operator<<(const std::string& text);
+  TextLine& operator<<(int value);
+  TextLine& operator<<(size_t value);
+
+  // Prints rounded to tenths, like RoundOff() does.
+  TextLine& operator<<(float value) { return AppendNumber(value, 1); }
+
+  TextLine& operator<<(const Quantity& quantity);
+
+  // Prints |value| rounded to |decimals| places, dropping trailing zeros.
+  TextLine& AppendNumber(float value, int decimals);
+
+private:
+  void Append(const char* text, size_t size);
+
+  char text_[kCapacity];
+  size_t size_;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_TEXTFORMAT_H
@@ -0,0 +1,99 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Touchdown capture implementation.
+
+#include "TouchdownCapture.h"
+
+#include <algorithm>
+
+namespace xplmpp {
+
+void TouchdownCapture::Add(const FlightSnapshot& snapshot) {
+  if (size_ == kCapacity) {
+    if (triggered_ && trigger_index_ == 0) {
+      // Only the trigger and what followed are left, so replace the newest
+      // sample rather than lose the trigger
+      --size_;
+    } else {
+      // Drop the oldest sample, keeping the trigger pointing at the same one
+      first_ = first_ + 1 < kCapacity ? first_ + 1 : 0;
+      --size_;
+      if (triggered_)
+        --trigger_index_;
+    }
+  }
+
+  size_t slot = first_ + size_++;
+  samples_[slot < kCapacity ? slot : slot - kCapacity] = snapshot;
+}
+
+void TouchdownCapture::Trigger() {
+  if (!size_)
+    return;
+
+  triggered_ = true;
+  trigger_index_ = size_ - 1;
+  trigger_time_ = sample(trigger_index_).time;
+}
+
+bool TouchdownCapture::IsComplete() const {
+  return triggered_ && sample(size_ - 1).time - trigger_time_ >= kPostTriggerSeconds;
+}
+
+void TouchdownCapture::Analyze(LandingInfo& info) {
+  if (!triggered_)
+    return;
+
+  // The gear may already be loaded a few frames before the airplane is
+  // considered on the ground, so walk back to the first frame it was.
+  size_t contact = trigger_index_;
+  while (contact > 0) {
+    const FlightSnapshot& prev = sample(contact - 1);
+    if (prev.replay_mode || prev.faxil_gear == 0.0f ||
+        trigger_time_ - prev.time > kPreTriggerSeconds)
+      break;
+    --contact;
+  }
+
+  const FlightSnapshot& contact_sample = sample(contact);
+  info.contact_time = contact_sample.time;
+  info.ground_speed = contact_sample.ground_speed;
+  info.vertical_speed = contact_sample.vertical_speed;
+  info.lat = contact_sample.lat;
+  info.lon = contact_sample.lon;
+  info.heading = contact_sample.heading;
+
+  // Peaks over the whole window
+  info.peak_vertical_speed = contact_sample.vertical_speed;
+  info.peak_gforce = contact_sample.gforce;
+  info.min_gforce = contact_sample.gforce;
+  for (size_t index = 0; index < size_; ++index) {
+    const FlightSnapshot& snapshot = sample(index);
+    if (trigger_time_ - snapshot.time > kPreTriggerSeconds ||
+        snapshot.time - trigger_time_ > kPostTriggerSeconds)
+      continue;
+
+    info.peak_vertical_speed = std::min(info.peak_vertical_speed, snapshot.vertical_speed);
+    info.peak_gforce = std::max(info.peak_gforce, snapshot.gforce);
+    info.min_gforce = std::min(info.min_gforce, snapshot.gforce);
+  }
+
+  triggered_ = false;
+}
+
+}  // namespace xplmpp
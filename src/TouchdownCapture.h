@@ -0,0 +1,81 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Touchdown capture.
+
+#ifndef LANDEX_TOUCHDOWNCAPTURE_H
+#define LANDEX_TOUCHDOWNCAPTURE_H
+
+#include <array>
+
+#include "Common.h"
+
+#include "FlightLoopClient.h"
+#include "FlightSnapshot.h"
+
+namespace xplmpp {
+
+// Keeps the last couple of seconds of per-frame snapshots in a fixed size
+// ring, oscilloscope style. Once triggered at touchdown it keeps collecting
+// for the post-trigger window, and then the window around the trigger can be
+// analyzed for the touchdown details a single sample would miss.
+class TouchdownCapture {
+public:
+  static constexpr float kPreTriggerSeconds = 2.0f;
+  static constexpr float kPostTriggerSeconds = 1.0f;
+
+  // The whole window fits up to this frame rate. Above it the trigger sample
+  // is still kept, see Add().
+  static constexpr float kMaxFrameRate = 340.0f;
+  static constexpr size_t kCapacity = static_cast<size_t>(
+      (kPreTriggerSeconds + kPostTriggerSeconds) * kMaxFrameRate);
+
+  TouchdownCapture() = default;
+  ~TouchdownCapture() = default;
+
+  void Add(const FlightSnapshot& snapshot);
+
+  // Triggers at the last snapshot added
+  void Trigger();
+
+  bool triggered() const { return triggered_; }
+
+  // Returns true once the post-trigger window has been collected
+  bool IsComplete() const;
+
+  // Fills in the touchdown details of |info| from the samples collected
+  // around the trigger and rearms the capture.
+  void Analyze(LandingInfo& info);
+
+private:
+  const FlightSnapshot& sample(size_t index) const {
+    size_t slot = first_ + index;
+    return samples_[slot < kCapacity ? slot : slot - kCapacity];
+  }
+
+  std::array<FlightSnapshot, kCapacity> samples_;
+  size_t first_ = 0;
+  size_t size_ = 0;
+
+  bool triggered_ = false;
+  size_t trigger_index_ = 0;
+  float trigger_time_ = 0;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_TOUCHDOWNCAPTURE_H
@@ -0,0 +1,47 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Recorded trace flight data source implementation.
+
+#include "TraceFlightDataSource.h"
+
+namespace xplmpp {
+
+bool TraceFlightDataSource::Open(const std::string& filename) {
+  record_ = {};
+  return reader_.Open(filename);
+}
+
+void TraceFlightDataSource::Close() {
+  reader_.Close();
+}
+
+bool TraceFlightDataSource::Next() {
+  return reader_.Read(record_);
+}
+
+bool TraceFlightDataSource::IsPaused() {
+  // The flight loop does not record while the sim is paused
+  return false;
+}
+
+void TraceFlightDataSource::ReadSnapshot(float time, FlightSnapshot& snapshot) {
+  record_.ToSnapshot(snapshot);
+  snapshot.time = time;
+}
+
+}  // namespace xplmpp
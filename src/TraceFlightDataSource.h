@@ -0,0 +1,59 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Recorded trace flight data source.
+
+#ifndef LANDEX_TRACEFLIGHTDATASOURCE_H
+#define LANDEX_TRACEFLIGHTDATASOURCE_H
+
+#include <string>
+
+#include "Common.h"
+
+#include "FlightDataSource.h"
+#include "FlightRecorder.h"
+
+namespace xplmpp {
+
+// Plays a recorded flight trace back one record per tick, for running the
+// flight loop logic off the sim.
+class TraceFlightDataSource : public FlightDataSource {
+public:
+  TraceFlightDataSource() = default;
+  ~TraceFlightDataSource() override = default;
+
+  bool Open(const std::string& filename);
+  void Close();
+
+  // Moves on to the next record, returns false at the end of the trace
+  bool Next();
+
+  // Recorded sim time of the current record
+  float time() const { return record_.time; }
+
+  // FlightDataSource interface
+  bool IsPaused() override;
+  void ReadSnapshot(float time, FlightSnapshot& snapshot) override;
+
+private:
+  FlightRecordReader reader_;
+  FlightRecord record_ = {};
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_TRACEFLIGHTDATASOURCE_H
@@ -0,0 +1,45 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Traffic data source interface.
+
+#ifndef LANDEX_TRAFFICDATASOURCE_H
+#define LANDEX_TRAFFICDATASOURCE_H
+
+#include "Common.h"
+
+#include "TrafficSnapshot.h"
+
+namespace xplmpp {
+
+// Represents where the flight loop gets the other aircraft around from, e.g.
+// the sim TCAS targets or a recorded trace.
+class TrafficDataSource {
+public:
+  virtual ~TrafficDataSource() = default;
+
+  // Returns false if there is no traffic to be had from this source
+  virtual bool is_available() const = 0;
+
+  // Reads the traffic state at |time| into |snapshot|, returns false if
+  // there is nothing to read.
+  virtual bool ReadSnapshot(float time, TrafficSnapshot& snapshot) = 0;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_TRAFFICDATASOURCE_H
@@ -0,0 +1,56 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// AI and multiplayer aircraft snapshot.
+
+#ifndef LANDEX_TRAFFICSNAPSHOT_H
+#define LANDEX_TRAFFICSNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace xplmpp {
+
+// Holds the state of the AI and multiplayer aircraft read once per flight
+// loop tick. Each value is kept in its own column indexed by the aircraft
+// slot, so that a column is filled with a single array read from the sim.
+struct TrafficSnapshot {
+  static constexpr size_t kMaxAircraft = 64;  // slot 0 is the user aircraft
+  static constexpr size_t kTypeLength = 8;    // ICAO type designator, zero padded
+
+  float time = 0;    // Elapsed sim time, seconds
+  size_t count = 0;  // Slots in use, the user aircraft included
+
+  int id[kMaxAircraft];                    // Mode S id, 0 for an empty slot
+  char type[kMaxAircraft][kTypeLength];
+  double lat[kMaxAircraft];
+  double lon[kMaxAircraft];
+  float agl[kMaxAircraft];             // meters
+  float msl[kMaxAircraft];             // feet
+  float ground_speed[kMaxAircraft];    // meters/sec
+  float vertical_speed[kMaxAircraft];  // meters/sec
+  float heading[kMaxAircraft];         // degrees true
+  uint8_t on_ground[kMaxAircraft];     // weight on wheels
+
+  bool IsFlying(size_t slot) const {
+    return !on_ground[slot] || agl[slot] > 0.25f;
+  }
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_TRAFFICSNAPSHOT_H
@@ -0,0 +1,114 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// AI and multiplayer aircraft tracker implementation.
+
+#include "TrafficTracker.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+namespace xplmpp {
+
+// Descent rates are watched below this height for the peak one
+static const float kPeakHeight = 50.0f * kFtToMeters;
+
+TrafficTracker::TrafficTracker(FlightLoopClient* client, size_t history_capacity)
+: client_(client)
+, id_(TrafficSnapshot::kMaxAircraft, 0)
+, state_(TrafficSnapshot::kMaxAircraft, FlightTracker::State::unknown)
+, last_vertical_speed_(TrafficSnapshot::kMaxAircraft, 0.0f)
+, peak_vertical_speed_(TrafficSnapshot::kMaxAircraft, 0.0f)
+, flight_data_(TrafficSnapshot::kMaxAircraft, FlightData(history_capacity)) {
+  assert(client_);
+}
+
+void TrafficTracker::ResetSlot(size_t slot, int id) {
+  id_[slot] = id;
+  state_[slot] = FlightTracker::State::unknown;
+  last_vertical_speed_[slot] = 0.0f;
+  peak_vertical_speed_[slot] = 0.0f;
+  flight_data_[slot].Reset();
+}
+
+void TrafficTracker::Update(const TrafficSnapshot& snapshot) {
+  size_t count = std::min(snapshot.count, TrafficSnapshot::kMaxAircraft);
+
+  // Slot 0 is the user aircraft, FlightTracker looks after it
+  for (size_t slot = 1; slot < count; ++slot) {
+    if (snapshot.id[slot] != id_[slot])
+      ResetSlot(slot, snapshot.id[slot]);
+    if (!id_[slot])
+      continue;
+
+    bool flying = snapshot.IsFlying(slot);
+    float vertical_speed = snapshot.vertical_speed[slot];
+
+    switch (state_[slot]) {
+    case FlightTracker::State::unknown:
+      state_[slot] = flying ? FlightTracker::State::flying : FlightTracker::State::landed;
+      break;
+    case FlightTracker::State::flying:
+      if (!flying) {
+        state_[slot] = FlightTracker::State::landed;
+        ReportLanding(snapshot, slot);
+      } else
+      if (snapshot.agl[slot] < kPeakHeight) {
+        peak_vertical_speed_[slot] = std::min(peak_vertical_speed_[slot], vertical_speed);
+      }
+      break;
+    case FlightTracker::State::landed:
+      if (flying) {
+        state_[slot] = FlightTracker::State::flying;
+        peak_vertical_speed_[slot] = 0.0f;
+      }
+      break;
+    }
+
+    last_vertical_speed_[slot] = vertical_speed;
+
+    flight_data_[slot].Add(
+      Data(snapshot.time, snapshot.ground_speed[slot], vertical_speed,
+           snapshot.agl[slot], snapshot.msl[slot], snapshot.lat[slot],
+           snapshot.lon[slot], snapshot.heading[slot], flying));
+  }
+
+  // Forget the aircraft that are gone
+  for (size_t slot = std::max(count, size_t(1)); slot < id_.size(); ++slot) {
+    if (id_[slot])
+      ResetSlot(slot, 0);
+  }
+}
+
+void TrafficTracker::ReportLanding(const TrafficSnapshot& snapshot, size_t slot) {
+  // The sim has the descent stopped by the time the wheels are on the
+  // ground, so the contact rate is the one seen on the snapshot before
+  LandingInfo info(snapshot.ground_speed[slot], last_vertical_speed_[slot]);
+  info.contact_time = snapshot.time;
+  info.peak_vertical_speed = std::min(peak_vertical_speed_[slot], last_vertical_speed_[slot]);
+  info.lat = snapshot.lat[slot];
+  info.lon = snapshot.lon[slot];
+  info.heading = snapshot.heading[slot];
+
+  const char* type = snapshot.type[slot];
+  client_->OnTrafficLanded(id_[slot],
+      std::string(type, strnlen(type, TrafficSnapshot::kTypeLength)), info);
+}
+
+}  // namespace xplmpp
@@ -0,0 +1,72 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// AI and multiplayer aircraft tracker.
+
+#ifndef LANDEX_TRAFFICTRACKER_H
+#define LANDEX_TRAFFICTRACKER_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "Common.h"
+
+#include "FlightData.h"
+#include "FlightLoopClient.h"
+#include "FlightTracker.h"
+#include "TrafficSnapshot.h"
+
+namespace xplmpp {
+
+// Tracks the flying/landed state of the AI and multiplayer aircraft from a
+// stream of traffic snapshots, collects their flight data and notifies the
+// client of their landings. The state of each aircraft lives in columns
+// indexed by the snapshot slot, like the snapshot itself, and an aircraft
+// taking over a slot starts it over.
+class TrafficTracker {
+public:
+  static constexpr size_t kDefaultHistoryCapacity = 2048;
+
+  explicit TrafficTracker(FlightLoopClient* client,
+                          size_t history_capacity = kDefaultHistoryCapacity);
+  ~TrafficTracker() = default;
+
+  void Update(const TrafficSnapshot& snapshot);
+
+  size_t size() const { return id_.size(); }
+
+  int id(size_t slot) const { return id_[slot]; }
+  FlightTracker::State state(size_t slot) const { return state_[slot]; }
+  const FlightData& flight_data(size_t slot) const { return flight_data_[slot]; }
+
+private:
+  void ResetSlot(size_t slot, int id);
+  void ReportLanding(const TrafficSnapshot& snapshot, size_t slot);
+
+  FlightLoopClient* client_;
+
+  std::vector<int> id_;
+  std::vector<FlightTracker::State> state_;
+  std::vector<float> last_vertical_speed_;  // on the previous snapshot
+  std::vector<float> peak_vertical_speed_;  // fastest descent close to the ground
+  std::vector<FlightData> flight_data_;
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_TRAFFICTRACKER_H
@@ -0,0 +1,61 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Sim datarefs flight data source implementation.
+
+#include "XPLMFlightDataSource.h"
+
+namespace xplmpp {
+
+XPLMFlightDataSource::XPLMFlightDataSource() {
+  FindDataRefs();
+}
+
+void XPLMFlightDataSource::FindDataRefs() {
+  paused_.Find("sim/time/paused");
+  replay_mode_.Find("sim/operation/prefs/replay_mode");
+  faxil_gear_.Find("sim/flightmodel/forces/faxil_gear");
+  ground_speed_.Find("sim/flightmodel/position/groundspeed");
+  vertical_speed_.Find("sim/flightmodel/position/vh_ind");
+  gforce_.Find("sim/flightmodel2/misc/gforce_normal");
+  agl_.Find("sim/flightmodel/position/y_agl");
+  msl_.Find("sim/cockpit2/gauges/indicators/altitude_ft_pilot");
+  latitude_.Find("sim/flightmodel/position/latitude");
+  longitude_.Find("sim/flightmodel/position/longitude");
+  heading_.Find("sim/flightmodel/position/true_psi");
+}
+
+bool XPLMFlightDataSource::IsPaused() {
+  return !!Paused();
+}
+
+void XPLMFlightDataSource::ReadSnapshot(float time, FlightSnapshot& snapshot) {
+  // Each dataref is read exactly once per tick.
+  snapshot.time = time;
+  snapshot.replay_mode = !!ReplayMode();
+  snapshot.faxil_gear = FaxilGear();
+  snapshot.ground_speed = GroundSpeed();
+  snapshot.vertical_speed = VerticalSpeed();
+  snapshot.gforce = GForce();
+  snapshot.agl = Agl();
+  snapshot.msl = Msl();
+  snapshot.lat = Latitude();
+  snapshot.lon = Longitude();
+  snapshot.heading = Heading();
+}
+
+}  // namespace xplmpp
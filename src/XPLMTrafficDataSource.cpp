@@ -0,0 +1,141 @@
+// Copyright (c) 2019 Peter Kvitek.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Sim datarefs traffic data source implementation.
+
+#include "XPLMTrafficDataSource.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "FlightMath.h"
+
+namespace xplmpp {
+
+// Taken as on the ground with no weight on wheels dataref
+static const float kOnGroundAgl = 0.25f;
+
+XPLMTrafficDataSource::XPLMTrafficDataSource() {
+  FindDataRefs();
+}
+
+XPLMTrafficDataSource::~XPLMTrafficDataSource() {
+  if (probe_)
+    ::XPLMDestroyProbe(probe_);
+}
+
+void XPLMTrafficDataSource::FindDataRefs() {
+  count_ = ::XPLMFindDataRef("sim/cockpit2/tcas/indicators/tcas_num_acf");
+  id_ = ::XPLMFindDataRef("sim/cockpit2/tcas/targets/modeS_id");
+  type_ = ::XPLMFindDataRef("sim/cockpit2/tcas/targets/icao_type");
+  lat_ = ::XPLMFindDataRef("sim/cockpit2/tcas/targets/position/lat");
+  lon_ = ::XPLMFindDataRef("sim/cockpit2/tcas/targets/position/lon");
+  ele_ = ::XPLMFindDataRef("sim/cockpit2/tcas/targets/position/ele");
+  x_ = ::XPLMFindDataRef("sim/cockpit2/tcas/targets/position/x");
+  y_ = ::XPLMFindDataRef("sim/cockpit2/tcas/targets/position/y");
+  z_ = ::XPLMFindDataRef("sim/cockpit2/tcas/targets/position/z");
+  vx_ = ::XPLMFindDataRef("sim/cockpit2/tcas/targets/position/vx");
+  vy_ = ::XPLMFindDataRef("sim/cockpit2/tcas/targets/position/vy");
+  vz_ = ::XPLMFindDataRef("sim/cockpit2/tcas/targets/position/vz");
+  psi_ = ::XPLMFindDataRef("sim/cockpit2/tcas/targets/position/psi");
+  weight_on_wheels_ =
+      ::XPLMFindDataRef("sim/cockpit2/tcas/targets/position/weight_on_wheels");
+
+  // Older sims have no TCAS targets, and the type is only nice to have
+  available_ = count_ && id_ && lat_ && lon_ && ele_ && x_ && y_ && z_ &&
+               vx_ && vy_ && vz_ && psi_;
+  if (!available_) {
+    LOG(INFO) << "No TCAS target datarefs, traffic landings are not tracked.";
+    return;
+  }
+
+  probe_ = ::XPLMCreateProbe(xplm_ProbeY);
+}
+
+bool XPLMTrafficDataSource::ReadSnapshot(float time, TrafficSnapshot& snapshot) {
+  snapshot.time = time;
+  snapshot.count = 0;
+  if (!available_)
+    return false;
+
+  // Slot 0 is the user aircraft, so there is nothing to read with one or none
+  int count = std::min(::XPLMGetDatai(count_),
+                       static_cast<int>(TrafficSnapshot::kMaxAircraft));
+  if (count <= 1)
+    return false;
+  snapshot.count = count;
+
+  // Each array is read exactly once per tick.
+  ::XPLMGetDatavi(id_, snapshot.id, 0, count);
+
+  if (type_) {
+    ::XPLMGetDatab(type_, snapshot.type, 0,
+                   count * static_cast<int>(TrafficSnapshot::kTypeLength));
+  } else {
+    std::fill_n(&snapshot.type[0][0], count * TrafficSnapshot::kTypeLength, '\0');
+  }
+
+  ::XPLMGetDatavf(lat_, buffer_, 0, count);
+  std::copy(buffer_, buffer_ + count, snapshot.lat);
+  ::XPLMGetDatavf(lon_, buffer_, 0, count);
+  std::copy(buffer_, buffer_ + count, snapshot.lon);
+
+  ::XPLMGetDatavf(ele_, buffer_, 0, count);
+  for (int n = 0; n < count; ++n)
+    snapshot.msl[n] = MetersToFeet(buffer_[n]);
+
+  ::XPLMGetDatavf(psi_, snapshot.heading, 0, count);
+
+  // Local coordinates have y pointing up, x and z horizontal
+  ::XPLMGetDatavf(vy_, snapshot.vertical_speed, 0, count);
+  ::XPLMGetDatavf(vx_, vx_buffer_, 0, count);
+  ::XPLMGetDatavf(vz_, vz_buffer_, 0, count);
+  for (int n = 0; n < count; ++n)
+    snapshot.ground_speed[n] = sqrtf(vx_buffer_[n] * vx_buffer_[n] + vz_buffer_[n] * vz_buffer_[n]);
+
+  if (weight_on_wheels_) {
+    ::XPLMGetDatavi(weight_on_wheels_, int_buffer_, 0, count);
+    for (int n = 0; n < count; ++n)
+      snapshot.on_ground[n] = int_buffer_[n] != 0;
+  } else {
+    std::fill_n(snapshot.on_ground, count, uint8_t(0));
+  }
+
+  // Only the aircraft in the air need the terrain probed under them
+  ::XPLMGetDatavf(x_, x_buffer_, 0, count);
+  ::XPLMGetDatavf(y_, y_buffer_, 0, count);
+  ::XPLMGetDatavf(z_, z_buffer_, 0, count);
+  for (int n = 0; n < count; ++n) {
+    snapshot.agl[n] = 0.0f;
+    if (snapshot.on_ground[n] || !snapshot.id[n])
+      continue;
+
+    XPLMProbeInfo_t info;
+    info.structSize = sizeof(info);
+    bool hit = ::XPLMProbeTerrainXYZ(probe_, x_buffer_[n], y_buffer_[n], z_buffer_[n],
+                                     &info) == xplm_ProbeHitTerrain;
+    if (hit)
+      snapshot.agl[n] = std::max(y_buffer_[n] - info.locationY, 0.0f);
+
+    if (!weight_on_wheels_)
+      snapshot.on_ground[n] = hit && snapshot.agl[n] < kOnGroundAgl;
+  }
+
+  return true;
+}
+
+}  // namespace xplmpp
@@ -0,0 +1,81 @@
+// Copyright (c) 2019 Peter Kvitek. All rights reserved.
+//
+// Author: Peter Kvitek (pete@kvitek.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// -----------------------------------------------------------------------------
+//
+// Sim datarefs traffic data source.
+
+#ifndef LANDEX_XPLMTRAFFICDATASOURCE_H
+#define LANDEX_XPLMTRAFFICDATASOURCE_H
+
+#include "Common.h"
+
+#include "XPLMDataAccess.h"
+#include "XPLMScenery.h"
+
+#include "TrafficDataSource.h"
+#include "TrafficSnapshot.h"
+
+namespace xplmpp {
+
+// Reads the AI and multiplayer aircraft state from the sim TCAS target
+// datarefs, one array read per value for all the aircraft at once. Those
+// cover every plugin providing traffic as well as the sim's own AI.
+class XPLMTrafficDataSource : public TrafficDataSource {
+public:
+  XPLMTrafficDataSource();
+  ~XPLMTrafficDataSource() override;
+
+  // TrafficDataSource interface, not available if the sim has no TCAS
+  // target datarefs
+  bool is_available() const override { return available_; }
+  bool ReadSnapshot(float time, TrafficSnapshot& snapshot) override;
+
+private:
+  void FindDataRefs();
+
+  bool available_ = false;
+
+  // XPLMData has no array accessors, so these are plain datarefs
+  XPLMDataRef count_ = nullptr;           // int, aircraft in the arrays
+  XPLMDataRef id_ = nullptr;              // int[64], mode S id
+  XPLMDataRef type_ = nullptr;            // byte[512], ICAO type designators
+  XPLMDataRef lat_ = nullptr;             // float[64], degrees
+  XPLMDataRef lon_ = nullptr;             // float[64], degrees
+  XPLMDataRef ele_ = nullptr;             // float[64], meters MSL
+  XPLMDataRef x_ = nullptr;               // float[64], local coordinates, meters
+  XPLMDataRef y_ = nullptr;
+  XPLMDataRef z_ = nullptr;
+  XPLMDataRef vx_ = nullptr;              // float[64], local velocity, meters/sec
+  XPLMDataRef vy_ = nullptr;
+  XPLMDataRef vz_ = nullptr;
+  XPLMDataRef psi_ = nullptr;             // float[64], true heading, degrees
+  XPLMDataRef weight_on_wheels_ = nullptr;  // int[64]
+
+  XPLMProbeRef probe_ = nullptr;
+
+  // Read buffers for the values converted into the snapshot columns
+  float buffer_[TrafficSnapshot::kMaxAircraft];
+  float x_buffer_[TrafficSnapshot::kMaxAircraft];
+  float y_buffer_[TrafficSnapshot::kMaxAircraft];
+  float z_buffer_[TrafficSnapshot::kMaxAircraft];
+  float vx_buffer_[TrafficSnapshot::kMaxAircraft];
+  float vz_buffer_[TrafficSnapshot::kMaxAircraft];
+  int int_buffer_[TrafficSnapshot::kMaxAircraft];
+};
+
+}  // namespace xplmpp
+
+#endif  // #ifndef LANDEX_XPLMTRAFFICDATASOURCE_H